@@ -319,7 +319,7 @@ static inline unsigned long _find_next_bit(const unsigned long *addr1,
                 const unsigned long *addr2, unsigned long nbits,
                 unsigned long start, unsigned long invert)
 {
-	unsigned int tmp;
+	unsigned long tmp;
 
 	if (unlikely(start >= nbits))
 		return nbits;
@@ -453,6 +453,9 @@ static inline int bitmap_empty(const unsigned long *src, unsigned nbits)
 
 #define IDA_MAX	(0x80000000U / IDA_BITMAP_BITS - 1)
 
+/* Preallocated leaf bitmap, per-cpu on kernel and per-thread here */
+static __thread struct ida_bitmap *ida_bitmap;
+
 static int ida_get_new_above(struct ida *ida, int start)
 {
 	struct radix_tree_root *root = &ida->ida_rt;
@@ -500,6 +503,7 @@ static int ida_get_new_above(struct ida *ida, int start)
 			bitmap = ida_bitmap;
 			if (!bitmap)
 				return -EAGAIN;
+			ida_bitmap = NULL;
 			bitmap->bitmap[0] = tmp >> RADIX_TREE_EXCEPTIONAL_SHIFT;
 			*slot = bitmap;
 		}
@@ -531,6 +535,7 @@ static int ida_get_new_above(struct ida *ida, int start)
 			bitmap = ida_bitmap;
 			if (!bitmap)
 				return -EAGAIN;
+			ida_bitmap = NULL;
 			__set_bit(bit, bitmap->bitmap);
 			radix_tree_iter_replace(root, &iter, slot, bitmap);
 		}
@@ -552,9 +557,9 @@ static int ida_pre_get(struct ida *ida, gfp_t gfp)
 	if (!ida_bitmap) {
 		struct ida_bitmap *bitmap = (struct ida_bitmap *)malloc(
 						sizeof(struct ida_bitmap));
-		memset(bitmap, 0, sizeof(struct ida_bitmap));
 		if (!bitmap)
 			return 0;
+		memset(bitmap, 0, sizeof(struct ida_bitmap));
 		ida_bitmap = bitmap;
 	}
 	return 1;
@@ -659,3 +664,105 @@ void ida_free(struct ida *ida, unsigned int id)
 	ida_remove(ida, id);
 	xa_unlock_irqrestore(&ida->ida_rt, flags);
 }
+
+/**
+ * ida_cache_init() - Initialise a per-thread IDA cache.
+ * @cache: Cache owned by the calling thread.
+ * @ida: IDA handle the IDs are reserved from.
+ * @min: Lowest ID to allocate.
+ * @max: Highest ID to allocate.
+ */
+void ida_cache_init(struct ida_cache *cache, struct ida *ida,
+			unsigned int min, unsigned int max)
+{
+	if ((int)max < 0)
+		max = INT_MAX;
+
+	cache->ida = ida;
+	cache->min = min;
+	cache->max = max;
+	cache->next = min;
+	cache->head = 0;
+	cache->nr = 0;
+}
+
+/*
+ * __ida_cache_flush() - Give the @nr oldest cached IDs back to the IDA.
+ */
+void __ida_cache_flush(struct ida_cache *cache, unsigned int nr)
+{
+	struct ida *ida = cache->ida;
+	unsigned long flags;
+
+	xa_lock_irqsave(&ida->ida_rt, flags);
+	while (nr-- && cache->nr) {
+		ida_remove(ida, cache->ids[cache->head]);
+		cache->head = (cache->head + 1) & (IDA_CACHE_SIZE - 1);
+		cache->nr--;
+	}
+	xa_unlock_irqrestore(&ida->ida_rt, flags);
+}
+
+/*
+ * __ida_cache_refill() - Reserve a batch of IDs for an empty cache.
+ *
+ * All IDs of the batch are reserved under a single hold of the IDA
+ * lock.  The search starts at the cyclic cursor and wraps around to
+ * @min once before reporting %-ENOSPC.
+ *
+ * Return: 0 if at least one ID was reserved, %-ENOMEM or %-ENOSPC.
+ */
+int __ida_cache_refill(struct ida_cache *cache, gfp_t gfp)
+{
+	struct ida *ida = cache->ida;
+	unsigned int start = cache->next;
+	bool wrapped = false;
+	unsigned long flags;
+	int id = 0;
+
+again:
+	xa_lock_irqsave(&ida->ida_rt, flags);
+	while (cache->nr < IDA_CACHE_BATCH) {
+		if (start <= cache->max)
+			id = ida_get_new_above(ida, start);
+		else
+			id = -ENOSPC;
+
+		if (id > (int)cache->max) {
+			ida_remove(ida, id);
+			id = -ENOSPC;
+		}
+		if (id == -ENOSPC && !wrapped && cache->next != cache->min) {
+			wrapped = true;
+			start = cache->min;
+			continue;
+		}
+		if (id < 0)
+			break;
+
+		cache->ids[(cache->head + cache->nr) & (IDA_CACHE_SIZE - 1)] = id;
+		cache->nr++;
+		start = id + 1;
+	}
+	xa_unlock_irqrestore(&ida->ida_rt, flags);
+
+	if (unlikely(id == -EAGAIN)) {
+		if (ida_pre_get(ida, gfp))
+			goto again;
+		id = -ENOMEM;
+	}
+	cache->next = start;
+
+	if (cache->nr)
+		return 0;
+	return id;
+}
+
+/**
+ * ida_cache_destroy() - Give every cached ID back to the IDA.
+ * @cache: Cache owned by the calling thread.
+ */
+void ida_cache_destroy(struct ida_cache *cache)
+{
+	__ida_cache_flush(cache, IDA_CACHE_SIZE);
+}
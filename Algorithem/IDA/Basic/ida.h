@@ -179,8 +179,13 @@ extern void *idr_get_next(struct idr *idr, int *nextid);
 extern void *idr_get_next_ul(struct idr *idr, unsigned long *nextid);
 extern void *idr_replace(struct idr *idr, void *ptr, unsigned long id);
 
-#define xa_lock_irqsave(xa, flags) 	while (0) {}
-#define xa_unlock_irqrestore(xa, flags)	while (0) {}
+#define xa_lock_irqsave(xa, flags)					\
+do {									\
+	while (__atomic_test_and_set(&(xa)->xa_lock, __ATOMIC_ACQUIRE))	\
+		;							\
+} while (0)
+#define xa_unlock_irqrestore(xa, flags)					\
+	__atomic_clear(&(xa)->xa_lock, __ATOMIC_RELEASE)
 
 /*
  * The IDA is even shorter since it uses a bitmap at the last level.
@@ -202,8 +207,6 @@ struct ida_bitmap {
 	unsigned long		bitmap[IDA_BITMAP_LONGS];
 };
 
-struct ida_bitmap *ida_bitmap;
-
 struct ida {
 	struct radix_tree_root ida_rt;
 };
@@ -233,6 +236,87 @@ static inline int ida_alloc(struct ida *ida, gfp_t gfp)
 	return ida_alloc_range(ida, 0, ~0, gfp);
 }
 
+/*
+ * IDA per-thread cache.
+ *
+ * Each thread owns a small ring of IDs which are reserved from the IDA
+ * in one batch, so ida_cache_alloc() and ida_cache_free() only touch
+ * thread-private memory and the IDA lock plus the radix tree walk are
+ * paid once per IDA_CACHE_BATCH operations.  The batch is reserved
+ * cyclically: each refill continues after the last ID handed out and
+ * wraps to @min, so a freshly freed ID is not recycled at once.
+ *
+ * IDs sitting in a cache are still allocated in the IDA.  Call
+ * ida_cache_destroy() before the IDA is torn down.
+ */
+#define IDA_CACHE_SIZE		64	/* must be a power of 2 */
+#define IDA_CACHE_BATCH		(IDA_CACHE_SIZE / 2)
+
+struct ida_cache {
+	struct ida		*ida;
+	unsigned int		min;
+	unsigned int		max;
+	unsigned int		next;	/* cursor of the cyclic refill */
+	unsigned int		head;
+	unsigned int		nr;
+	unsigned int		ids[IDA_CACHE_SIZE];
+};
+
+extern void ida_cache_init(struct ida_cache *cache, struct ida *ida,
+			unsigned int min, unsigned int max);
+extern void ida_cache_destroy(struct ida_cache *cache);
+extern int __ida_cache_refill(struct ida_cache *cache, gfp_t gfp);
+extern void __ida_cache_flush(struct ida_cache *cache, unsigned int nr);
+
+/**
+ * ida_cache_alloc() - Allocate an unused ID through a per-thread cache.
+ * @cache: Cache owned by the calling thread.
+ * @gfp: Memory allocation flags.
+ *
+ * Context: Only the thread which owns @cache.
+ * Return: The allocated ID, or %-ENOMEM if memory could not be allocated,
+ * or %-ENOSPC if there are no free IDs.
+ */
+static inline int ida_cache_alloc(struct ida_cache *cache, gfp_t gfp)
+{
+	unsigned int id;
+
+	if (unlikely(!cache->nr)) {
+		int err = __ida_cache_refill(cache, gfp);
+
+		if (err)
+			return err;
+	}
+	id = cache->ids[cache->head];
+	cache->head = (cache->head + 1) & (IDA_CACHE_SIZE - 1);
+	cache->nr--;
+	return id;
+}
+
+/**
+ * ida_cache_free() - Release an ID into a per-thread cache.
+ * @cache: Cache owned by the calling thread.
+ * @id: Previously allocated ID.
+ *
+ * The ID stays reserved in the IDA and is handed out again by a later
+ * ida_cache_alloc() on @cache.  When the cache is full, the oldest half
+ * is given back to the IDA.  IDs outside the range of @cache go straight
+ * to ida_free().  Unlike ida_free(), a double free is not detected.
+ *
+ * Context: Only the thread which owns @cache.
+ */
+static inline void ida_cache_free(struct ida_cache *cache, unsigned int id)
+{
+	if (unlikely(id < cache->min || id > cache->max)) {
+		ida_free(cache->ida, id);
+		return;
+	}
+	if (unlikely(cache->nr == IDA_CACHE_SIZE))
+		__ida_cache_flush(cache, IDA_CACHE_BATCH);
+	cache->ids[(cache->head + cache->nr) & (IDA_CACHE_SIZE - 1)] = id;
+	cache->nr++;
+}
+
 /*
  * This looks more complex than it should be. But we need to
  * get the type for the ~ right in round_down (it needs to be
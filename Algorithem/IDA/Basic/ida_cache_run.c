@@ -0,0 +1,91 @@
+/*
+ * IDA per-thread cache benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+/* IDR/IDA */
+#include <ida.h>
+
+#define NR_THREADS_MAX		16
+#define NR_LOOPS		200000
+/* IDs each thread keeps alive, like a set of open connections */
+#define NR_INFLIGHT		16
+
+/* Root of IDA */
+static DEFINE_IDA(BiscuitOS_ida);
+static int use_cache;
+
+static void *bench_thread(void *arg)
+{
+	struct ida_cache cache;
+	int ids[NR_INFLIGHT];
+	unsigned long i;
+	int j;
+
+	ida_cache_init(&cache, &BiscuitOS_ida, 0, ~0);
+	for (i = 0; i < NR_LOOPS; i++) {
+		for (j = 0; j < NR_INFLIGHT; j++) {
+			if (use_cache)
+				ids[j] = ida_cache_alloc(&cache, GFP_KERNEL);
+			else
+				ids[j] = ida_alloc(&BiscuitOS_ida, GFP_KERNEL);
+			if (ids[j] < 0) {
+				printf("IDA: allocate failed %d\n", ids[j]);
+				exit(1);
+			}
+		}
+		for (j = 0; j < NR_INFLIGHT; j++) {
+			if (use_cache)
+				ida_cache_free(&cache, ids[j]);
+			else
+				ida_free(&BiscuitOS_ida, ids[j]);
+		}
+	}
+	ida_cache_destroy(&cache);
+	return NULL;
+}
+
+static double bench(int nr_threads, int cache)
+{
+	pthread_t threads[NR_THREADS_MAX];
+	struct timespec start, end;
+	int i;
+
+	use_cache = cache;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr_threads; i++)
+		pthread_create(&threads[i], NULL, bench_thread, NULL);
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (!radix_tree_empty(&BiscuitOS_ida.ida_rt))
+		printf("IDA: IDs leaked\n");
+
+	return (end.tv_sec - start.tv_sec) +
+			(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main()
+{
+	int nr_threads;
+
+	printf("threads   ida_alloc/free(Mops)   ida_cache(Mops)\n");
+	for (nr_threads = 1; nr_threads <= NR_THREADS_MAX; nr_threads <<= 1) {
+		double ops = 2.0 * nr_threads * NR_LOOPS * NR_INFLIGHT / 1e6;
+
+		printf("%7d   %20.2f   %15.2f\n", nr_threads,
+					ops / bench(nr_threads, 0),
+					ops / bench(nr_threads, 1));
+	}
+	return 0;
+}
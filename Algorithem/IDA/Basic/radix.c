@@ -27,7 +27,7 @@
 #include <radix.h>
 
 /*
- * Per-cpu pool of perloaded nodes
+ * Per-cpu pool of perloaded nodes, on userspace each thread owns one.
  */
 struct radix_tree_preload {
 	unsigned nr;
@@ -45,7 +45,7 @@ struct radix_tree_preload {
 
 #define IDR_PRELOAD_SIZE	(IDR_MAX_PATH * 2 - 1)
 
-static struct radix_tree_preload radix_tree_preloads = { 0, };
+static __thread struct radix_tree_preload radix_tree_preloads = { 0, };
 
 static inline void *node_to_entry(void *ptr)
 {
@@ -240,11 +240,14 @@ struct radix_tree_node {
 struct radix_tree_root {
 	gfp_t			gfp_mask;
 	struct radix_tree_node	*rnode;
+	/* Stand-in for xa_lock, a test-and-set spinlock */
+	bool			xa_lock;
 };
 
 #define RADIX_TREE_INIT(name, mask)	{				\
 	.gfp_mask = (mask),						\
 	.rnode = NULL,							\
+	.xa_lock = false,						\
 }
 
 #define RADIX_TREE(name, mask) \
@@ -254,6 +257,7 @@ struct radix_tree_root {
 do {									\
 	(root)->gfp_mask = (mask);					\
 	(root)->rnode = NULL;						\
+	(root)->xa_lock = false;					\
 } while (0)
 
 static inline bool radix_tree_empty(const struct radix_tree_root *root)
@@ -1,6 +1,90 @@
 #include <idr.h>
 #include <errno.h>
 
+#define IDR_COMPACT_MASK	((1UL << IDR_COMPACT_SLOTS) - 1)
+
+/*
+ * idr_compact_next() - Find the next compact slot at or above @index
+ * whose bit in @mask is set.  Returns IDR_COMPACT_SLOTS if none.
+ */
+static inline unsigned long idr_compact_next(unsigned long mask,
+						unsigned long index)
+{
+	if (index >= IDR_COMPACT_SLOTS)
+		return IDR_COMPACT_SLOTS;
+	mask &= (~0UL << index) & IDR_COMPACT_MASK;
+	return mask ? __ffs(mask) : IDR_COMPACT_SLOTS;
+}
+
+/*
+ * idr_compact_populated() - Mask of the compact slots which hold a
+ * non-NULL pointer, which are the only ones the radix tree iterators
+ * report.
+ */
+static unsigned long idr_compact_populated(const struct idr *idr)
+{
+	unsigned long mask = 0;
+	unsigned long i;
+
+	for (i = 0; i < IDR_COMPACT_SLOTS; i++)
+		if (idr->idr_slots[i])
+			mask |= 1UL << i;
+	return mask & idr->idr_used;
+}
+
+/*
+ * idr_compact_to_tree() - Move all entries of a compact IDR into the
+ * radix tree.  On failure the entries already inserted are removed
+ * again and the IDR stays compact.
+ */
+static int idr_compact_to_tree(struct idr *idr, gfp_t gfp)
+{
+	struct radix_tree_iter iter;
+	unsigned long index;
+	void **slot;
+
+	for (index = idr_compact_next(idr->idr_used, 0);
+	     index < IDR_COMPACT_SLOTS;
+	     index = idr_compact_next(idr->idr_used, index + 1)) {
+		radix_tree_iter_init(&iter, index);
+		slot = idr_get_free(&idr->idr_rt, &iter, gfp, index);
+		if (IS_ERR(slot))
+			goto unwind;
+		radix_tree_iter_replace(&idr->idr_rt, &iter, slot,
+						idr->idr_slots[index]);
+		radix_tree_iter_tag_clear(&idr->idr_rt, &iter, IDR_FREE);
+	}
+	idr->idr_compact = false;
+	return 0;
+
+unwind:
+	while (index--)
+		if (idr->idr_used & (1UL << index))
+			radix_tree_delete_item(&idr->idr_rt, index, NULL);
+	return PTR_ERR(slot);
+}
+
+/*
+ * idr_compact_alloc() - Allocate an ID from the flat array.
+ *
+ * Return: 0 if an ID was allocated, -ENOSPC if the range does not fit
+ * in the array, or -EEXIST if the range does fit but is fully used.
+ */
+static int idr_compact_alloc(struct idr *idr, void *ptr, unsigned int *id,
+						unsigned long max)
+{
+	unsigned long index;
+
+	index = idr_compact_next(~idr->idr_used, *id);
+	if (index > max || index >= IDR_COMPACT_SLOTS)
+		return max < IDR_COMPACT_SLOTS ? -EEXIST : -ENOSPC;
+
+	idr->idr_slots[index] = ptr;
+	idr->idr_used |= 1UL << index;
+	*id = index;
+	return 0;
+}
+
 /*
  * idr_alloc_u32() - Allocate an ID.
  * @idr: IDR handle.
@@ -38,6 +122,19 @@ int idr_alloc_u32(struct idr *idr, void *ptr, unsigned int *nextid,
 		idr->idr_rt.gfp_mask |= IDR_RT_MARKER;
 
 	id = (id < base) ? 0 : id - base;
+	if (idr->idr_compact) {
+		int err = idr_compact_alloc(idr, ptr, &id, max - base);
+
+		if (!err) {
+			*nextid = id + base;
+			return 0;
+		}
+		if (err == -EEXIST)
+			return -ENOSPC;
+		err = idr_compact_to_tree(idr, gfp);
+		if (err)
+			return err;
+	}
 	radix_tree_iter_init(&iter, id);
 	slot = idr_get_free(&idr->idr_rt, &iter, gfp, max - base);
 	if (IS_ERR(slot))
@@ -144,7 +241,26 @@ int idr_alloc_cyclic(struct idr *idr, void *ptr, int start, int end, gfp_t gfp)
  */
 void *idr_remove(struct idr *idr, unsigned long id)
 {
-	return radix_tree_delete_item(&idr->idr_rt, id - idr->idr_base, NULL);
+	void *entry;
+
+	id -= idr->idr_base;
+	if (idr->idr_compact) {
+		if (id >= IDR_COMPACT_SLOTS || !(idr->idr_used & (1UL << id)))
+			return NULL;
+		entry = idr->idr_slots[id];
+		idr->idr_slots[id] = NULL;
+		idr->idr_used &= ~(1UL << id);
+		return entry;
+	}
+
+	entry = radix_tree_delete_item(&idr->idr_rt, id, NULL);
+	if (radix_tree_empty(&idr->idr_rt) &&
+			radix_tree_tagged(&idr->idr_rt, IDR_FREE)) {
+		idr->idr_used = 0;
+		memset(idr->idr_slots, 0, sizeof(idr->idr_slots));
+		idr->idr_compact = true;
+	}
+	return entry;
 }
 
 /*
@@ -163,7 +279,13 @@ void *idr_remove(struct idr *idr, unsigned long id)
  */
 void *idr_find(const struct idr *idr, unsigned long id)
 {
-	return radix_tree_lookup(&idr->idr_rt, id - idr->idr_base);
+	id -= idr->idr_base;
+	if (idr->idr_compact) {
+		if (id >= IDR_COMPACT_SLOTS || !(idr->idr_used & (1UL << id)))
+			return NULL;
+		return idr->idr_slots[id];
+	}
+	return radix_tree_lookup(&idr->idr_rt, id);
 }
 
 /**
@@ -190,6 +312,21 @@ int idr_for_each(const struct idr *idr,
 	void **slot;
 	int base = idr->idr_base;
 
+	if (idr->idr_compact) {
+		unsigned long mask = idr_compact_populated(idr);
+		unsigned long index;
+
+		for (index = idr_compact_next(mask, 0);
+		     index < IDR_COMPACT_SLOTS;
+		     index = idr_compact_next(mask, index + 1)) {
+			int ret = fn(index + base, idr->idr_slots[index], data);
+
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
 	radix_tree_for_each_slot(slot, &idr->idr_rt, &iter, 0) {
 		int ret;
 		unsigned long id = iter.index + base;
@@ -221,6 +358,13 @@ void *idr_get_next(struct idr *idr, int *nextid)
 	unsigned long id = *nextid;
 
 	id = (id < base) ? 0 : id - base;
+	if (idr->idr_compact) {
+		id = idr_compact_next(idr_compact_populated(idr), id);
+		if (id >= IDR_COMPACT_SLOTS)
+			return NULL;
+		*nextid = id + base;
+		return idr->idr_slots[id];
+	}
 	slot = radix_tree_iter_find(&idr->idr_rt, &iter, id);
 	if (!slot)
 		return NULL;
@@ -251,6 +395,13 @@ void *idr_get_next_ul(struct idr *idr, unsigned long *nextid)
 	unsigned long id = *nextid;
 
 	id = (id < base) ? 0 : id - base;
+	if (idr->idr_compact) {
+		id = idr_compact_next(idr_compact_populated(idr), id);
+		if (id >= IDR_COMPACT_SLOTS)
+			return NULL;
+		*nextid = id + base;
+		return idr->idr_slots[id];
+	}
 	slot = radix_tree_iter_find(&idr->idr_rt, &iter, id);
 	if (!slot)
 		return NULL;
@@ -284,6 +435,14 @@ void *idr_replace(struct idr *idr, void *ptr, unsigned long id)
 		return ERR_PTR(-EINVAL);
 	id -= idr->idr_base;
 
+	if (idr->idr_compact) {
+		if (id >= IDR_COMPACT_SLOTS || !(idr->idr_used & (1UL << id)))
+			return ERR_PTR(-ENOENT);
+		entry = idr->idr_slots[id];
+		idr->idr_slots[id] = ptr;
+		return entry;
+	}
+
 	entry = __radix_tree_lookup(&idr->idr_rt, id, &node, &slot);
 	if (!slot || radix_tree_tag_get(&idr->idr_rt, id, IDR_FREE))
 		return ERR_PTR(-ENOENT);
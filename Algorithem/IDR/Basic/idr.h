@@ -12,10 +12,22 @@
 
 #define INT_MAX		((int)(~0U>>1))
 
+/*
+ * Most IDRs only ever hold a handful of IDs close to idr_base.  Such an
+ * IDR keeps its pointers in a flat array of IDR_COMPACT_SLOTS entries,
+ * with one bit per allocated ID in idr_used, and only moves them into
+ * the radix tree once an ID outside of the array is needed.  The IDR
+ * goes back to the array when the radix tree becomes empty.
+ */
+#define IDR_COMPACT_SLOTS	16
+
 struct idr {
 	struct radix_tree_root	idr_rt;
 	unsigned long		idr_base;
 	unsigned int		idr_next;
+	bool			idr_compact;
+	unsigned long		idr_used;
+	void			*idr_slots[IDR_COMPACT_SLOTS];
 };
 
 /*
@@ -32,6 +44,8 @@ struct idr {
 	.idr_rt = RADIX_TREE_INIT(name, IDR_RT_MARKER),		\
 	.idr_base = (base),					\
 	.idr_next = 0,						\
+	.idr_compact = true,					\
+	.idr_used = 0,						\
 }
 
 /*
@@ -90,6 +104,9 @@ static inline void idr_init_base(struct idr *idr, int base)
 	INIT_RADIX_TREE(&idr->idr_rt, IDR_RT_MARKER);
 	idr->idr_base = base;
 	idr->idr_next = 0;
+	idr->idr_compact = true;
+	idr->idr_used = 0;
+	memset(idr->idr_slots, 0, sizeof(idr->idr_slots));
 }
 
 /**
@@ -112,6 +129,8 @@ static inline void idr_init(struct idr *idr)
  */
 static inline bool idr_is_empty(const struct idr *idr)
 {
+	if (idr->idr_compact)
+		return !idr->idr_used;
 	return radix_tree_empty(&idr->idr_rt) &&
 		radix_tree_tagged(&idr->idr_rt, IDR_FREE);
 }
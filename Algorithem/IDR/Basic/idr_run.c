@@ -9,6 +9,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* IDR/IDA */
 #include <idr.h>
@@ -29,11 +30,88 @@ static struct node node2 = { .name = "IDC" };
 /* ID array */
 static int idr_array[8];
 
+/* Entries for the flat array <-> radix tree checks */
+#define IDR_TEST_NR	(IDR_COMPACT_SLOTS * 4)
+static struct node nodes[IDR_TEST_NR];
+
+static int idr_check(int cond, const char *what)
+{
+	if (!cond)
+		printf("IDR check failed: %s\n", what);
+	return !cond;
+}
+
+/*
+ * find and remove on either side of the switch from the flat array to
+ * the radix tree, and back once the tree is empty again. The IDR lives
+ * on a dirty heap so that stale slots would show up.
+ */
+static int idr_compact_check(void)
+{
+	struct idr *idr;
+	int i, err = 0;
+
+	idr = malloc(sizeof(*idr));
+	if (!idr)
+		return 1;
+	memset(idr, 0xab, sizeof(*idr));
+	idr_init(idr);
+
+	err |= idr_check(idr_find(idr, 3) == NULL, "find on a new IDR");
+	err |= idr_check(idr_remove(idr, 3) == NULL, "remove on a new IDR");
+
+	/* fill the flat array, leaving a hole */
+	for (i = 0; i < IDR_COMPACT_SLOTS; i++)
+		err |= idr_check(idr_alloc(idr, &nodes[i], i, i + 1,
+				GFP_KERNEL) == i, "compact alloc");
+	idr_remove(idr, 5);
+	err |= idr_check(idr_find(idr, 5) == NULL, "find removed, compact");
+	err |= idr_check(idr_find(idr, 6) == &nodes[6], "find, compact");
+
+	/* one past the array moves everything into the tree */
+	for (i = IDR_COMPACT_SLOTS; i < IDR_TEST_NR; i++)
+		err |= idr_check(idr_alloc(idr, &nodes[i], i, i + 1,
+				GFP_KERNEL) == i, "tree alloc");
+	err |= idr_check(idr_find(idr, 5) == NULL, "find hole, tree");
+	for (i = 0; i < IDR_TEST_NR; i++)
+		if (i != 5)
+			err |= idr_check(idr_find(idr, i) == &nodes[i],
+					"find, tree");
+	err |= idr_check(idr_find(idr, IDR_TEST_NR) == NULL,
+					"find past end, tree");
+	err |= idr_check(idr_remove(idr, 5) == NULL, "remove hole, tree");
+
+	/* emptying the tree goes back to the flat array */
+	for (i = 0; i < IDR_TEST_NR; i++)
+		if (i != 5)
+			err |= idr_check(idr_remove(idr, i) == &nodes[i],
+					"remove, tree");
+	err |= idr_check(idr_is_empty(idr), "empty after removing all");
+	for (i = 0; i < IDR_TEST_NR; i++)
+		err |= idr_check(idr_find(idr, i) == NULL,
+					"find removed, back to compact");
+	err |= idr_check(idr_alloc(idr, &nodes[1], 1, 2, GFP_KERNEL) == 1,
+					"alloc, back to compact");
+	err |= idr_check(idr_find(idr, 1) == &nodes[1],
+					"find, back to compact");
+	err |= idr_check(idr_find(idr, 0) == NULL,
+					"find unallocated, back to compact");
+	err |= idr_check(idr_remove(idr, 1) == &nodes[1],
+					"remove, back to compact");
+
+	free(idr);
+	return err;
+}
+
 int main()
 {
 	struct node *np;
 	int id;
 
+	if (idr_compact_check())
+		return 1;
+	printf("IDR flat array/radix tree checks passed\n");
+
 	/* preload for idr_alloc() */
 	idr_preload(GFP_KERNEL);
 
@@ -137,7 +137,7 @@ void __bitmap_shift_left(unsigned long *dst, const unsigned long *src,
 		memset(dst, 0, off * sizeof(unsigned long));
 }
 
-int __bitmap_and(unsigned long *dst, const unsigned long *bitmap1,
+static int __bitmap_and_generic(unsigned long *dst, const unsigned long *bitmap1,
 			const unsigned long *bitmap2, unsigned int bits)
 {
 	unsigned int k;
@@ -152,8 +152,9 @@ int __bitmap_and(unsigned long *dst, const unsigned long *bitmap1,
 	return result != 0;
 }
 
-int __bitmap_or(unsigned long *dst, const unsigned long *bitmap1,
-			const unsigned long *bitmap2, unsigned int bits)
+static void __bitmap_or_generic(unsigned long *dst,
+		const unsigned long *bitmap1, const unsigned long *bitmap2,
+		unsigned int bits)
 {
 	unsigned int k;
 	unsigned int nr = BITS_TO_LONGS(bits);
@@ -162,8 +163,9 @@ int __bitmap_or(unsigned long *dst, const unsigned long *bitmap1,
 		dst[k] = bitmap1[k] | bitmap2[k];
 }
 
-void __bitmap_xor(unsigned long *dst, const unsigned long *bitmap1,
-			const unsigned long *bitmap2, unsigned int bits)
+static void __bitmap_xor_generic(unsigned long *dst,
+		const unsigned long *bitmap1, const unsigned long *bitmap2,
+		unsigned int bits)
 {
 	unsigned int k;
 	unsigned int nr = BITS_TO_LONGS(bits);
@@ -172,7 +174,7 @@ void __bitmap_xor(unsigned long *dst, const unsigned long *bitmap1,
 		dst[k] = bitmap1[k] ^ bitmap2[k];
 }
 
-int __bitmap_andnot(unsigned long *dst, const unsigned long *bitmap1,
+static int __bitmap_andnot_generic(unsigned long *dst, const unsigned long *bitmap1,
 			const unsigned long *bitmap2, unsigned int bits)
 {
 	unsigned int k;
@@ -219,7 +221,8 @@ int __bitmap_subset(const unsigned long *bitmap1,
 	return 1;
 }
 
-int __bitmap_weight(const unsigned long *bitmap, unsigned int bits)
+static int __bitmap_weight_generic(const unsigned long *bitmap,
+				   unsigned int bits)
 {
 	unsigned int k, lim = bits / BITS_PER_LONG;
 	int w = 0;
@@ -312,10 +315,72 @@ static inline unsigned long _find_next_bit(const unsigned long *addr1,
 	return min(start + __ffs(tmp), nbits);
 }
 
+const struct bitmap_ops bitmap_generic_ops = {
+	.name		= "generic",
+	.weight		= __bitmap_weight_generic,
+	.and		= __bitmap_and_generic,
+	.or		= __bitmap_or_generic,
+	.xor		= __bitmap_xor_generic,
+	.andnot		= __bitmap_andnot_generic,
+	.find_next	= _find_next_bit,
+};
+
+const struct bitmap_ops *bitmap_ops = &bitmap_generic_ops;
+
+int __bitmap_and(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	if (bits < BITMAP_OPS_MIN_BITS)
+		return __bitmap_and_generic(dst, bitmap1, bitmap2, bits);
+	return bitmap_ops->and(dst, bitmap1, bitmap2, bits);
+}
+
+void __bitmap_or(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	if (bits < BITMAP_OPS_MIN_BITS)
+		__bitmap_or_generic(dst, bitmap1, bitmap2, bits);
+	else
+		bitmap_ops->or(dst, bitmap1, bitmap2, bits);
+}
+
+void __bitmap_xor(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	if (bits < BITMAP_OPS_MIN_BITS)
+		__bitmap_xor_generic(dst, bitmap1, bitmap2, bits);
+	else
+		bitmap_ops->xor(dst, bitmap1, bitmap2, bits);
+}
+
+int __bitmap_andnot(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	if (bits < BITMAP_OPS_MIN_BITS)
+		return __bitmap_andnot_generic(dst, bitmap1, bitmap2, bits);
+	return bitmap_ops->andnot(dst, bitmap1, bitmap2, bits);
+}
+
+int __bitmap_weight(const unsigned long *bitmap, unsigned int bits)
+{
+	if (bits < BITMAP_OPS_MIN_BITS)
+		return __bitmap_weight_generic(bitmap, bits);
+	return bitmap_ops->weight(bitmap, bits);
+}
+
+static inline unsigned long find_next(const unsigned long *addr1,
+		const unsigned long *addr2, unsigned long nbits,
+		unsigned long start, unsigned long invert)
+{
+	if (start >= nbits || nbits - start < BITMAP_OPS_MIN_BITS)
+		return _find_next_bit(addr1, addr2, nbits, start, invert);
+	return bitmap_ops->find_next(addr1, addr2, nbits, start, invert);
+}
+
 unsigned long find_next_zero_bit(const unsigned long *addr, unsigned long size,
 				unsigned long offset)
 {
-	return _find_next_bit(addr, NULL, size, offset, ~0UL);
+	return find_next(addr, NULL, size, offset, ~0UL);
 }
 
 /*
@@ -324,14 +389,14 @@ unsigned long find_next_zero_bit(const unsigned long *addr, unsigned long size,
 unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
 				unsigned long offset)
 {
-	return _find_next_bit(addr, NULL, size, offset, 0UL);
+	return find_next(addr, NULL, size, offset, 0UL);
 }
 
 unsigned long find_next_and_bit(const unsigned long *addr1,
 		const unsigned long *addr2, unsigned long size,
 		unsigned long offset)
 {
-	return _find_next_bit(addr1, addr2, size, offset, 0UL);
+	return find_next(addr1, addr2, size, offset, 0UL);
 }
 
 /*      
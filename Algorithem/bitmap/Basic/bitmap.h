@@ -163,6 +163,7 @@ typedef unsigned int u32;
 typedef unsigned long long u64;
 #define UINT_MAX	(~0U)
 #define ULONG_MAX	(~0UL)
+#define INT_MAX		((int)(~0U >> 1))
 
 #define IS_ALIGNED(x, a)	(((x) & ((typeof(x))(a) - 1)) == 0)
 
@@ -477,7 +478,7 @@ extern void __bitmap_shift_left(unsigned long *dst, const unsigned long *src,
 			unsigned int shift, unsigned int nbits);
 extern int __bitmap_and(unsigned long *dst, const unsigned long *bitmap1,
 			const unsigned long *bitmap2, unsigned int bits);
-extern int __bitmap_or(unsigned long *dst, const unsigned long *bitmap1,
+extern void __bitmap_or(unsigned long *dst, const unsigned long *bitmap1,
 			const unsigned long *bitmap2, unsigned int bits);
 extern void __bitmap_xor(unsigned long *dst, const unsigned long *bitmap1,
 			const unsigned long *bitmap2, unsigned int bits);
@@ -509,6 +510,57 @@ extern unsigned long find_next_and_bit(const unsigned long *addr1,
 extern unsigned long find_last_bit(const unsigned long *addr, 
 		unsigned long size);
 
+/**
+ * bitmap_find_next_zero_area - find a contiguous aligned zero area
+ * @map: The address to base the search on
+ * @size: The bitmap size in bits
+ * @start: The bitnumber to start searching at
+ * @nr: The number of zeroed bits we're looking for
+ * @align_mask: Alignment mask for zero area
+ *
+ * The @align_mask should be one less than a power of 2; the effect is that
+ * the bit offset of all zero areas this function finds is multiples of that
+ * power of 2. A @align_mask of 0 means no alignment is required.
+ */
+static inline unsigned long
+bitmap_find_next_zero_area(unsigned long *map, unsigned long size,
+		unsigned long start, unsigned int nr, unsigned long align_mask)
+{
+	return bitmap_find_next_zero_area_off(map, size, start, nr,
+					      align_mask, 0);
+}
+
+/*
+ * Word loops behind the out-of-line helpers above. bitmap_ops points to
+ * the widest implementation the CPU supports, picked once at startup
+ * from CPUID; maps shorter than BITMAP_OPS_MIN_BITS always take the
+ * generic path, where the indirect call would cost more than it saves.
+ */
+struct bitmap_ops {
+	const char *name;
+	int (*usable)(void);
+	int (*weight)(const unsigned long *bitmap, unsigned int bits);
+	int (*and)(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits);
+	void (*or)(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits);
+	void (*xor)(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits);
+	int (*andnot)(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits);
+	unsigned long (*find_next)(const unsigned long *addr1,
+			const unsigned long *addr2, unsigned long nbits,
+			unsigned long start, unsigned long invert);
+};
+
+#define BITMAP_OPS_MIN_BITS	(4 * BITS_PER_LONG)
+
+extern const struct bitmap_ops bitmap_generic_ops;
+extern const struct bitmap_ops *bitmap_ops;
+/* NULL terminated, generic first */
+extern const struct bitmap_ops *bitmap_ops_table[];
+extern int bitmap_set_ops(const struct bitmap_ops *ops);
+
 static inline int bitmap_and(unsigned long *dst, const unsigned long *src1,
 			const unsigned long *src2, unsigned int nbits)
 {
@@ -0,0 +1,133 @@
+/*
+ * Bitmap performance test, generic vs SSE4.2 vs AVX2 word loops.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* bitmap header */
+#include <bitmap.h>
+
+#define MIN_BITS	(1UL << 10)
+#define MAX_BITS	(1UL << 26)
+/* Bits swept per measurement, whatever the map size */
+#define SWEEP_BITS	(1UL << 32)
+/* One set bit every SPARSE_STRIDE bits for the find_next_bit sweep */
+#define SPARSE_STRIDE	4099
+
+static unsigned long *map1, *map2, *dst, *sparse, *dense;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+/* Run one ops set on an @nbits map, returns a checksum of all results */
+static unsigned long bitmap_sweep(unsigned long nbits, double *t)
+{
+	unsigned long loops = SWEEP_BITS / nbits, i, pos, sum = 0;
+	double start;
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		sum += bitmap_weight(map1, nbits);
+	t[0] = now() - start;
+
+	start = now();
+	for (i = 0; i < loops; i++) {
+		sum += bitmap_and(dst, map1, map2, nbits);
+		sum += bitmap_andnot(dst, map1, map2, nbits);
+		bitmap_or(dst, map1, map2, nbits);
+		bitmap_xor(dst, map1, dst, nbits);
+	}
+	t[1] = now() - start;
+	sum += bitmap_weight(dst, nbits);
+
+	/* Runs of empty words, as in a mostly free ID or page map */
+	start = now();
+	for (i = 0; i < loops; i++) {
+		for_each_set_bit(pos, sparse, nbits)
+			sum += pos;
+		for_each_clear_bit(pos, dense, nbits)
+			sum += pos;
+	}
+	t[2] = now() - start;
+
+	return sum;
+}
+
+int main()
+{
+	const struct bitmap_ops **ops;
+	unsigned long nbits, i, seed = 0x9e3779b97f4a7c15UL;
+	unsigned long size = BITS_TO_LONGS(MAX_BITS) * sizeof(unsigned long);
+
+	map1 = malloc(size);
+	map2 = malloc(size);
+	dst = malloc(size);
+	sparse = calloc(1, size);
+	dense = malloc(size);
+	if (!map1 || !map2 || !dst || !sparse || !dense)
+		return -1;
+
+	for (i = 0; i < BITS_TO_LONGS(MAX_BITS); i++) {
+		map1[i] = xorshift(&seed);
+		map2[i] = xorshift(&seed);
+	}
+	bitmap_fill(dense, MAX_BITS);
+	for (i = 0; i < MAX_BITS; i += SPARSE_STRIDE) {
+		set_bit(i, sparse);
+		clear_bit(i, dense);
+	}
+
+	printf("%-10s %-8s %12s %12s %12s\n", "bits", "ops",
+				"weight", "logic", "find_next");
+	for (nbits = MIN_BITS; nbits <= MAX_BITS; nbits <<= 2) {
+		unsigned long check = 0, sum;
+
+		/* Odd size, so the partial last word is exercised */
+		unsigned long bits = nbits - 3;
+
+		for (ops = bitmap_ops_table; *ops; ops++) {
+			double t[3];
+
+			if (bitmap_set_ops(*ops)) {
+				printf("%-10lu %-8s unsupported\n", bits,
+							(*ops)->name);
+				continue;
+			}
+			sum = bitmap_sweep(bits, t);
+			if (ops == bitmap_ops_table)
+				check = sum;
+			printf("%-10lu %-8s %10.1fms %10.1fms %10.1fms%s\n",
+				bits, (*ops)->name, t[0] * 1e3, t[1] * 1e3,
+				t[2] * 1e3, sum == check ? "" : " MISMATCH");
+		}
+	}
+
+	free(map1);
+	free(map2);
+	free(dst);
+	free(sparse);
+	free(dense);
+	return 0;
+}
@@ -0,0 +1,455 @@
+/*
+ * SSE4.2 and AVX2 versions of the bitmap word loops.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each kernel is built with a target() attribute rather than global
+ * -m flags, so the same binary still runs the generic code on CPUs
+ * without the extensions. bitmap_ops_init() picks the widest usable
+ * set from CPUID before main() runs.
+ */
+#include <bitmap.h>
+#include <errno.h>
+
+#if defined(__x86_64__) && BITS_PER_LONG == 64
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define XCR0_SSE	(1UL << 1)
+#define XCR0_AVX	(1UL << 2)
+
+static unsigned long xgetbv(unsigned int index)
+{
+	unsigned int eax, edx;
+
+	asm volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (index));
+	return eax | ((unsigned long)edx << 32);
+}
+
+static int cpu_has_sse42(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	return (ecx & bit_SSE4_2) && (ecx & bit_POPCNT);
+}
+
+static int cpu_has_avx2(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!cpu_has_sse42())
+		return 0;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	/* The OS must save the YMM state too */
+	if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+		return 0;
+	if ((xgetbv(0) & (XCR0_SSE | XCR0_AVX)) != (XCR0_SSE | XCR0_AVX))
+		return 0;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+	return !!(ebx & bit_AVX2);
+}
+
+/*
+ * Scalar tail shared by the vector find_next loops, from word @idx on.
+ */
+static inline unsigned long find_next_tail(const unsigned long *addr1,
+		const unsigned long *addr2, unsigned long nbits,
+		unsigned long idx, unsigned long invert)
+{
+	unsigned long tmp;
+
+	for (; idx < BITS_TO_LONGS(nbits); idx++) {
+		tmp = addr1[idx];
+		if (addr2)
+			tmp &= addr2[idx];
+		tmp ^= invert;
+		if (tmp)
+			return min(idx * BITS_PER_LONG + __ffs(tmp), nbits);
+	}
+	return nbits;
+}
+
+/* First word of find_next, returns nbits if it has nothing */
+static inline unsigned long find_next_head(const unsigned long *addr1,
+		const unsigned long *addr2, unsigned long nbits,
+		unsigned long start, unsigned long invert)
+{
+	unsigned long idx = start / BITS_PER_LONG;
+	unsigned long tmp = addr1[idx];
+
+	if (addr2)
+		tmp &= addr2[idx];
+	tmp = (tmp ^ invert) & BITMAP_FIRST_WORD_MASK(start);
+	if (tmp)
+		return min(idx * BITS_PER_LONG + __ffs(tmp), nbits);
+	return nbits;
+}
+
+/* SSE4.2: POPCNT and 128-bit logical ops, two words per vector */
+
+__attribute__((target("popcnt")))
+static int bitmap_weight_sse42(const unsigned long *bitmap, unsigned int bits)
+{
+	unsigned int k, lim = bits / BITS_PER_LONG;
+	unsigned long w0 = 0, w1 = 0, w2 = 0, w3 = 0;
+
+	/* Independent sums, so the POPCNTs overlap */
+	for (k = 0; k + 4 <= lim; k += 4) {
+		w0 += _mm_popcnt_u64(bitmap[k]);
+		w1 += _mm_popcnt_u64(bitmap[k + 1]);
+		w2 += _mm_popcnt_u64(bitmap[k + 2]);
+		w3 += _mm_popcnt_u64(bitmap[k + 3]);
+	}
+	for (; k < lim; k++)
+		w0 += _mm_popcnt_u64(bitmap[k]);
+	if (bits % BITS_PER_LONG)
+		w0 += _mm_popcnt_u64(bitmap[k] & BITMAP_LAST_WORD_MASK(bits));
+
+	return w0 + w1 + w2 + w3;
+}
+
+__attribute__((target("sse4.2")))
+static int bitmap_and_sse42(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	unsigned int k, lim = bits / BITS_PER_LONG;
+	__m128i acc = _mm_setzero_si128();
+	unsigned long result = 0;
+
+	for (k = 0; k + 2 <= lim; k += 2) {
+		__m128i v = _mm_and_si128(
+			_mm_loadu_si128((const __m128i *)&bitmap1[k]),
+			_mm_loadu_si128((const __m128i *)&bitmap2[k]));
+
+		_mm_storeu_si128((__m128i *)&dst[k], v);
+		acc = _mm_or_si128(acc, v);
+	}
+	for (; k < lim; k++)
+		result |= (dst[k] = bitmap1[k] & bitmap2[k]);
+	if (bits % BITS_PER_LONG)
+		result |= (dst[k] = bitmap1[k] & bitmap2[k] &
+				BITMAP_LAST_WORD_MASK(bits));
+	return result || !_mm_testz_si128(acc, acc);
+}
+
+__attribute__((target("sse4.2")))
+static void bitmap_or_sse42(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	unsigned int k, nr = BITS_TO_LONGS(bits);
+
+	for (k = 0; k + 2 <= nr; k += 2)
+		_mm_storeu_si128((__m128i *)&dst[k], _mm_or_si128(
+			_mm_loadu_si128((const __m128i *)&bitmap1[k]),
+			_mm_loadu_si128((const __m128i *)&bitmap2[k])));
+	for (; k < nr; k++)
+		dst[k] = bitmap1[k] | bitmap2[k];
+}
+
+__attribute__((target("sse4.2")))
+static void bitmap_xor_sse42(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	unsigned int k, nr = BITS_TO_LONGS(bits);
+
+	for (k = 0; k + 2 <= nr; k += 2)
+		_mm_storeu_si128((__m128i *)&dst[k], _mm_xor_si128(
+			_mm_loadu_si128((const __m128i *)&bitmap1[k]),
+			_mm_loadu_si128((const __m128i *)&bitmap2[k])));
+	for (; k < nr; k++)
+		dst[k] = bitmap1[k] ^ bitmap2[k];
+}
+
+__attribute__((target("sse4.2")))
+static int bitmap_andnot_sse42(unsigned long *dst,
+		const unsigned long *bitmap1, const unsigned long *bitmap2,
+		unsigned int bits)
+{
+	unsigned int k, lim = bits / BITS_PER_LONG;
+	__m128i acc = _mm_setzero_si128();
+	unsigned long result = 0;
+
+	for (k = 0; k + 2 <= lim; k += 2) {
+		/* andnot takes the complemented operand first */
+		__m128i v = _mm_andnot_si128(
+			_mm_loadu_si128((const __m128i *)&bitmap2[k]),
+			_mm_loadu_si128((const __m128i *)&bitmap1[k]));
+
+		_mm_storeu_si128((__m128i *)&dst[k], v);
+		acc = _mm_or_si128(acc, v);
+	}
+	for (; k < lim; k++)
+		result |= (dst[k] = bitmap1[k] & ~bitmap2[k]);
+	if (bits % BITS_PER_LONG)
+		result |= (dst[k] = bitmap1[k] & ~bitmap2[k] &
+				BITMAP_LAST_WORD_MASK(bits));
+	return result || !_mm_testz_si128(acc, acc);
+}
+
+/*
+ * Skip four words per iteration while they hold nothing, then let the
+ * scalar tail find the bit.
+ */
+__attribute__((target("sse4.2")))
+static unsigned long find_next_bit_sse42(const unsigned long *addr1,
+		const unsigned long *addr2, unsigned long nbits,
+		unsigned long start, unsigned long invert)
+{
+	unsigned long idx, nr = BITS_TO_LONGS(nbits);
+	unsigned long ret;
+	__m128i ones = _mm_set1_epi32(-1);
+
+	ret = find_next_head(addr1, addr2, nbits, start, invert);
+	if (ret < nbits)
+		return ret;
+
+	for (idx = start / BITS_PER_LONG + 1; idx + 4 <= nr; idx += 4) {
+		__m128i v0 = _mm_loadu_si128((const __m128i *)&addr1[idx]);
+		__m128i v1 = _mm_loadu_si128((const __m128i *)&addr1[idx + 2]);
+
+		if (addr2) {
+			v0 = _mm_and_si128(v0, _mm_loadu_si128(
+					(const __m128i *)&addr2[idx]));
+			v1 = _mm_and_si128(v1, _mm_loadu_si128(
+					(const __m128i *)&addr2[idx + 2]));
+		}
+		if (invert) {
+			if (!_mm_testc_si128(_mm_and_si128(v0, v1), ones))
+				break;
+		} else {
+			v0 = _mm_or_si128(v0, v1);
+			if (!_mm_testz_si128(v0, v0))
+				break;
+		}
+	}
+	return find_next_tail(addr1, addr2, nbits, idx, invert);
+}
+
+static const struct bitmap_ops bitmap_sse42_ops = {
+	.name		= "sse4.2",
+	.usable		= cpu_has_sse42,
+	.weight		= bitmap_weight_sse42,
+	.and		= bitmap_and_sse42,
+	.or		= bitmap_or_sse42,
+	.xor		= bitmap_xor_sse42,
+	.andnot		= bitmap_andnot_sse42,
+	.find_next	= find_next_bit_sse42,
+};
+
+/* AVX2: four words per vector */
+
+/*
+ * Per-nibble lookup through VPSHUFB, summed to 64-bit lanes by VPSADBW.
+ * Beats four POPCNTs once the map is more than a few lines long.
+ */
+__attribute__((target("avx2,popcnt")))
+static int bitmap_weight_avx2(const unsigned long *bitmap, unsigned int bits)
+{
+	unsigned int k, lim = bits / BITS_PER_LONG;
+	const __m256i lookup = _mm256_setr_epi8(
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i acc = _mm256_setzero_si256();
+	unsigned long w;
+
+	for (k = 0; k + 8 <= lim; k += 8) {
+		__m256i v0 = _mm256_loadu_si256((const __m256i *)&bitmap[k]);
+		__m256i v1 = _mm256_loadu_si256(
+					(const __m256i *)&bitmap[k + 4]);
+		__m256i c0, c1;
+
+		c0 = _mm256_add_epi8(
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(v0, low)),
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(
+				_mm256_srli_epi16(v0, 4), low)));
+		c1 = _mm256_add_epi8(
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(v1, low)),
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(
+				_mm256_srli_epi16(v1, 4), low)));
+		/* At most 16 per byte, no overflow */
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(
+			_mm256_add_epi8(c0, c1), _mm256_setzero_si256()));
+	}
+	w = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+	    _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+
+	for (; k < lim; k++)
+		w += _mm_popcnt_u64(bitmap[k]);
+	if (bits % BITS_PER_LONG)
+		w += _mm_popcnt_u64(bitmap[k] & BITMAP_LAST_WORD_MASK(bits));
+
+	return w;
+}
+
+__attribute__((target("avx2")))
+static int bitmap_and_avx2(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	unsigned int k, lim = bits / BITS_PER_LONG;
+	__m256i acc = _mm256_setzero_si256();
+	unsigned long result = 0;
+
+	for (k = 0; k + 4 <= lim; k += 4) {
+		__m256i v = _mm256_and_si256(
+			_mm256_loadu_si256((const __m256i *)&bitmap1[k]),
+			_mm256_loadu_si256((const __m256i *)&bitmap2[k]));
+
+		_mm256_storeu_si256((__m256i *)&dst[k], v);
+		acc = _mm256_or_si256(acc, v);
+	}
+	for (; k < lim; k++)
+		result |= (dst[k] = bitmap1[k] & bitmap2[k]);
+	if (bits % BITS_PER_LONG)
+		result |= (dst[k] = bitmap1[k] & bitmap2[k] &
+				BITMAP_LAST_WORD_MASK(bits));
+	return result || !_mm256_testz_si256(acc, acc);
+}
+
+__attribute__((target("avx2")))
+static void bitmap_or_avx2(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	unsigned int k, nr = BITS_TO_LONGS(bits);
+
+	for (k = 0; k + 4 <= nr; k += 4)
+		_mm256_storeu_si256((__m256i *)&dst[k], _mm256_or_si256(
+			_mm256_loadu_si256((const __m256i *)&bitmap1[k]),
+			_mm256_loadu_si256((const __m256i *)&bitmap2[k])));
+	for (; k < nr; k++)
+		dst[k] = bitmap1[k] | bitmap2[k];
+}
+
+__attribute__((target("avx2")))
+static void bitmap_xor_avx2(unsigned long *dst, const unsigned long *bitmap1,
+			const unsigned long *bitmap2, unsigned int bits)
+{
+	unsigned int k, nr = BITS_TO_LONGS(bits);
+
+	for (k = 0; k + 4 <= nr; k += 4)
+		_mm256_storeu_si256((__m256i *)&dst[k], _mm256_xor_si256(
+			_mm256_loadu_si256((const __m256i *)&bitmap1[k]),
+			_mm256_loadu_si256((const __m256i *)&bitmap2[k])));
+	for (; k < nr; k++)
+		dst[k] = bitmap1[k] ^ bitmap2[k];
+}
+
+__attribute__((target("avx2")))
+static int bitmap_andnot_avx2(unsigned long *dst,
+		const unsigned long *bitmap1, const unsigned long *bitmap2,
+		unsigned int bits)
+{
+	unsigned int k, lim = bits / BITS_PER_LONG;
+	__m256i acc = _mm256_setzero_si256();
+	unsigned long result = 0;
+
+	for (k = 0; k + 4 <= lim; k += 4) {
+		__m256i v = _mm256_andnot_si256(
+			_mm256_loadu_si256((const __m256i *)&bitmap2[k]),
+			_mm256_loadu_si256((const __m256i *)&bitmap1[k]));
+
+		_mm256_storeu_si256((__m256i *)&dst[k], v);
+		acc = _mm256_or_si256(acc, v);
+	}
+	for (; k < lim; k++)
+		result |= (dst[k] = bitmap1[k] & ~bitmap2[k]);
+	if (bits % BITS_PER_LONG)
+		result |= (dst[k] = bitmap1[k] & ~bitmap2[k] &
+				BITMAP_LAST_WORD_MASK(bits));
+	return result || !_mm256_testz_si256(acc, acc);
+}
+
+/* Same as find_next_bit_sse42(), eight words per iteration */
+__attribute__((target("avx2")))
+static unsigned long find_next_bit_avx2(const unsigned long *addr1,
+		const unsigned long *addr2, unsigned long nbits,
+		unsigned long start, unsigned long invert)
+{
+	unsigned long idx, nr = BITS_TO_LONGS(nbits);
+	unsigned long ret;
+	__m256i ones = _mm256_set1_epi32(-1);
+
+	ret = find_next_head(addr1, addr2, nbits, start, invert);
+	if (ret < nbits)
+		return ret;
+
+	for (idx = start / BITS_PER_LONG + 1; idx + 8 <= nr; idx += 8) {
+		__m256i v0 = _mm256_loadu_si256((const __m256i *)&addr1[idx]);
+		__m256i v1 = _mm256_loadu_si256(
+					(const __m256i *)&addr1[idx + 4]);
+
+		if (addr2) {
+			v0 = _mm256_and_si256(v0, _mm256_loadu_si256(
+					(const __m256i *)&addr2[idx]));
+			v1 = _mm256_and_si256(v1, _mm256_loadu_si256(
+					(const __m256i *)&addr2[idx + 4]));
+		}
+		if (invert) {
+			if (!_mm256_testc_si256(_mm256_and_si256(v0, v1), ones))
+				break;
+		} else {
+			v0 = _mm256_or_si256(v0, v1);
+			if (!_mm256_testz_si256(v0, v0))
+				break;
+		}
+	}
+	return find_next_tail(addr1, addr2, nbits, idx, invert);
+}
+
+static const struct bitmap_ops bitmap_avx2_ops = {
+	.name		= "avx2",
+	.usable		= cpu_has_avx2,
+	.weight		= bitmap_weight_avx2,
+	.and		= bitmap_and_avx2,
+	.or		= bitmap_or_avx2,
+	.xor		= bitmap_xor_avx2,
+	.andnot		= bitmap_andnot_avx2,
+	.find_next	= find_next_bit_avx2,
+};
+
+const struct bitmap_ops *bitmap_ops_table[] = {
+	&bitmap_generic_ops,
+	&bitmap_sse42_ops,
+	&bitmap_avx2_ops,
+	NULL,
+};
+
+#else /* !__x86_64__ */
+
+const struct bitmap_ops *bitmap_ops_table[] = {
+	&bitmap_generic_ops,
+	NULL,
+};
+
+#endif
+
+/*
+ * bitmap_set_ops - switch the out-of-line helpers to @ops
+ *
+ * Returns -ENODEV if the CPU lacks the instructions @ops needs.
+ */
+int bitmap_set_ops(const struct bitmap_ops *ops)
+{
+	if (ops->usable && !ops->usable())
+		return -ENODEV;
+	bitmap_ops = ops;
+	return 0;
+}
+
+/* Widest usable set, the table is ordered from narrow to wide */
+__attribute__((constructor))
+static void bitmap_ops_init(void)
+{
+	const struct bitmap_ops **ops;
+
+	for (ops = bitmap_ops_table; *ops; ops++)
+		bitmap_set_ops(*ops);
+}
@@ -0,0 +1,211 @@
+/*
+ * Hierarchical bitmap.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdlib.h>
+#include <errno.h>
+
+#include <hbitmap.h>
+
+/*
+ * hbitmap_init - allocate an all-zero bitmap of @nbits bits
+ *
+ * The helpers underneath take int lengths, so @nbits is capped at
+ * INT_MAX.
+ */
+int hbitmap_init(struct hbitmap *hb, unsigned long nbits)
+{
+	unsigned long words = 0, *map;
+	unsigned int level;
+
+	if (!nbits || nbits > INT_MAX)
+		return -EINVAL;
+
+	hb->nbits = nbits;
+	hb->size[0] = nbits;
+	for (level = 0; hb->size[level] > BITS_PER_LONG; level++)
+		hb->size[level + 1] = BITS_TO_LONGS(hb->size[level]);
+	hb->levels = level + 1;
+
+	for (level = 0; level < hb->levels; level++)
+		words += BITS_TO_LONGS(hb->size[level]);
+	map = calloc(words, sizeof(unsigned long));
+	if (!map)
+		return -ENOMEM;
+
+	/* Every word has a zero bit */
+	for (level = 0; level < hb->levels; level++) {
+		hb->map[level] = map;
+		if (level)
+			__bitmap_set(map, 0, hb->size[level]);
+		map += BITS_TO_LONGS(hb->size[level]);
+	}
+	return 0;
+}
+
+void hbitmap_free(struct hbitmap *hb)
+{
+	free(hb->map[0]);
+	hb->map[0] = NULL;
+}
+
+/* Does word @idx of level 0 have a zero bit below nbits */
+static inline int hbitmap_word_has_zero(const struct hbitmap *hb,
+					unsigned long idx)
+{
+	unsigned long word = hb->map[0][idx];
+
+	if (idx == BIT_WORD(hb->nbits - 1))
+		word |= ~BITMAP_LAST_WORD_MASK(hb->nbits);
+	return word != ~0UL;
+}
+
+/* Recompute bit @idx of @level from the word below it */
+static inline void hbitmap_update_bit(struct hbitmap *hb,
+			unsigned int level, unsigned long idx)
+{
+	int has;
+
+	if (level == 1)
+		has = hbitmap_word_has_zero(hb, idx);
+	else
+		has = hb->map[level - 1][idx] != 0;
+
+	if (has)
+		__set_bit(idx, hb->map[level]);
+	else
+		__clear_bit(idx, hb->map[level]);
+}
+
+/*
+ * hbitmap_set - set @len bits from @start and update the summaries
+ *
+ * Level 0 words fully covered by the range are now full, so their
+ * summary bits are cleared in one go; the two edge words and all
+ * upper levels are recomputed.
+ */
+void hbitmap_set(struct hbitmap *hb, unsigned long start, unsigned long len)
+{
+	unsigned long end = start + len;
+	unsigned long lo, hi, first, last, idx;
+	unsigned int level;
+
+	if (!len)
+		return;
+	__bitmap_set(hb->map[0], start, len);
+	if (hb->levels == 1)
+		return;
+
+	lo = BIT_WORD(start);
+	hi = BIT_WORD(end - 1);
+	first = (start % BITS_PER_LONG) ? lo + 1 : lo;
+	last = (end % BITS_PER_LONG) ? hi : hi + 1;
+	if (first < last)
+		__bitmap_clear(hb->map[1], first, last - first);
+	hbitmap_update_bit(hb, 1, lo);
+	hbitmap_update_bit(hb, 1, hi);
+
+	for (level = 2; level < hb->levels; level++) {
+		lo = BIT_WORD(lo);
+		hi = BIT_WORD(hi);
+		for (idx = lo; idx <= hi; idx++)
+			hbitmap_update_bit(hb, level, idx);
+	}
+}
+
+/*
+ * hbitmap_clear - clear @len bits from @start and update the summaries
+ *
+ * Every word the range touches now has a zero, and so has every block
+ * above it.
+ */
+void hbitmap_clear(struct hbitmap *hb, unsigned long start,
+		   unsigned long len)
+{
+	unsigned long lo = start, hi = start + len - 1;
+	unsigned int level;
+
+	if (!len)
+		return;
+	__bitmap_clear(hb->map[0], start, len);
+
+	for (level = 1; level < hb->levels; level++) {
+		lo = BIT_WORD(lo);
+		hi = BIT_WORD(hi);
+		__bitmap_set(hb->map[level], lo, hi - lo + 1);
+	}
+}
+
+/*
+ * hbitmap_find_next_zero_bit - find the next zero bit from @start
+ *
+ * Climbs the summary levels until a block with a zero bit shows up
+ * after @start, then walks back down to it. Returns nbits if there is
+ * no zero bit.
+ */
+unsigned long hbitmap_find_next_zero_bit(const struct hbitmap *hb,
+					 unsigned long start)
+{
+	unsigned long pos, word;
+	unsigned int level;
+
+	if (start >= hb->nbits)
+		return hb->nbits;
+
+	pos = BIT_WORD(start);
+	word = ~hb->map[0][pos] & BITMAP_FIRST_WORD_MASK(start);
+	if (word)
+		return min(pos * BITS_PER_LONG + __ffs(word), hb->nbits);
+
+	/* pos is now a bit index of the level being searched */
+	pos++;
+	for (level = 1; ; level++) {
+		if (level >= hb->levels || pos >= hb->size[level])
+			return hb->nbits;
+		word = hb->map[level][BIT_WORD(pos)] &
+					BITMAP_FIRST_WORD_MASK(pos);
+		if (word) {
+			pos = round_down(pos, BITS_PER_LONG) + __ffs(word);
+			break;
+		}
+		pos = BIT_WORD(pos) + 1;
+	}
+
+	for (; level > 1; level--)
+		pos = pos * BITS_PER_LONG + __ffs(hb->map[level - 1][pos]);
+
+	return min(pos * BITS_PER_LONG + __ffs(~hb->map[0][pos]), hb->nbits);
+}
+
+/*
+ * hbitmap_find_next_zero_area_off - find a contiguous aligned zero area
+ *
+ * Same as bitmap_find_next_zero_area_off(), but the restart after
+ * each collision skips full regions through the summaries.
+ */
+unsigned long hbitmap_find_next_zero_area_off(const struct hbitmap *hb,
+		unsigned long start, unsigned int nr,
+		unsigned long align_mask, unsigned long align_offset)
+{
+	unsigned long index, end, i;
+again:
+	index = hbitmap_find_next_zero_bit(hb, start);
+
+	/* Align allocation */
+	index = __ALIGN_MASK(index + align_offset, align_mask) - align_offset;
+
+	end = index + nr;
+	if (end > hb->nbits)
+		return end;
+	i = find_next_bit(hb->map[0], end, index);
+	if (i < end) {
+		start = i + 1;
+		goto again;
+	}
+	return index;
+}
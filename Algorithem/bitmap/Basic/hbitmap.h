@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _HBITMAP_H_
+#define _HBITMAP_H_
+/*
+ * Hierarchical bitmap: a plain bitmap plus summary levels so that
+ * zero searches skip full regions.
+ *
+ * Level 0 is the bitmap itself. Bit j of level 1 is set if word j of
+ * level 0 has a zero bit. Above that, bit j of level n + 1 is set if
+ * word j of level n is non-zero, i.e. if the 64-word block below it
+ * has a zero bit somewhere. The top level fits in one word, so a search
+ * climbs and descends at most HBITMAP_MAX_LEVELS words.
+ */
+#include <bitmap.h>
+
+#define HBITMAP_MAX_LEVELS	8
+
+struct hbitmap {
+	unsigned long nbits;
+	unsigned int levels;
+	/* Number of bits in each level, size[0] == nbits */
+	unsigned long size[HBITMAP_MAX_LEVELS];
+	unsigned long *map[HBITMAP_MAX_LEVELS];
+};
+
+extern int hbitmap_init(struct hbitmap *hb, unsigned long nbits);
+extern void hbitmap_free(struct hbitmap *hb);
+extern void hbitmap_set(struct hbitmap *hb, unsigned long start,
+			unsigned long len);
+extern void hbitmap_clear(struct hbitmap *hb, unsigned long start,
+			unsigned long len);
+extern unsigned long hbitmap_find_next_zero_bit(const struct hbitmap *hb,
+			unsigned long start);
+extern unsigned long hbitmap_find_next_zero_area_off(const struct hbitmap *hb,
+			unsigned long start, unsigned int nr,
+			unsigned long align_mask, unsigned long align_offset);
+
+static inline unsigned long
+hbitmap_find_next_zero_area(const struct hbitmap *hb, unsigned long start,
+			unsigned int nr, unsigned long align_mask)
+{
+	return hbitmap_find_next_zero_area_off(hb, start, nr, align_mask, 0);
+}
+
+static inline int hbitmap_test_bit(const struct hbitmap *hb,
+				   unsigned long nr)
+{
+	return test_bit(nr, hb->map[0]);
+}
+
+#endif
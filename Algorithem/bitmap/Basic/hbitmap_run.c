@@ -0,0 +1,125 @@
+/*
+ * Hierarchical bitmap Manual.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * First-fit allocation of zero areas from a 64M-bit map which is almost
+ * full, once with the plain bitmap and once with hbitmap. Every search
+ * starts over from bit 0, as bitmap_find_free_region() does.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* bitmap header */
+#include <hbitmap.h>
+
+#define NR_BITS		(1UL << 26)
+/* One free bit every FREE_STRIDE bits, one free run every RUN_STRIDE */
+#define FREE_STRIDE	65521
+#define RUN_STRIDE	(1UL << 20)
+#define RUN_BITS	256
+#define AREA_BITS	16
+#define AREA_ALIGN	(AREA_BITS - 1)
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main()
+{
+	struct hbitmap hb;
+	unsigned long *map, pos, nr_plain = 0, nr_hb = 0, sum_plain = 0;
+	unsigned long sum_hb = 0;
+	double start, t_plain, t_hb;
+
+	map = malloc(BITS_TO_LONGS(NR_BITS) * sizeof(unsigned long));
+	if (!map || hbitmap_init(&hb, NR_BITS))
+		return -1;
+
+	/* Same almost-full layout in both */
+	bitmap_fill(map, NR_BITS);
+	hbitmap_set(&hb, 0, NR_BITS);
+	for (pos = 0; pos < NR_BITS; pos += FREE_STRIDE) {
+		bitmap_clear(map, pos, 1);
+		hbitmap_clear(&hb, pos, 1);
+	}
+	for (pos = RUN_STRIDE / 2; pos < NR_BITS; pos += RUN_STRIDE) {
+		bitmap_clear(map, pos, RUN_BITS);
+		hbitmap_clear(&hb, pos, RUN_BITS);
+	}
+
+	/* Single bits, as an ID allocator would ask for */
+	start = now();
+	for (;;) {
+		pos = bitmap_find_next_zero_area(map, NR_BITS, 0, 1, 0);
+		if (pos >= NR_BITS)
+			break;
+		bitmap_set(map, pos, 1);
+		sum_plain += pos;
+		nr_plain++;
+	}
+	t_plain = now() - start;
+
+	start = now();
+	for (;;) {
+		pos = hbitmap_find_next_zero_area(&hb, 0, 1, 0);
+		if (pos >= NR_BITS)
+			break;
+		hbitmap_set(&hb, pos, 1);
+		sum_hb += pos;
+		nr_hb++;
+	}
+	t_hb = now() - start;
+
+	printf("1-bit areas:  bitmap %lu in %.3fs, hbitmap %lu in %.3fs%s\n",
+			nr_plain, t_plain, nr_hb, t_hb,
+			sum_plain == sum_hb ? "" : " MISMATCH");
+
+	/* Free the runs again and take aligned areas out of them */
+	for (pos = RUN_STRIDE / 2; pos < NR_BITS; pos += RUN_STRIDE) {
+		bitmap_clear(map, pos, RUN_BITS);
+		hbitmap_clear(&hb, pos, RUN_BITS);
+	}
+	nr_plain = nr_hb = sum_plain = sum_hb = 0;
+
+	start = now();
+	for (;;) {
+		pos = bitmap_find_next_zero_area(map, NR_BITS, 0,
+						 AREA_BITS, AREA_ALIGN);
+		if (pos >= NR_BITS)
+			break;
+		bitmap_set(map, pos, AREA_BITS);
+		sum_plain += pos;
+		nr_plain++;
+	}
+	t_plain = now() - start;
+
+	start = now();
+	for (;;) {
+		pos = hbitmap_find_next_zero_area(&hb, 0, AREA_BITS,
+						  AREA_ALIGN);
+		if (pos >= NR_BITS)
+			break;
+		hbitmap_set(&hb, pos, AREA_BITS);
+		sum_hb += pos;
+		nr_hb++;
+	}
+	t_hb = now() - start;
+
+	printf("%d-bit areas: bitmap %lu in %.3fs, hbitmap %lu in %.3fs%s\n",
+			AREA_BITS, nr_plain, t_plain, nr_hb, t_hb,
+			sum_plain == sum_hb ? "" : " MISMATCH");
+
+	hbitmap_free(&hb);
+	free(map);
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Word-at-a-time name hashing.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include "stringhash.h"
+
+#define GOLDEN_RATIO_64		0x61C8864680B583EBull
+
+static inline unsigned long rol64(unsigned long word, unsigned int shift)
+{
+	return (word << (shift & 63)) | (word >> ((-shift) & 63));
+}
+
+/*
+ * Mix one word of name into the two-word state. Same as the 32-bit
+ * HASH_MIX demo, with 64-bit rotates: good enough for hash tables,
+ * not a cryptographic hash.
+ */
+#define HASH_MIX(x, y, a)	\
+	(	x ^= (a),	\
+	y ^= x,	x = rol64(x, 12),\
+	x += y,	y = rol64(y, 45),\
+	y *= 9			)
+
+/* Fold the two-word state down to 32 bits */
+static inline unsigned int fold_hash(unsigned long x, unsigned long y)
+{
+	y ^= x * GOLDEN_RATIO_64;
+	y *= GOLDEN_RATIO_64;
+	return y >> 32;
+}
+
+/*
+ * full_name_hash - hash @len bytes of @name
+ *
+ * The name need not be NUL terminated; the tail word is loaded without
+ * leaving the page and masked down to @len.
+ */
+unsigned int full_name_hash(const void *salt, const char *name,
+			    unsigned int len)
+{
+	unsigned long a, x = 0, y = (unsigned long)salt;
+
+	for (;;) {
+		if (!len)
+			goto done;
+		if (len < sizeof(unsigned long))
+			break;
+		memcpy(&a, name, sizeof(a));
+		HASH_MIX(x, y, a);
+		name += sizeof(unsigned long);
+		len -= sizeof(unsigned long);
+	}
+	a = load_bytes_zeropad(name, len);
+	x ^= a & bytemask_from_count(len);
+done:
+	return fold_hash(x, y);
+}
+
+/* hashlen_string - hash and length of a NUL terminated string */
+uint64_t hashlen_string(const void *salt, const char *name)
+{
+	unsigned long a = 0, x = 0, y = (unsigned long)salt;
+	unsigned long adata, mask, len;
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+
+	len = 0;
+	goto inside;
+
+	do {
+		HASH_MIX(x, y, a);
+		len += sizeof(unsigned long);
+inside:
+		a = load_unaligned_zeropad(name + len);
+	} while (!has_zero(a, &adata, &constants));
+
+	adata = prep_zero_mask(a, adata, &constants);
+	mask = create_zero_mask(adata);
+	x ^= a & zero_bytemask(mask);
+
+	return hashlen_create(fold_hash(x, y), len + find_zero(mask));
+}
+
+/*
+ * hash_name - hash and length of one path component
+ *
+ * The component ends at the first '/' or NUL. The '/' test is the same
+ * zero-byte test on the word xor'ed with a word of '/'s, so both
+ * terminators cost one extra subtract-and-mask per word.
+ */
+uint64_t hash_name(const void *salt, const char *name)
+{
+	unsigned long a = 0, b, x = 0, y = (unsigned long)salt;
+	unsigned long adata, bdata, mask, len;
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+
+	len = 0;
+	goto inside;
+
+	do {
+		HASH_MIX(x, y, a);
+		len += sizeof(unsigned long);
+inside:
+		a = load_unaligned_zeropad(name + len);
+		b = a ^ REPEAT_BYTE('/');
+	} while (!(has_zero(a, &adata, &constants) |
+		   has_zero(b, &bdata, &constants)));
+
+	adata = prep_zero_mask(a, adata, &constants);
+	bdata = prep_zero_mask(b, bdata, &constants);
+	mask = create_zero_mask(adata | bdata);
+	x ^= a & zero_bytemask(mask);
+
+	return hashlen_create(fold_hash(x, y), len + find_zero(mask));
+}
+
+/*
+ * name_cmp - compare @tcount bytes of two names, as dentry_string_cmp()
+ *
+ * Returns 0 if equal, 1 otherwise; there is no ordering. The caller
+ * has already matched the lengths (and usually the hashes), so this is
+ * the last check and is expected to succeed.
+ */
+int name_cmp(const char *cs, const char *ct, unsigned int tcount)
+{
+	unsigned long a, b;
+
+	while (tcount >= sizeof(unsigned long)) {
+		memcpy(&a, cs, sizeof(a));
+		memcpy(&b, ct, sizeof(b));
+		if (unlikely(a != b))
+			return 1;
+		cs += sizeof(unsigned long);
+		ct += sizeof(unsigned long);
+		tcount -= sizeof(unsigned long);
+	}
+	if (!tcount)
+		return 0;
+	a = load_bytes_zeropad(cs, tcount);
+	b = load_bytes_zeropad(ct, tcount);
+	return unlikely(!!((a ^ b) & bytemask_from_count(tcount)));
+}
+
+/* word_strlen - strlen() on the zero-byte primitives */
+unsigned long word_strlen(const char *s)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	unsigned long a, data, len = 0;
+
+	for (;;) {
+		a = load_unaligned_zeropad(s + len);
+		if (has_zero(a, &data, &constants))
+			break;
+		len += sizeof(unsigned long);
+	}
+	data = prep_zero_mask(a, data, &constants);
+	return len + find_zero(create_zero_mask(data));
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _STRINGHASH_H
+#define _STRINGHASH_H
+/*
+ * Word-at-a-time name hashing, userspace port of the
+ * DCACHE_WORD_ACCESS half of fs/namei.c and fs/dcache.c.
+ *
+ * A "hashlen" packs the 32-bit hash in the low half and the name length
+ * in the high half, so hash_name() can hand both back in one register.
+ */
+#include <stdint.h>
+
+#include "word-at-a-time.h"
+
+#define hashlen_hash(hashlen)		((uint32_t)(hashlen))
+#define hashlen_len(hashlen)		((uint32_t)((hashlen) >> 32))
+#define hashlen_create(hash, len)	((uint64_t)(len) << 32 | (uint32_t)(hash))
+
+extern unsigned int full_name_hash(const void *salt, const char *name,
+				   unsigned int len);
+extern uint64_t hashlen_string(const void *salt, const char *name);
+extern uint64_t hash_name(const void *salt, const char *name);
+extern int name_cmp(const char *cs, const char *ct, unsigned int tcount);
+extern unsigned long word_strlen(const char *s);
+
+#endif
@@ -0,0 +1,287 @@
+/*
+ * Word-at-a-time name hashing benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: stringhash_bench [nr_names]
+ *
+ * Builds one long '/' separated path out of random names of 1..MAX_NAME
+ * bytes, then walks it component by component with the word-at-a-time
+ * helpers and with the byte loops they replace. The word versions are
+ * checked against the byte loops first, including names that end right
+ * in front of an unmapped page.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "stringhash.h"
+
+#define DEFAULT_NAMES	1000000UL
+#define MAX_NAME	40
+#define ROUNDS		10
+#define SALT		((const void *)0x5a5a5a5aUL)
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+/* The byte-at-a-time hash the dcache used before word access */
+static inline unsigned long partial_name_hash(unsigned long c,
+					      unsigned long prevhash)
+{
+	return (prevhash + (c << 4) + (c >> 4)) * 11;
+}
+
+static unsigned int byte_name_hash(const char *name, unsigned int len)
+{
+	unsigned long hash = 0;
+
+	while (len--)
+		hash = partial_name_hash((unsigned char)*name++, hash);
+	return (unsigned int)hash;
+}
+
+static uint64_t byte_hash_name(const char *name)
+{
+	unsigned long hash = 0, len = 0;
+	unsigned char c;
+
+	while ((c = name[len]) && c != '/') {
+		hash = partial_name_hash(c, hash);
+		len++;
+	}
+	return hashlen_create(hash, len);
+}
+
+static unsigned long byte_strlen(const char *s)
+{
+	const char *p = s;
+
+	while (*p)
+		p++;
+	return p - s;
+}
+
+static int byte_cmp(const char *cs, const char *ct, unsigned int tcount)
+{
+	while (tcount--)
+		if (*cs++ != *ct++)
+			return 1;
+	return 0;
+}
+
+/* Stop gcc from turning the byte loops back into libc calls */
+#define opaque(x)	__asm__ __volatile__("" : "+r" (x))
+
+static char *make_path(unsigned long nr, unsigned long *lenp)
+{
+	unsigned long seed = 88172645463325252UL, i, n, len = 0;
+	char *path;
+
+	path = malloc(nr * (MAX_NAME + 1) + 1);
+	if (!path)
+		return NULL;
+	for (i = 0; i < nr; i++) {
+		/* Mostly short names, as in real directory trees */
+		n = xorshift(&seed) % MAX_NAME + 1;
+		if (xorshift(&seed) & 1)
+			n = n / 4 + 1;
+		while (n--)
+			path[len++] = 'a' + xorshift(&seed) % 26;
+		path[len++] = '/';
+	}
+	path[len - 1] = '\0';
+	*lenp = len - 1;
+	return path;
+}
+
+/* Every name length ending at every offset in front of a PROT_NONE page */
+static int check_page_edge(void)
+{
+	const char *name;
+	char *map, *end;
+	unsigned int len;
+	int k, errors = 0;
+
+	map = mmap(NULL, 2 * WORD_PAGE_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED)
+		return 1;
+	memset(map, 'x', WORD_PAGE_SIZE);
+	mprotect(map + WORD_PAGE_SIZE, WORD_PAGE_SIZE, PROT_NONE);
+	end = map + WORD_PAGE_SIZE;
+
+	for (len = 0; len <= 2 * sizeof(unsigned long) + 1; len++) {
+		/* Counted name flush against the guard page */
+		name = end - len;
+		if (full_name_hash(SALT, name, len) !=
+		    full_name_hash(SALT, map, len))
+			errors++;
+		if (name_cmp(name, map, len))
+			errors++;
+
+		/* NUL terminated names, the NUL being the last byte */
+		end[-1] = '\0';
+		for (k = 1; k <= (int)sizeof(unsigned long); k++)
+			end[-1 - k] = k & 1 ? '/' : 'y';
+		name = end - 1 - len;
+		if (word_strlen(name) != len ||
+		    hashlen_len(hashlen_string(SALT, name)) != len ||
+		    hashlen_len(hash_name(SALT, name)) !=
+		    hashlen_len(byte_hash_name(name)))
+			errors++;
+		memset(end - 1 - len - sizeof(unsigned long), 'x',
+				len + 1 + sizeof(unsigned long));
+	}
+	munmap(map, 2 * WORD_PAGE_SIZE);
+	return errors;
+}
+
+static int check(const char *path)
+{
+	const char *p = path;
+	uint64_t w, b;
+	int errors = 0;
+
+	for (;;) {
+		w = hash_name(SALT, p);
+		b = byte_hash_name(p);
+		if (hashlen_len(w) != hashlen_len(b) ||
+		    hashlen_hash(w) != full_name_hash(SALT, p, hashlen_len(b)) ||
+		    name_cmp(p, p + hashlen_len(b) / 2, hashlen_len(b) / 2) !=
+		    byte_cmp(p, p + hashlen_len(b) / 2, hashlen_len(b) / 2))
+			errors++;
+		p += hashlen_len(w);
+		if (!*p)
+			break;
+		p++;
+	}
+	if (word_strlen(path) != strlen(path) ||
+	    hashlen_hash(hashlen_string(SALT, path)) !=
+	    full_name_hash(SALT, path, strlen(path)))
+		errors++;
+	return errors + check_page_edge();
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long nr = DEFAULT_NAMES, len, sum, i;
+	const char *p;
+	char *path, *copy;
+	double start, t_word, t_byte;
+	uint64_t hl;
+	int r;
+
+	if (argc > 1)
+		nr = strtoul(argv[1], NULL, 0);
+	path = make_path(nr, &len);
+	copy = path ? strdup(path) : NULL;
+	if (!copy)
+		return -1;
+
+	if (check(path)) {
+		printf("word-at-a-time results differ from the byte loops\n");
+		return -1;
+	}
+	printf("%lu names, %lu bytes, %d rounds\n", nr, len, ROUNDS);
+	printf("%-16s %12s %12s %8s\n", "", "word", "byte", "speedup");
+
+	/* Path walk: one hash_name() per component */
+	start = now();
+	for (r = 0, sum = 0; r < ROUNDS; r++)
+		for (p = path; ; p++) {
+			hl = hash_name(SALT, p);
+			sum += hashlen_hash(hl);
+			p += hashlen_len(hl);
+			if (!*p)
+				break;
+		}
+	t_word = now() - start;
+	start = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (p = path; ; p++) {
+			hl = byte_hash_name(p);
+			sum += hashlen_hash(hl);
+			p += hashlen_len(hl);
+			if (!*p)
+				break;
+		}
+	t_byte = now() - start;
+	printf("%-16s %11.3fs %11.3fs %7.2fx\n", "hash_name",
+			t_word, t_byte, t_byte / t_word);
+
+	/* Counted hash of the whole path, i.e. long names */
+	start = now();
+	for (r = 0; r < ROUNDS; r++)
+		sum += full_name_hash(SALT, path, len);
+	t_word = now() - start;
+	start = now();
+	for (r = 0; r < ROUNDS; r++)
+		sum += byte_name_hash(path, len);
+	t_byte = now() - start;
+	printf("%-16s %11.3fs %11.3fs %7.2fx\n", "full_name_hash",
+			t_word, t_byte, t_byte / t_word);
+
+	/* Compare every component against its copy */
+	start = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (i = 0; i < len; ) {
+			hl = hash_name(SALT, path + i);
+			sum += name_cmp(path + i, copy + i, hashlen_len(hl));
+			i += hashlen_len(hl) + 1;
+		}
+	t_word = now() - start;
+	start = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (i = 0; i < len; ) {
+			hl = hash_name(SALT, path + i);
+			p = path + i;
+			opaque(p);
+			sum += byte_cmp(p, copy + i, hashlen_len(hl));
+			i += hashlen_len(hl) + 1;
+		}
+	t_byte = now() - start;
+	printf("%-16s %11.3fs %11.3fs %7.2fx\n", "name_cmp",
+			t_word, t_byte, t_byte / t_word);
+
+	start = now();
+	for (r = 0; r < ROUNDS; r++)
+		sum += word_strlen(path + r);
+	t_word = now() - start;
+	start = now();
+	for (r = 0; r < ROUNDS; r++) {
+		p = path + r;
+		opaque(p);
+		sum += byte_strlen(p);
+	}
+	t_byte = now() - start;
+	printf("%-16s %11.3fs %11.3fs %7.2fx\n", "strlen",
+			t_word, t_byte, t_byte / t_word);
+
+	/* Keep the loops from being thrown away */
+	printf("checksum %lx\n", sum);
+	free(copy);
+	free(path);
+	return 0;
+}
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _WORD_AT_A_TIME_H
+#define _WORD_AT_A_TIME_H
+/*
+ * Word-at-a-time string primitives, userspace port of
+ * arch/x86/include/asm/word-at-a-time.h and its arm64 counterpart.
+ *
+ * Only little-endian 64-bit is supported: x86-64 and AArch64 differ in
+ * how find_zero() turns the zero-byte mask into a byte count.
+ */
+#include <string.h>
+
+#if !defined(__x86_64__) && !defined(__aarch64__)
+#error "word-at-a-time: x86-64 or AArch64 only"
+#endif
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+/* 0x45 --> 0x4545454545454545 */
+#define REPEAT_BYTE(x)	((~0ul / 0xff) * (x))
+
+/* Loads may run past the string end inside a page, on purpose */
+#define __no_sanitize	__attribute__((no_sanitize_address))
+
+/* Smallest page size, a boundary of any larger page is one of these */
+#define WORD_PAGE_SIZE	4096UL
+
+struct word_at_a_time {
+	const unsigned long one_bits, high_bits;
+};
+
+#define WORD_AT_A_TIME_CONSTANTS { REPEAT_BYTE(0x01), REPEAT_BYTE(0x80) }
+
+/*
+ * has_zero - non-zero if @a has a zero byte
+ *
+ * Bytes above the first zero byte may be flagged too (borrows), so only
+ * the lowest flag is exact; create_zero_mask() only looks at that one.
+ */
+static inline unsigned long has_zero(unsigned long a, unsigned long *bits,
+				     const struct word_at_a_time *c)
+{
+	unsigned long mask = ((a - c->one_bits) & ~a) & c->high_bits;
+
+	*bits = mask;
+	return mask;
+}
+
+static inline unsigned long prep_zero_mask(unsigned long a,
+			unsigned long bits, const struct word_at_a_time *c)
+{
+	return bits;
+}
+
+/* 0xff for every byte below the first zero byte */
+static inline unsigned long create_zero_mask(unsigned long bits)
+{
+	bits = (bits - 1) & ~bits;
+	return bits >> 7;
+}
+
+/* The mask we created is directly usable as a bytemask */
+#define zero_bytemask(mask)	(mask)
+
+/* Number of bytes in front of the first zero byte */
+static inline unsigned long find_zero(unsigned long mask)
+{
+#ifdef __x86_64__
+	/* Multiply is cheaper than BSF on most x86 cores */
+	return mask * 0x0001020304050608ul >> 56;
+#else
+	return mask ? (64 - __builtin_clzl(mask)) >> 3 : 0;
+#endif
+}
+
+/* The low @cnt bytes */
+#define bytemask_from_count(cnt)	(~(~0ul << (cnt) * 8))
+
+static inline int word_crosses_page(const void *addr)
+{
+	return ((unsigned long)addr & (WORD_PAGE_SIZE - 1)) >
+					WORD_PAGE_SIZE - sizeof(unsigned long);
+}
+
+/*
+ * Aligned load of the word holding @addr, shifted down so @addr is
+ * byte 0. Never leaves the page; the top bytes come back as zero.
+ */
+static inline __no_sanitize unsigned long load_aligned_shifted(const void *addr)
+{
+	unsigned long offset = (unsigned long)addr & (sizeof(unsigned long) - 1);
+
+	return *(const unsigned long *)((const char *)addr - offset) >>
+							(offset * 8);
+}
+
+/*
+ * load_unaligned_zeropad - load a word from a NUL terminated string
+ *
+ * The kernel takes the fault on an unmapped next page and fixes the
+ * load up. Here a load that would cross a page looks at the bytes in
+ * this page first: if the string ends there, they are all we need;
+ * if not, the string runs on into the next page, so it is mapped.
+ */
+static inline __no_sanitize unsigned long load_unaligned_zeropad(const void *addr)
+{
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	unsigned long ret, bits, valid;
+
+	if (unlikely(word_crosses_page(addr))) {
+		ret = load_aligned_shifted(addr);
+		valid = sizeof(unsigned long) -
+			((unsigned long)addr & (sizeof(unsigned long) - 1));
+		if (has_zero(ret | ~bytemask_from_count(valid), &bits,
+			     &constants))
+			return ret;
+	}
+	memcpy(&ret, addr, sizeof(ret));
+	return ret;
+}
+
+/*
+ * load_bytes_zeropad - load the last @count (< 8) bytes of a counted
+ * buffer, without touching the page after it. Bytes beyond @count are
+ * garbage, callers mask them with bytemask_from_count().
+ */
+static inline __no_sanitize unsigned long load_bytes_zeropad(const void *addr,
+						unsigned long count)
+{
+	unsigned long ret;
+
+	if (unlikely(word_crosses_page(addr)) &&
+	    ((unsigned long)addr & (WORD_PAGE_SIZE - 1)) + count <=
+							WORD_PAGE_SIZE)
+		return load_aligned_shifted(addr);
+	memcpy(&ret, addr, sizeof(ret));
+	return ret;
+}
+
+#endif
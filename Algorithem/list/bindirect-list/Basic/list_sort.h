@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LIST_SORT_H_
+#define _LIST_SORT_H_
+
+#include <list.h>
+
+typedef int __attribute__((nonnull(2,3))) (*list_cmp_func_t)(void *,
+		const struct list_head *, const struct list_head *);
+
+extern void list_sort(void *priv, struct list_head *head,
+		      list_cmp_func_t cmp);
+#endif
@@ -0,0 +1,236 @@
+/*
+ * list_sort Manual.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: list_sort [nr_nodes]
+ *
+ * Sorts a list of nr_nodes (default 1M) nodes with list_sort() and with
+ * the usual workaround: copy the nodes into an array, qsort() it and
+ * relink the list. Once with the list in allocation order and once with
+ * the nodes scattered over the heap, as in a long-lived list. Both
+ * results are checked, list_sort() also for stability.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* list */
+#include <list.h>
+#include <list_sort.h>
+
+#define DEFAULT_NODES	1000000UL
+
+/* private structure */
+struct node {
+	unsigned long key;
+	unsigned long seq;	/* input position, to check stability */
+	struct list_head list;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static unsigned long nr_cmps;
+
+static int node_cmp(void *priv, const struct list_head *a,
+		    const struct list_head *b)
+{
+	const struct node *na = list_entry(a, struct node, list);
+	const struct node *nb = list_entry(b, struct node, list);
+
+	nr_cmps++;
+	return na->key > nb->key;
+}
+
+static int node_qsort_cmp(const void *a, const void *b)
+{
+	const struct node *na = *(const struct node **)a;
+	const struct node *nb = *(const struct node **)b;
+
+	nr_cmps++;
+	return (na->key > nb->key) - (na->key < nb->key);
+}
+
+/* The array workaround: copy out, qsort, relink */
+static int array_sort(struct list_head *head, size_t nr)
+{
+	struct node **array, *np;
+	size_t i = 0;
+
+	array = malloc(nr * sizeof(*array));
+	if (!array)
+		return -1;
+	list_for_each_entry(np, head, list)
+		array[i++] = np;
+	qsort(array, nr, sizeof(*array), node_qsort_cmp);
+	INIT_LIST_HEAD(head);
+	for (i = 0; i < nr; i++)
+		list_add_tail(&array[i]->list, head);
+	free(array);
+	return 0;
+}
+
+/* Link @nodes in array order, keys follow @pattern */
+static void build_list(struct list_head *head, struct node **nodes,
+		       size_t nr, int pattern)
+{
+	unsigned long seed = 88172645463325252UL;
+	size_t i;
+
+	INIT_LIST_HEAD(head);
+	for (i = 0; i < nr; i++) {
+		struct node *np = nodes[i];
+
+		switch (pattern) {
+		case 0:		/* random, with duplicates */
+			np->key = xorshift(&seed) % (nr / 2 + 1);
+			break;
+		case 1:		/* already sorted */
+			np->key = i;
+			break;
+		case 2:		/* reversed */
+			np->key = nr - i;
+			break;
+		default:	/* sorted runs of 1000, as from merged batches */
+			np->key = (i % 1000) * nr + i / 1000;
+			break;
+		}
+		np->seq = i;
+		list_add_tail(&np->list, head);
+	}
+}
+
+static int check_sorted(struct list_head *head, size_t nr, int stable)
+{
+	struct node *np, *prev = NULL;
+	size_t count = 0;
+
+	list_for_each_entry(np, head, list) {
+		if (prev && (prev->key > np->key ||
+		    (stable && prev->key == np->key && prev->seq > np->seq)))
+			return 0;
+		if (np->list.prev != (prev ? &prev->list : head))
+			return 0;
+		prev = np;
+		count++;
+	}
+	return count == nr && head->prev == &prev->list;
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *patterns[] = { "random", "sorted", "reversed",
+					  "runs" };
+	unsigned long seed = 2463534242UL;
+	size_t nr = DEFAULT_NODES, i, j;
+	struct node **nodes, **shuffled, **order;
+	LIST_HEAD(head);
+	unsigned long c_list, c_array;
+	double t_list, t_array, start;
+	int layout, pattern, ok = 1;
+
+	if (argc > 1)
+		nr = strtoul(argv[1], NULL, 0);
+	if (nr < 2)
+		nr = 2;
+
+	nodes = malloc(nr * sizeof(*nodes));
+	shuffled = malloc(nr * sizeof(*shuffled));
+	if (!nodes || !shuffled)
+		return -1;
+	for (i = 0; i < nr; i++) {
+		nodes[i] = malloc(sizeof(struct node));
+		if (!nodes[i])
+			return -1;
+		shuffled[i] = nodes[i];
+	}
+	/* Shuffle so list order and memory order are unrelated */
+	for (i = nr - 1; i > 0; i--) {
+		struct node *tmp;
+
+		j = xorshift(&seed) % (i + 1);
+		tmp = shuffled[i];
+		shuffled[i] = shuffled[j];
+		shuffled[j] = tmp;
+	}
+
+	printf("%zu nodes\n", nr);
+	for (layout = 0; layout < 2; layout++) {
+		order = layout ? shuffled : nodes;
+		printf("\n%-10s %12s %14s %12s %14s\n",
+			layout ? "scattered" : "in order", "list_sort",
+			"compares", "array+qsort", "compares");
+		for (pattern = 0; pattern < 4; pattern++) {
+			build_list(&head, order, nr, pattern);
+			nr_cmps = 0;
+			start = now();
+			list_sort(NULL, &head, node_cmp);
+			t_list = now() - start;
+			c_list = nr_cmps;
+			ok &= check_sorted(&head, nr, 1);
+
+			build_list(&head, order, nr, pattern);
+			nr_cmps = 0;
+			start = now();
+			if (array_sort(&head, nr))
+				return -1;
+			t_array = now() - start;
+			c_array = nr_cmps;
+			ok &= check_sorted(&head, nr, 0);
+
+			printf("%-10s %11.3fs %14lu %11.3fs %14lu\n",
+				patterns[pattern], t_list, c_list,
+				t_array, c_array);
+		}
+	}
+
+	/* Bulk helpers: cut the front half off, append it, rotate back */
+	{
+		struct node *first, *mid = NULL, *np;
+		LIST_HEAD(front);
+
+		first = list_first_entry(&head, struct node, list);
+		i = 0;
+		list_for_each_entry(np, &head, list)
+			if (++i == nr / 2) {
+				mid = np;
+				break;
+			}
+		list_cut_position(&front, &head, &mid->list);
+		ok &= list_count_nodes(&front) == nr / 2 &&
+		      list_count_nodes(&head) == nr - nr / 2;
+		list_splice_tail_init(&front, &head);
+		ok &= list_is_last(&mid->list, &head) && list_empty(&front);
+		list_rotate_to_front(&first->list, &head);
+		ok &= list_is_first(&first->list, &head) &&
+		      check_sorted(&head, nr, 0);
+	}
+
+	printf("%s\n", ok ? "All sorted" : "SORT ERROR");
+
+	for (i = 0; i < nr; i++)
+		free(nodes[i]);
+	free(shuffled);
+	free(nodes);
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,129 @@
+#ifndef _LIST_BL_H
+#define _LIST_BL_H
+/*
+ * Lists with bit 0 of the head pointer used as a spinlock, userspace
+ * port of include/linux/list_bl.h and include/linux/rculist_bl.h.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stddef.h>
+
+#include "rcupdate.h"
+
+#define LIST_BL_LOCKMASK	1UL
+
+struct hlist_bl_head {
+	struct hlist_bl_node *first;
+};
+
+struct hlist_bl_node {
+	struct hlist_bl_node *next, **pprev;
+};
+
+#define INIT_HLIST_BL_HEAD(ptr)		((ptr)->first = NULL)
+
+static inline void INIT_HLIST_BL_NODE(struct hlist_bl_node *h)
+{
+	h->next = NULL;
+	h->pprev = NULL;
+}
+
+#define hlist_bl_entry(ptr, type, member)	container_of(ptr, type, member)
+
+static inline int hlist_bl_unhashed(const struct hlist_bl_node *h)
+{
+	return !h->pprev;
+}
+
+static inline struct hlist_bl_node *hlist_bl_first(struct hlist_bl_head *h)
+{
+	return (struct hlist_bl_node *)
+		((unsigned long)h->first & ~LIST_BL_LOCKMASK);
+}
+
+static inline int hlist_bl_empty(const struct hlist_bl_head *h)
+{
+	return !((unsigned long)READ_ONCE(h->first) & ~LIST_BL_LOCKMASK);
+}
+
+/* Spin on bit 0 of ->first, as bit_spin_lock() does */
+static inline void hlist_bl_lock(struct hlist_bl_head *b)
+{
+	unsigned long *p = (unsigned long *)&b->first;
+
+	while (__atomic_fetch_or(p, LIST_BL_LOCKMASK, __ATOMIC_ACQUIRE) &
+							LIST_BL_LOCKMASK) {
+		while (__atomic_load_n(p, __ATOMIC_RELAXED) & LIST_BL_LOCKMASK)
+			cpu_relax();
+	}
+}
+
+/* Only the lock holder writes ->first, so a plain store will do */
+static inline void hlist_bl_unlock(struct hlist_bl_head *b)
+{
+	unsigned long *p = (unsigned long *)&b->first;
+
+	__atomic_store_n(p, *p & ~LIST_BL_LOCKMASK, __ATOMIC_RELEASE);
+}
+
+static inline int hlist_bl_is_locked(struct hlist_bl_head *b)
+{
+	return (unsigned long)READ_ONCE(b->first) & LIST_BL_LOCKMASK;
+}
+
+/* RCU variants, writers hold the bucket lock */
+
+static inline struct hlist_bl_node *
+hlist_bl_first_rcu(struct hlist_bl_head *h)
+{
+	return (struct hlist_bl_node *)
+		((unsigned long)rcu_dereference(h->first) & ~LIST_BL_LOCKMASK);
+}
+
+/* Keep the lock bit set while publishing the new first entry */
+static inline void hlist_bl_set_first_rcu(struct hlist_bl_head *h,
+					  struct hlist_bl_node *n)
+{
+	rcu_assign_pointer(h->first, (struct hlist_bl_node *)
+				((unsigned long)n | LIST_BL_LOCKMASK));
+}
+
+static inline void hlist_bl_add_head_rcu(struct hlist_bl_node *n,
+					 struct hlist_bl_head *h)
+{
+	struct hlist_bl_node *first = hlist_bl_first(h);
+
+	n->next = first;
+	if (first)
+		first->pprev = &n->next;
+	n->pprev = &h->first;
+	hlist_bl_set_first_rcu(h, n);
+}
+
+/*
+ * Unlink @n, readers standing on it still see ->next. Storing through
+ * ->pprev preserves the lock bit when @n is the first entry.
+ */
+static inline void hlist_bl_del_rcu(struct hlist_bl_node *n)
+{
+	struct hlist_bl_node *next = n->next;
+	struct hlist_bl_node **pprev = n->pprev;
+
+	rcu_assign_pointer(*pprev, (struct hlist_bl_node *)
+		((unsigned long)next |
+		 ((unsigned long)*pprev & LIST_BL_LOCKMASK)));
+	if (next)
+		next->pprev = pprev;
+	n->pprev = NULL;
+}
+
+#define hlist_bl_for_each_entry_rcu(tpos, pos, head, member)		\
+	for (pos = hlist_bl_first_rcu(head);				\
+	     pos && ({ tpos = hlist_bl_entry(pos, typeof(*tpos), member); 1; }); \
+	     pos = rcu_dereference(pos->next))
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Minimal userspace RCU.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+
+#include "rcupdate.h"
+
+/* Readers snapshot this, the count bit makes a snapshot look active */
+unsigned long rcu_gp_ctr = RCU_GP_COUNT;
+int rcu_has_sys_membarrier;
+__thread struct rcu_reader rcu_reader;
+
+/* Serialises grace periods and the reader registry */
+static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rcu_reader *rcu_readers;
+
+static int membarrier(int cmd, unsigned int flags)
+{
+	return syscall(__NR_membarrier, cmd, flags, 0);
+}
+
+__attribute__((constructor))
+static void rcu_init(void)
+{
+	int mask = membarrier(MEMBARRIER_CMD_QUERY, 0);
+
+	if (mask < 0 || !(mask & MEMBARRIER_CMD_PRIVATE_EXPEDITED))
+		return;
+	if (membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0))
+		return;
+	rcu_has_sys_membarrier = 1;
+}
+
+/* Writer side: a full barrier on every CPU running one of our threads */
+static void smp_mb_master(void)
+{
+	if (rcu_has_sys_membarrier)
+		membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+	else
+		smp_mb();
+}
+
+void rcu_register_thread(void)
+{
+	pthread_mutex_lock(&rcu_gp_lock);
+	rcu_reader.next = rcu_readers;
+	rcu_readers = &rcu_reader;
+	rcu_reader.registered = 1;
+	pthread_mutex_unlock(&rcu_gp_lock);
+}
+
+void rcu_unregister_thread(void)
+{
+	struct rcu_reader **p;
+
+	pthread_mutex_lock(&rcu_gp_lock);
+	for (p = &rcu_readers; *p; p = &(*p)->next) {
+		if (*p == &rcu_reader) {
+			*p = rcu_reader.next;
+			break;
+		}
+	}
+	rcu_reader.registered = 0;
+	pthread_mutex_unlock(&rcu_gp_lock);
+}
+
+/* Inside a critical section which started before the last flip */
+static int rcu_reader_old(struct rcu_reader *r)
+{
+	unsigned long v = READ_ONCE(r->ctr);
+
+	return (v & RCU_GP_CTR_NEST_MASK) &&
+	       ((v ^ READ_ONCE(rcu_gp_ctr)) & RCU_GP_CTR_PHASE);
+}
+
+static void wait_for_readers(void)
+{
+	struct rcu_reader *r;
+	unsigned int spins;
+
+	for (r = rcu_readers; r; r = r->next) {
+		for (spins = 0; rcu_reader_old(r); spins++) {
+			if (spins < 1000)
+				cpu_relax();
+			else
+				sched_yield();
+		}
+	}
+}
+
+/*
+ * synchronize_rcu - wait until all pre-existing readers have finished
+ *
+ * Two phase flips are needed: a reader may have loaded rcu_gp_ctr just
+ * before the first flip and published it just after.
+ */
+void synchronize_rcu(void)
+{
+	int i;
+
+	pthread_mutex_lock(&rcu_gp_lock);
+	smp_mb_master();
+	for (i = 0; i < 2; i++) {
+		WRITE_ONCE(rcu_gp_ctr, rcu_gp_ctr ^ RCU_GP_CTR_PHASE);
+		smp_mb();
+		wait_for_readers();
+		smp_mb();
+	}
+	smp_mb_master();
+	pthread_mutex_unlock(&rcu_gp_lock);
+}
@@ -0,0 +1,89 @@
+#ifndef _RCUPDATE_H
+#define _RCUPDATE_H
+/*
+ * Minimal userspace RCU.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Same scheme as the "memb" flavour of liburcu: every registered thread
+ * publishes a snapshot of the grace-period counter when it enters a
+ * read-side critical section, and synchronize_rcu() flips the phase bit
+ * twice, waiting for all readers still on the old phase. When the
+ * kernel has sys_membarrier() the reader fast path is just a compiler
+ * barrier and the writer pays for the full barrier on every CPU.
+ *
+ * Threads calling rcu_read_lock() must call rcu_register_thread() first.
+ */
+#include <stddef.h>
+
+#define READ_ONCE(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, val)	__atomic_store_n(&(x), (val), __ATOMIC_RELAXED)
+#define barrier()		__asm__ __volatile__("" : : : "memory")
+#define smp_mb()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax()		__asm__ __volatile__("pause" : : : "memory")
+#else
+#define cpu_relax()		barrier()
+#endif
+
+#ifndef container_of
+#define container_of(ptr, type, member) ({			\
+	const typeof(((type *)0)->member) *__mptr = (ptr);	\
+	(type *)((char *)__mptr - offsetof(type, member)); })
+#endif
+
+#define rcu_dereference(p)	__atomic_load_n(&(p), __ATOMIC_CONSUME)
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/* Low half counts nesting, the bit above it is the phase */
+#define RCU_GP_COUNT		1UL
+#define RCU_GP_CTR_PHASE	(1UL << (sizeof(unsigned long) << 2))
+#define RCU_GP_CTR_NEST_MASK	(RCU_GP_CTR_PHASE - 1)
+
+struct rcu_reader {
+	unsigned long ctr;
+	struct rcu_reader *next;
+	int registered;
+};
+
+extern unsigned long rcu_gp_ctr;
+extern int rcu_has_sys_membarrier;
+extern __thread struct rcu_reader rcu_reader;
+
+extern void rcu_register_thread(void);
+extern void rcu_unregister_thread(void);
+extern void synchronize_rcu(void);
+
+/* Reader side half of the barrier pairing with synchronize_rcu() */
+static inline void smp_mb_slave(void)
+{
+	if (rcu_has_sys_membarrier)
+		barrier();
+	else
+		smp_mb();
+}
+
+static inline void rcu_read_lock(void)
+{
+	unsigned long tmp = rcu_reader.ctr;
+
+	if (!(tmp & RCU_GP_CTR_NEST_MASK)) {
+		WRITE_ONCE(rcu_reader.ctr, READ_ONCE(rcu_gp_ctr));
+		smp_mb_slave();
+	} else {
+		WRITE_ONCE(rcu_reader.ctr, tmp + RCU_GP_COUNT);
+	}
+}
+
+static inline void rcu_read_unlock(void)
+{
+	smp_mb_slave();
+	WRITE_ONCE(rcu_reader.ctr, rcu_reader.ctr - RCU_GP_COUNT);
+}
+
+#endif
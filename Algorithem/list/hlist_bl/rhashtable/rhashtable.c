@@ -0,0 +1,429 @@
+/*
+ * Resizable hash table on hlist_bl buckets.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rhashtable.h"
+
+#define HASH_DEFAULT_SIZE	64
+#define HASH_MIN_SIZE		4
+#define HASH_MAX_SIZE		(1U << 31)
+#define GOLDEN_RATIO_64		0x61C8864680B583EBUL
+
+static u32 rht_seed = 0x9e3779b9;
+
+static inline void *rht_obj(const struct rhashtable *ht,
+			    const struct rhash_head *he)
+{
+	return (char *)he - ht->p.head_offset;
+}
+
+static inline const void *rht_obj_key(const struct rhashtable *ht,
+				      const void *obj)
+{
+	return (const char *)obj + ht->p.key_offset;
+}
+
+static inline unsigned int rht_key_hash(const struct rhashtable *ht,
+			const struct bucket_table *tbl, const void *key)
+{
+	return ht->p.hashfn(key, ht->p.key_len, tbl->hash_rnd) &
+							(tbl->size - 1);
+}
+
+static inline unsigned int rht_head_hash(const struct rhashtable *ht,
+			const struct bucket_table *tbl,
+			const struct rhash_head *he)
+{
+	return rht_key_hash(ht, tbl, rht_obj_key(ht, rht_obj(ht, he)));
+}
+
+/* Multiplicative hash, 8 bytes at a time, the high half is returned */
+static u32 rht_default_hashfn(const void *data, u32 len, u32 seed)
+{
+	const unsigned char *p = data;
+	unsigned long h = seed, v;
+
+	for (; len >= sizeof(v); len -= sizeof(v), p += sizeof(v)) {
+		memcpy(&v, p, sizeof(v));
+		h = (h ^ v) * GOLDEN_RATIO_64;
+		h ^= h >> 29;
+	}
+	if (len) {
+		v = 0;
+		memcpy(&v, p, len);
+		h = (h ^ v) * GOLDEN_RATIO_64;
+	}
+	return (h * GOLDEN_RATIO_64) >> 32;
+}
+
+static unsigned int roundup_pow_of_two(unsigned long n)
+{
+	unsigned long size = 1;
+
+	while (size < n)
+		size <<= 1;
+	return size;
+}
+
+static struct bucket_table *bucket_table_alloc(unsigned int size)
+{
+	struct bucket_table *tbl;
+
+	/* An all-zero head is an empty, unlocked bucket */
+	tbl = calloc(1, sizeof(*tbl) + size * sizeof(tbl->buckets[0]));
+	if (!tbl)
+		return NULL;
+	tbl->size = size;
+	tbl->hash_rnd = __atomic_add_fetch(&rht_seed, 0x9e3779b9,
+					   __ATOMIC_RELAXED);
+	return tbl;
+}
+
+static inline int rht_grow_above_75(const struct rhashtable *ht,
+				    unsigned int size, unsigned long nelems)
+{
+	return nelems > size / 4 * 3 && size < ht->p.max_size;
+}
+
+static inline int rht_shrink_below_30(const struct rhashtable *ht,
+				      unsigned int size, unsigned long nelems)
+{
+	return nelems < size * 3UL / 10 && size > ht->p.min_size;
+}
+
+/*
+ * Size the next table for the current count directly, rather than
+ * doubling one step at a time, so a bulk load that outruns the worker
+ * does not go through every intermediate size.
+ */
+static unsigned int rht_target_size(struct rhashtable *ht)
+{
+	unsigned long nelems = READ_ONCE(ht->nelems);
+	unsigned int size = ht->tbl->size;
+	unsigned long target;
+
+	if (rht_grow_above_75(ht, size, nelems)) {
+		target = roundup_pow_of_two(nelems * 4 / 3 + 1);
+		if (target > ht->p.max_size)
+			target = ht->p.max_size;
+		return target;
+	}
+	if (rht_shrink_below_30(ht, size, nelems)) {
+		target = roundup_pow_of_two(nelems * 3 / 2);
+		if (target < ht->p.min_size)
+			target = ht->p.min_size;
+		return target < size ? target : 0;
+	}
+	return 0;
+}
+
+static void rht_schedule_resize(struct rhashtable *ht)
+{
+	if (__atomic_exchange_n(&ht->resize_pending, 1, __ATOMIC_ACQ_REL))
+		return;
+	pthread_mutex_lock(&ht->mutex);
+	pthread_cond_signal(&ht->wait);
+	pthread_mutex_unlock(&ht->mutex);
+}
+
+/*
+ * Move bucket @hash of @old into @new. The last entry goes first, so a
+ * reader walking the old chain never loses the entries in front of it;
+ * one standing on the moved entry just runs on into the new chain.
+ * The entry is linked into @new before it is cut off @old, so a reader
+ * which misses it in @old finds it in ->future_tbl.
+ */
+static void rhashtable_rehash_chain(struct rhashtable *ht,
+		struct bucket_table *old, struct bucket_table *new,
+		unsigned int hash)
+{
+	struct hlist_bl_head *head = &old->buckets[hash], *nhead;
+	struct hlist_bl_node *pos, **pprev;
+
+	hlist_bl_lock(head);
+	while ((pos = hlist_bl_first(head))) {
+		pprev = &head->first;
+		while (pos->next) {
+			pprev = &pos->next;
+			pos = pos->next;
+		}
+
+		nhead = &new->buckets[rht_head_hash(ht, new,
+				container_of(pos, struct rhash_head, node))];
+		hlist_bl_lock(nhead);
+		hlist_bl_add_head_rcu(pos, nhead);
+		hlist_bl_unlock(nhead);
+
+		rcu_assign_pointer(*pprev, (struct hlist_bl_node *)
+			((unsigned long)*pprev & LIST_BL_LOCKMASK));
+	}
+	WRITE_ONCE(old->rehash, hash + 1);
+	hlist_bl_unlock(head);
+}
+
+static int rhashtable_rehash_table(struct rhashtable *ht, unsigned int size)
+{
+	struct bucket_table *old = ht->tbl, *new;
+	unsigned int hash;
+
+	new = bucket_table_alloc(size);
+	if (!new)
+		return -ENOMEM;
+
+	rcu_assign_pointer(old->future_tbl, new);
+	for (hash = 0; hash < old->size; hash++)
+		rhashtable_rehash_chain(ht, old, new, hash);
+
+	rcu_assign_pointer(ht->tbl, new);
+	/* Readers and writers still on @old follow ->future_tbl */
+	synchronize_rcu();
+	free(old);
+	ht->nr_resizes++;
+	return 0;
+}
+
+static void *rht_deferred_worker(void *arg)
+{
+	struct rhashtable *ht = arg;
+	unsigned int size;
+
+	for (;;) {
+		pthread_mutex_lock(&ht->mutex);
+		while (!READ_ONCE(ht->resize_pending) && !ht->stop)
+			pthread_cond_wait(&ht->wait, &ht->mutex);
+		if (ht->stop) {
+			pthread_mutex_unlock(&ht->mutex);
+			break;
+		}
+		__atomic_store_n(&ht->resize_pending, 0, __ATOMIC_RELEASE);
+		ht->resizing = 1;
+		pthread_mutex_unlock(&ht->mutex);
+
+		while ((size = rht_target_size(ht)))
+			if (rhashtable_rehash_table(ht, size))
+				break;
+
+		pthread_mutex_lock(&ht->mutex);
+		ht->resizing = 0;
+		pthread_cond_broadcast(&ht->idle);
+		pthread_mutex_unlock(&ht->mutex);
+	}
+	return NULL;
+}
+
+/*
+ * rhashtable_wait_resize - wait for the worker to go idle
+ *
+ * Returns once no resize is pending or running, so ->tbl and
+ * ->nr_resizes reflect every insert and remove that came before.
+ */
+void rhashtable_wait_resize(struct rhashtable *ht)
+{
+	pthread_mutex_lock(&ht->mutex);
+	while (READ_ONCE(ht->resize_pending) || ht->resizing)
+		pthread_cond_wait(&ht->idle, &ht->mutex);
+	pthread_mutex_unlock(&ht->mutex);
+}
+
+/*
+ * rhashtable_init - initialize a new hash table
+ *
+ * Starts the resize worker. Returns 0, -EINVAL or -ENOMEM.
+ */
+int rhashtable_init(struct rhashtable *ht,
+		    const struct rhashtable_params *params)
+{
+	memset(ht, 0, sizeof(*ht));
+	if (!params->key_len)
+		return -EINVAL;
+	ht->p = *params;
+
+	if (!ht->p.hashfn)
+		ht->p.hashfn = rht_default_hashfn;
+	if (!ht->p.max_size || ht->p.max_size > HASH_MAX_SIZE)
+		ht->p.max_size = HASH_MAX_SIZE;
+	ht->p.max_size = roundup_pow_of_two(ht->p.max_size);
+	if (ht->p.min_size < HASH_MIN_SIZE)
+		ht->p.min_size = HASH_DEFAULT_SIZE;
+	ht->p.min_size = roundup_pow_of_two(ht->p.min_size);
+	if (ht->p.min_size > ht->p.max_size)
+		return -EINVAL;
+
+	ht->tbl = bucket_table_alloc(ht->p.min_size);
+	if (!ht->tbl)
+		return -ENOMEM;
+
+	pthread_mutex_init(&ht->mutex, NULL);
+	pthread_cond_init(&ht->wait, NULL);
+	pthread_cond_init(&ht->idle, NULL);
+	if (pthread_create(&ht->worker, NULL, rht_deferred_worker, ht)) {
+		free(ht->tbl);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+/*
+ * rhashtable_destroy - stop the worker and free the table
+ *
+ * @free_fn is called on every object still in the table. No other
+ * thread may use @ht any more.
+ */
+void rhashtable_destroy(struct rhashtable *ht,
+			void (*free_fn)(void *ptr, void *arg), void *arg)
+{
+	struct bucket_table *tbl;
+	struct hlist_bl_node *pos, *next;
+	unsigned int hash;
+
+	pthread_mutex_lock(&ht->mutex);
+	ht->stop = 1;
+	pthread_cond_signal(&ht->wait);
+	pthread_mutex_unlock(&ht->mutex);
+	pthread_join(ht->worker, NULL);
+
+	tbl = ht->tbl;
+	for (hash = 0; free_fn && hash < tbl->size; hash++) {
+		for (pos = hlist_bl_first(&tbl->buckets[hash]); pos;
+							pos = next) {
+			next = pos->next;
+			free_fn(rht_obj(ht, container_of(pos,
+					struct rhash_head, node)), arg);
+		}
+	}
+	free(tbl);
+	pthread_mutex_destroy(&ht->mutex);
+	pthread_cond_destroy(&ht->wait);
+	pthread_cond_destroy(&ht->idle);
+}
+
+/*
+ * rhashtable_lookup - search the table for @key
+ *
+ * Must be called under rcu_read_lock(); the object stays valid until
+ * rcu_read_unlock(). Returns NULL if @key is not in the table.
+ */
+void *rhashtable_lookup(struct rhashtable *ht, const void *key)
+{
+	struct bucket_table *tbl = rcu_dereference(ht->tbl);
+	struct hlist_bl_node *pos;
+	struct rhash_head *he;
+
+	do {
+		struct hlist_bl_head *head;
+
+		head = &tbl->buckets[rht_key_hash(ht, tbl, key)];
+		hlist_bl_for_each_entry_rcu(he, pos, head, node) {
+			void *obj = rht_obj(ht, he);
+
+			if (!memcmp(rht_obj_key(ht, obj), key, ht->p.key_len))
+				return obj;
+		}
+		/* Not there, or already moved on by a resize */
+		tbl = rcu_dereference(tbl->future_tbl);
+	} while (tbl);
+
+	return NULL;
+}
+
+/*
+ * Lock the bucket @key hashes to, in the table which currently owns
+ * it. Called under rcu_read_lock().
+ */
+static struct hlist_bl_head *rht_lock_bucket(struct rhashtable *ht,
+			const void *key, struct bucket_table **tblp)
+{
+	struct bucket_table *tbl = rcu_dereference(ht->tbl);
+	struct hlist_bl_head *head;
+	unsigned int hash;
+
+	for (;;) {
+		hash = rht_key_hash(ht, tbl, key);
+		head = &tbl->buckets[hash];
+		hlist_bl_lock(head);
+		if (hash >= READ_ONCE(tbl->rehash))
+			break;
+		hlist_bl_unlock(head);
+		tbl = rcu_dereference(tbl->future_tbl);
+	}
+	*tblp = tbl;
+	return head;
+}
+
+/*
+ * rhashtable_insert - insert @obj, keyed by its key field
+ *
+ * Returns 0 or -EEXIST if an object with the same key is present.
+ */
+int rhashtable_insert(struct rhashtable *ht, struct rhash_head *obj)
+{
+	const void *key = rht_obj_key(ht, rht_obj(ht, obj));
+	struct bucket_table *tbl;
+	struct hlist_bl_head *head;
+	struct hlist_bl_node *pos;
+	unsigned long nelems;
+	unsigned int size;
+
+	rcu_read_lock();
+	head = rht_lock_bucket(ht, key, &tbl);
+	for (pos = hlist_bl_first(head); pos; pos = pos->next) {
+		if (!memcmp(rht_obj_key(ht, rht_obj(ht, container_of(pos,
+				struct rhash_head, node))), key, ht->p.key_len)) {
+			hlist_bl_unlock(head);
+			rcu_read_unlock();
+			return -EEXIST;
+		}
+	}
+	hlist_bl_add_head_rcu(&obj->node, head);
+	size = tbl->size;
+	hlist_bl_unlock(head);
+	rcu_read_unlock();
+
+	nelems = __atomic_add_fetch(&ht->nelems, 1, __ATOMIC_RELAXED);
+	if (rht_grow_above_75(ht, size, nelems))
+		rht_schedule_resize(ht);
+	return 0;
+}
+
+/*
+ * rhashtable_remove - unlink @obj
+ *
+ * Readers may still see @obj until a grace period has elapsed, so free
+ * it only after synchronize_rcu(). Returns 0 or -ENOENT.
+ */
+int rhashtable_remove(struct rhashtable *ht, struct rhash_head *obj)
+{
+	const void *key = rht_obj_key(ht, rht_obj(ht, obj));
+	struct bucket_table *tbl;
+	struct hlist_bl_head *head;
+	struct hlist_bl_node *pos;
+	unsigned long nelems;
+	unsigned int size;
+
+	rcu_read_lock();
+	head = rht_lock_bucket(ht, key, &tbl);
+	for (pos = hlist_bl_first(head); pos; pos = pos->next)
+		if (pos == &obj->node)
+			break;
+	if (pos)
+		hlist_bl_del_rcu(pos);
+	size = tbl->size;
+	hlist_bl_unlock(head);
+	rcu_read_unlock();
+
+	if (!pos)
+		return -ENOENT;
+	nelems = __atomic_sub_fetch(&ht->nelems, 1, __ATOMIC_RELAXED);
+	if (rht_shrink_below_30(ht, size, nelems))
+		rht_schedule_resize(ht);
+	return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef _RHASHTABLE_H
+#define _RHASHTABLE_H
+/*
+ * Resizable hash table on hlist_bl buckets, modelled on lib/rhashtable.c
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Every bucket is an hlist_bl_head, locked through bit 0 of its first
+ * pointer. Lookups take no lock at all and run under rcu_read_lock().
+ * When the load leaves [30%, 75%] a worker thread allocates a table of
+ * the right size, hangs it off ->future_tbl and moves entries across
+ * one bucket at a time. Writers lock a bucket of the old table and
+ * follow ->future_tbl if it has already been moved; readers search the
+ * old table, then the new one. Once every bucket is moved the new table
+ * is published and the old one freed after a grace period.
+ */
+#include <pthread.h>
+
+#include "list_bl.h"
+
+typedef unsigned int u32;
+
+struct rhash_head {
+	struct hlist_bl_node node;
+};
+
+struct bucket_table {
+	unsigned int size;
+	/* Buckets below this one have moved to future_tbl */
+	unsigned int rehash;
+	u32 hash_rnd;
+	struct bucket_table *future_tbl;
+	struct hlist_bl_head buckets[];
+};
+
+typedef u32 (*rht_hashfn_t)(const void *data, u32 len, u32 seed);
+
+/*
+ * @head_offset:	offset of the struct rhash_head in the object
+ * @key_offset:		offset of the key in the object
+ * @key_len:		key length in bytes, keys are compared with memcmp()
+ * @min_size:		never shrink below this many buckets
+ * @max_size:		never grow beyond this many buckets
+ * @hashfn:		hash function, a multiplicative hash if NULL
+ */
+struct rhashtable_params {
+	unsigned int head_offset;
+	unsigned int key_offset;
+	unsigned int key_len;
+	unsigned int min_size;
+	unsigned int max_size;
+	rht_hashfn_t hashfn;
+};
+
+struct rhashtable {
+	struct bucket_table *tbl;
+	struct rhashtable_params p;
+	unsigned long nelems;
+	/* Background resizer */
+	pthread_t worker;
+	pthread_mutex_t mutex;
+	pthread_cond_t wait;
+	/* Broadcast when the worker finishes a round of resizing */
+	pthread_cond_t idle;
+	int resize_pending;
+	int resizing;
+	int stop;
+	unsigned long nr_resizes;
+};
+
+extern int rhashtable_init(struct rhashtable *ht,
+			   const struct rhashtable_params *params);
+extern void rhashtable_destroy(struct rhashtable *ht,
+			       void (*free_fn)(void *ptr, void *arg), void *arg);
+extern void *rhashtable_lookup(struct rhashtable *ht, const void *key);
+extern int rhashtable_insert(struct rhashtable *ht, struct rhash_head *obj);
+extern int rhashtable_remove(struct rhashtable *ht, struct rhash_head *obj);
+extern void rhashtable_wait_resize(struct rhashtable *ht);
+
+/* Lookup for callers outside a read-side critical section */
+static inline void *rhashtable_lookup_fast(struct rhashtable *ht,
+					   const void *key)
+{
+	void *obj;
+
+	rcu_read_lock();
+	obj = rhashtable_lookup(ht, key);
+	rcu_read_unlock();
+	return obj;
+}
+
+/* Number of buckets of the current table */
+static inline unsigned int rhashtable_size(struct rhashtable *ht)
+{
+	unsigned int size;
+
+	rcu_read_lock();
+	size = rcu_dereference(ht->tbl)->size;
+	rcu_read_unlock();
+	return size;
+}
+
+#endif
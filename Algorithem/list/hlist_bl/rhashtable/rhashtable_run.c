@@ -0,0 +1,249 @@
+/*
+ * Resizable hlist_bl hash table benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: rhashtable_bench [nr_entries]
+ *
+ * 1) Grow a table from 1K buckets to nr_entries keys while a reader
+ *    thread keeps looking up keys already inserted; it must never miss.
+ * 2) Lookup and insert throughput with 1..MAX_THREADS threads.
+ * 3) Remove everything again and let the table shrink.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "rhashtable.h"
+
+#define DEFAULT_ENTRIES		10000000UL
+#define MIN_SIZE		1024
+#define MAX_THREADS		8
+#define SCALE_ENTRIES		1000000UL
+#define SCALE_LOOKUPS		4000000UL
+
+struct test_obj {
+	unsigned long key;
+	struct rhash_head node;
+};
+
+static const struct rhashtable_params test_params = {
+	.head_offset	= offsetof(struct test_obj, node),
+	.key_offset	= offsetof(struct test_obj, key),
+	.key_len	= sizeof(unsigned long),
+	.min_size	= MIN_SIZE,
+};
+
+static struct rhashtable ht;
+static struct test_obj *objs;
+static unsigned long nr_inserted;
+static int stop_reader;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+/* Key i is scrambled so neighbours land in unrelated buckets */
+static inline unsigned long test_key(unsigned long i)
+{
+	return i * 0x9e3779b97f4a7c15UL + 1;
+}
+
+struct reader_stat {
+	unsigned long lookups;
+	unsigned long misses;
+};
+
+static void *growth_reader(void *arg)
+{
+	struct reader_stat *stat = arg;
+	unsigned long seed = 88172645463325252UL, nr, key;
+
+	rcu_register_thread();
+	while (!__atomic_load_n(&stop_reader, __ATOMIC_RELAXED)) {
+		nr = __atomic_load_n(&nr_inserted, __ATOMIC_ACQUIRE);
+		if (!nr)
+			continue;
+		key = test_key(xorshift(&seed) % nr);
+		if (!rhashtable_lookup_fast(&ht, &key))
+			stat->misses++;
+		stat->lookups++;
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void growth_test(unsigned long nr)
+{
+	struct reader_stat stat = { 0, 0 };
+	unsigned long i, mark = 1000;
+	pthread_t reader;
+	double start;
+
+	rhashtable_init(&ht, &test_params);
+	pthread_create(&reader, NULL, growth_reader, &stat);
+
+	printf("Growth, one writer and one reader:\n");
+	printf("%12s %10s %12s %8s %14s %8s\n", "entries", "time",
+		"buckets", "resizes", "reader lookups", "misses");
+	start = now();
+	for (i = 0; i < nr; i++) {
+		objs[i].key = test_key(i);
+		rhashtable_insert(&ht, &objs[i].node);
+		__atomic_store_n(&nr_inserted, i + 1, __ATOMIC_RELEASE);
+		if (i + 1 == mark || i + 1 == nr) {
+			/* Count the resize this insert may have queued */
+			rhashtable_wait_resize(&ht);
+			printf("%12lu %9.3fs %12u %8lu %14lu %8lu\n", i + 1,
+				now() - start, rhashtable_size(&ht),
+				ht.nr_resizes, stat.lookups, stat.misses);
+			mark *= 10;
+		}
+	}
+	__atomic_store_n(&stop_reader, 1, __ATOMIC_RELAXED);
+	pthread_join(reader, NULL);
+}
+
+struct scale_arg {
+	unsigned long first;
+	unsigned long nr;
+	unsigned long found;
+};
+
+static void *scale_lookup(void *arg)
+{
+	struct scale_arg *sa = arg;
+	unsigned long seed = sa->first * 2 + 1, i, key;
+
+	rcu_register_thread();
+	for (i = 0; i < sa->nr; i++) {
+		key = test_key(xorshift(&seed) % SCALE_ENTRIES);
+		if (rhashtable_lookup_fast(&ht, &key))
+			sa->found++;
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *scale_insert(void *arg)
+{
+	struct scale_arg *sa = arg;
+	unsigned long i;
+
+	rcu_register_thread();
+	for (i = sa->first; i < sa->first + sa->nr; i++) {
+		objs[i].key = test_key(i);
+		if (!rhashtable_insert(&ht, &objs[i].node))
+			sa->found++;
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static double run_threads(void *(*fn)(void *), int nr_threads,
+			  unsigned long per_thread, unsigned long *found)
+{
+	struct scale_arg args[MAX_THREADS];
+	pthread_t tids[MAX_THREADS];
+	double start;
+	int t;
+
+	start = now();
+	for (t = 0; t < nr_threads; t++) {
+		args[t].first = t * per_thread;
+		args[t].nr = per_thread;
+		args[t].found = 0;
+		pthread_create(&tids[t], NULL, fn, &args[t]);
+	}
+	*found = 0;
+	for (t = 0; t < nr_threads; t++) {
+		pthread_join(tids[t], NULL);
+		*found += args[t].found;
+	}
+	return now() - start;
+}
+
+static void scale_test(void)
+{
+	unsigned long found;
+	double t;
+	int nr;
+
+	printf("\nScaling, %lu entries:\n", SCALE_ENTRIES);
+	printf("%8s %16s %16s\n", "threads", "lookup Mops/s", "insert Mops/s");
+	for (nr = 1; nr <= MAX_THREADS; nr <<= 1) {
+		double lookup, insert;
+
+		/* Inserts start from a 1K table, so they include growth */
+		rhashtable_init(&ht, &test_params);
+		t = run_threads(scale_insert, nr, SCALE_ENTRIES / nr, &found);
+		insert = found / t / 1e6;
+
+		t = run_threads(scale_lookup, nr, SCALE_LOOKUPS / nr, &found);
+		lookup = found / t / 1e6;
+		rhashtable_destroy(&ht, NULL, NULL);
+
+		printf("%8d %16.2f %16.2f\n", nr, lookup, insert);
+	}
+}
+
+static void shrink_test(unsigned long nr)
+{
+	unsigned long i;
+	double start;
+
+	printf("\nRemove all %lu entries:\n", nr);
+	start = now();
+	for (i = 0; i < nr; i++)
+		rhashtable_remove(&ht, &objs[i].node);
+	/* objs[] is freed in one go, so one grace period covers all */
+	synchronize_rcu();
+	rhashtable_wait_resize(&ht);
+	printf("%9.3fs, %u buckets left after %lu resizes\n", now() - start,
+				rhashtable_size(&ht), ht.nr_resizes);
+	rhashtable_destroy(&ht, NULL, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long nr = DEFAULT_ENTRIES;
+
+	if (argc > 1)
+		nr = strtoul(argv[1], NULL, 0);
+	if (nr < SCALE_ENTRIES)
+		nr = SCALE_ENTRIES;
+
+	objs = malloc(nr * sizeof(*objs));
+	if (!objs)
+		return -1;
+
+	rcu_register_thread();
+	growth_test(nr);
+	shrink_test(nr);
+	scale_test();
+	rcu_unregister_thread();
+
+	free(objs);
+	return 0;
+}
@@ -0,0 +1,345 @@
+/*
+ * klist with lock-free iteration.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <sched.h>
+
+#include "klist.h"
+
+/* Bit 0 of ->n_klist, set once the node has been deleted */
+#define KNODE_DEAD		1UL
+
+/* ->n_waiter */
+#define KNODE_WAITING		1
+#define KNODE_UNLINKED		2
+
+static inline struct klist *knode_klist(struct klist_node *n)
+{
+	return (struct klist *)
+		((unsigned long)READ_ONCE(n->n_klist) & ~KNODE_DEAD);
+}
+
+static inline bool knode_dead(struct klist_node *n)
+{
+	return (unsigned long)READ_ONCE(n->n_klist) & KNODE_DEAD;
+}
+
+static inline void knode_kill(struct klist_node *n)
+{
+	__atomic_fetch_or((unsigned long *)&n->n_klist, KNODE_DEAD,
+							__ATOMIC_RELAXED);
+}
+
+static inline struct klist_node *to_klist_node(struct list_head *n)
+{
+	return container_of(n, struct klist_node, n_node);
+}
+
+/* kref_get_unless_zero(): a node at zero is on its way out */
+static bool klist_get_unless_zero(struct klist_node *n)
+{
+	int ref = __atomic_load_n(&n->n_ref, __ATOMIC_RELAXED);
+
+	do {
+		if (!ref)
+			return false;
+	} while (!__atomic_compare_exchange_n(&n->n_ref, &ref, ref + 1, true,
+					      __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+	return true;
+}
+
+int klist_init(struct klist *k, void (*get)(struct klist_node *),
+	       void (*put)(struct klist_node *))
+{
+	int ret;
+
+	ret = pthread_spin_init(&k->k_lock, PTHREAD_PROCESS_PRIVATE);
+	if (ret)
+		return -ret;
+	INIT_LIST_HEAD(&k->k_list);
+	k->get = get;
+	k->put = put;
+	k->k_gc = NULL;
+	k->k_nr_gc = 0;
+	return 0;
+}
+
+/* All nodes must have been removed */
+void klist_destroy(struct klist *k)
+{
+	klist_gc(k);
+	pthread_spin_destroy(&k->k_lock);
+}
+
+/* Fully set up before list_add_rcu() publishes it */
+static void klist_node_init(struct klist *k, struct klist_node *n)
+{
+	n->n_ref = 1;
+	n->n_waiter = 0;
+	n->n_gc = NULL;
+	n->n_klist = k;
+	if (k->get)
+		k->get(n);
+}
+
+void klist_add_head(struct klist_node *n, struct klist *k)
+{
+	klist_node_init(k, n);
+	pthread_spin_lock(&k->k_lock);
+	list_add_rcu(&n->n_node, &k->k_list);
+	pthread_spin_unlock(&k->k_lock);
+}
+
+void klist_add_tail(struct klist_node *n, struct klist *k)
+{
+	klist_node_init(k, n);
+	pthread_spin_lock(&k->k_lock);
+	list_add_tail_rcu(&n->n_node, &k->k_list);
+	pthread_spin_unlock(&k->k_lock);
+}
+
+/* @pos must be live, or be held by the caller's iterator */
+void klist_add_behind(struct klist_node *n, struct klist_node *pos)
+{
+	struct klist *k = knode_klist(pos);
+
+	klist_node_init(k, n);
+	pthread_spin_lock(&k->k_lock);
+	list_add_rcu(&n->n_node, &pos->n_node);
+	pthread_spin_unlock(&k->k_lock);
+}
+
+void klist_add_before(struct klist_node *n, struct klist_node *pos)
+{
+	struct klist *k = knode_klist(pos);
+
+	klist_node_init(k, n);
+	pthread_spin_lock(&k->k_lock);
+	list_add_tail_rcu(&n->n_node, &pos->n_node);
+	pthread_spin_unlock(&k->k_lock);
+}
+
+/*
+ * The last reference is gone, nobody stands on @n any more. Unlink it
+ * and hand it to klist_remove() or to the reclaim queue; walkers which
+ * already loaded a pointer to it keep following its ->next.
+ */
+static void klist_release(struct klist_node *n)
+{
+	struct klist *k = knode_klist(n);
+
+	pthread_spin_lock(&k->k_lock);
+	list_del_rcu(&n->n_node);
+	if (n->n_waiter) {
+		__atomic_store_n(&n->n_waiter, KNODE_UNLINKED,
+						__ATOMIC_RELEASE);
+	} else {
+		n->n_gc = k->k_gc;
+		k->k_gc = n;
+		k->k_nr_gc++;
+	}
+	pthread_spin_unlock(&k->k_lock);
+}
+
+static void klist_put(struct klist_node *n)
+{
+	if (!__atomic_sub_fetch(&n->n_ref, 1, __ATOMIC_ACQ_REL))
+		klist_release(n);
+}
+
+/**
+ * klist_del - drop the list's reference on @n
+ *
+ * @n stays linked while iterators stand on it, they skip it from now
+ * on. ->put() runs from a later klist_gc().
+ */
+void klist_del(struct klist_node *n)
+{
+	struct klist *k = knode_klist(n);
+
+	knode_kill(n);
+	klist_put(n);
+	if (READ_ONCE(k->k_nr_gc) >= KLIST_GC_BATCH)
+		klist_gc(k);
+}
+
+/**
+ * klist_remove - delete @n and wait until it is gone
+ *
+ * Waits for iterators standing on @n to move on and for walkers to
+ * finish with it, then calls ->put(). The caller may free @n after.
+ */
+void klist_remove(struct klist_node *n)
+{
+	struct klist *k = knode_klist(n);
+
+	WRITE_ONCE(n->n_waiter, KNODE_WAITING);
+	knode_kill(n);
+	klist_put(n);
+	while (__atomic_load_n(&n->n_waiter, __ATOMIC_ACQUIRE) !=
+							KNODE_UNLINKED)
+		sched_yield();
+	synchronize_rcu();
+	n->n_klist = NULL;
+	if (k->put)
+		k->put(n);
+}
+
+int klist_node_attached(struct klist_node *n)
+{
+	return READ_ONCE(n->n_klist) != NULL;
+}
+
+/**
+ * klist_gc - hand the nodes unlinked so far to ->put()
+ *
+ * One grace period covers the whole batch. Returns the number of nodes
+ * reclaimed.
+ */
+unsigned long klist_gc(struct klist *k)
+{
+	struct klist_node *n, *next;
+	unsigned long nr;
+
+	pthread_spin_lock(&k->k_lock);
+	n = k->k_gc;
+	nr = k->k_nr_gc;
+	k->k_gc = NULL;
+	k->k_nr_gc = 0;
+	pthread_spin_unlock(&k->k_lock);
+	if (!n)
+		return 0;
+
+	synchronize_rcu();
+	for (; n; n = next) {
+		next = n->n_gc;
+		n->n_klist = NULL;
+		if (k->put)
+			k->put(n);
+	}
+	return nr;
+}
+
+/**
+ * klist_iter_init_node - start walking @k from @n
+ *
+ * Starts at the head instead if @n is already on its way out.
+ */
+void klist_iter_init_node(struct klist *k, struct klist_iter *i,
+			  struct klist_node *n)
+{
+	i->i_klist = k;
+	i->i_cur = NULL;
+	i->i_locked = false;
+	if (n && klist_get_unless_zero(n))
+		i->i_cur = n;
+}
+
+void klist_iter_init(struct klist *k, struct klist_iter *i)
+{
+	klist_iter_init_node(k, i, NULL);
+}
+
+void klist_iter_init_locked(struct klist *k, struct klist_iter *i)
+{
+	klist_iter_init_node(k, i, NULL);
+	i->i_locked = true;
+}
+
+void klist_iter_exit(struct klist_iter *i)
+{
+	if (i->i_cur) {
+		klist_put(i->i_cur);
+		i->i_cur = NULL;
+	}
+}
+
+/* Next live node after @pos, with a reference taken. Under k_lock. */
+static struct klist_node *klist_step_locked(struct klist *k,
+				struct list_head *pos, bool forward)
+{
+	struct klist_node *n;
+
+	for (; pos != &k->k_list; pos = forward ? pos->next : pos->prev) {
+		n = to_klist_node(pos);
+		/* klist_put() drops to zero outside k_lock, don't revive */
+		if (!knode_dead(n) && klist_get_unless_zero(n))
+			return n;
+	}
+	return NULL;
+}
+
+static struct klist_node *klist_next_locked(struct klist_iter *i)
+{
+	struct klist *k = i->i_klist;
+	struct klist_node *last = i->i_cur;
+
+	pthread_spin_lock(&k->k_lock);
+	i->i_cur = klist_step_locked(k, last ? last->n_node.next :
+					      k->k_list.next, true);
+	pthread_spin_unlock(&k->k_lock);
+	if (last)
+		klist_put(last);
+	return i->i_cur;
+}
+
+/**
+ * klist_prev - ante up the previous node
+ *
+ * ->prev is not published for RCU walkers, so this takes k_lock.
+ */
+struct klist_node *klist_prev(struct klist_iter *i)
+{
+	struct klist *k = i->i_klist;
+	struct klist_node *last = i->i_cur;
+
+	pthread_spin_lock(&k->k_lock);
+	i->i_cur = klist_step_locked(k, last ? last->n_node.prev :
+					      k->k_list.prev, false);
+	pthread_spin_unlock(&k->k_lock);
+	if (last)
+		klist_put(last);
+	return i->i_cur;
+}
+
+/**
+ * klist_next - ante up the next node
+ *
+ * The node the iterator stands on cannot be unlinked, so its ->next is
+ * followed under rcu_read_lock() only. Dead nodes are skipped, and so
+ * are nodes whose last reference is being dropped right now.
+ */
+struct klist_node *klist_next(struct klist_iter *i)
+{
+	struct klist *k = i->i_klist;
+	struct klist_node *last = i->i_cur, *next = NULL;
+	struct list_head *pos;
+
+	if (i->i_locked)
+		return klist_next_locked(i);
+
+	rcu_read_lock();
+	if (last)
+		pos = rcu_dereference(last->n_node.next);
+	else
+		pos = rcu_dereference(k->k_list.next);
+	while (pos != &k->k_list) {
+		next = to_klist_node(pos);
+		if (!knode_dead(next) && klist_get_unless_zero(next))
+			break;
+		next = NULL;
+		pos = rcu_dereference(pos->next);
+	}
+	rcu_read_unlock();
+
+	i->i_cur = next;
+	if (last)
+		klist_put(last);
+	return next;
+}
@@ -0,0 +1,87 @@
+#ifndef _KLIST_H
+#define _KLIST_H
+/*
+ * klist with lock-free iteration, userspace port of lib/klist.c.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * As in the kernel, the list owns one reference on every node and an
+ * iterator owns one on the node it stands on. klist_del() only marks
+ * the node dead and drops the list's reference; whoever drops the last
+ * one unlinks it. A node an iterator stands on is therefore never
+ * unlinked, and klist_next() can follow ->next from it without k_lock:
+ * it walks under rcu_read_lock() and takes its reference with
+ * klist_get_unless_zero(). k_lock only serialises add and unlink.
+ *
+ * Unlinked nodes may still be seen by walkers, so they are handed to
+ * ->put() only after a grace period: klist_remove() waits for it, nodes
+ * dropped by klist_del() are queued and reclaimed by klist_gc().
+ *
+ * Threads using a klist must call rcu_register_thread() first, and must
+ * not call klist_del(), klist_remove() or klist_gc() from inside an
+ * rcu_read_lock() section.
+ */
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "rculist.h"
+
+struct klist_node;
+
+struct klist {
+	pthread_spinlock_t	k_lock;
+	struct list_head	k_list;
+	void			(*get)(struct klist_node *);
+	void			(*put)(struct klist_node *);
+	/* Unlinked nodes waiting for a grace period, under k_lock */
+	struct klist_node	*k_gc;
+	unsigned long		k_nr_gc;
+} __attribute__((aligned(sizeof(void *))));
+
+struct klist_node {
+	void			*n_klist;	/* never access directly */
+	struct list_head	n_node;
+	int			n_ref;
+	/* Set by klist_remove(), KNODE_UNLINKED once the node is gone */
+	int			n_waiter;
+	struct klist_node	*n_gc;
+};
+
+struct klist_iter {
+	struct klist		*i_klist;
+	struct klist_node	*i_cur;
+	bool			i_locked;
+};
+
+/* klist_gc() runs by itself once this many nodes are queued */
+#define KLIST_GC_BATCH		256
+
+extern int klist_init(struct klist *k, void (*get)(struct klist_node *),
+		      void (*put)(struct klist_node *));
+extern void klist_destroy(struct klist *k);
+
+extern void klist_add_tail(struct klist_node *n, struct klist *k);
+extern void klist_add_head(struct klist_node *n, struct klist *k);
+extern void klist_add_behind(struct klist_node *n, struct klist_node *pos);
+extern void klist_add_before(struct klist_node *n, struct klist_node *pos);
+
+extern void klist_del(struct klist_node *n);
+extern void klist_remove(struct klist_node *n);
+extern int klist_node_attached(struct klist_node *n);
+extern unsigned long klist_gc(struct klist *k);
+
+extern void klist_iter_init(struct klist *k, struct klist_iter *i);
+extern void klist_iter_init_node(struct klist *k, struct klist_iter *i,
+				 struct klist_node *n);
+extern void klist_iter_exit(struct klist_iter *i);
+extern struct klist_node *klist_prev(struct klist_iter *i);
+extern struct klist_node *klist_next(struct klist_iter *i);
+
+/* The kernel's klist_next(): takes k_lock for every step */
+extern void klist_iter_init_locked(struct klist *k, struct klist_iter *i);
+
+#endif
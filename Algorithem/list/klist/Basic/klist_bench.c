@@ -0,0 +1,291 @@
+/*
+ * klist iteration benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: klist_bench [-t max_readers] [-d msecs] [-n nr_devices]
+ *
+ * Readers walk a list of nr_devices "devices" from end to end, over and
+ * over, while one writer keeps deleting a random device and adding a
+ * fresh one. Runs with the kernel's klist_next(), which takes k_lock
+ * for every step, and with the lock-free one, for 1, 2, 4, ...
+ * max_readers readers.
+ *
+ * Every device a reader is handed must not have been reclaimed yet,
+ * one that has is counted as an error.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "klist.h"
+
+#define MAX_THREADS	256
+#define DEV_LIVE	0x4c495645
+#define DEV_FREE	0x46524545
+/* One in REMOVE_EVERY writer ops waits in klist_remove() */
+#define REMOVE_EVERY	16
+
+#define smp_load_acquire(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+struct device {
+	int magic;
+	unsigned long id;
+	struct klist_node knode;
+};
+
+struct worker {
+	pthread_t tid;
+	int cpu;
+	unsigned long walks;
+	unsigned long visited;
+	unsigned long stale;
+	unsigned long writes;
+} __attribute__((aligned(64)));
+
+static struct klist devices;
+static struct device *pool;
+static struct device **free_devs, **live_devs;
+static unsigned long nr_free, nr_devices = 10000;
+static struct worker workers[MAX_THREADS + 1];
+static bool locked_walk;
+static int start_flag, stop_flag;
+static unsigned int nr_ready;
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+/* ->put(), only ever runs in the writer or in main */
+static void device_put(struct klist_node *n)
+{
+	struct device *dev = container_of(n, struct device, knode);
+
+	dev->magic = DEV_FREE;
+	free_devs[nr_free++] = dev;
+}
+
+static struct device *device_alloc(void)
+{
+	struct device *dev;
+
+	if (!nr_free && !klist_gc(&devices))
+		return NULL;
+	dev = free_devs[--nr_free];
+	dev->magic = DEV_LIVE;
+	dev->id++;
+	return dev;
+}
+
+static void wait_for_start(struct worker *w)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	rcu_register_thread();
+	__atomic_fetch_add(&nr_ready, 1, __ATOMIC_RELAXED);
+	while (!smp_load_acquire(&start_flag))
+		cpu_relax();
+}
+
+static void *reader_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct klist_iter iter;
+	struct klist_node *n;
+	struct device *dev;
+	unsigned long sum = 0;
+
+	wait_for_start(w);
+	while (!READ_ONCE(stop_flag)) {
+		if (locked_walk)
+			klist_iter_init_locked(&devices, &iter);
+		else
+			klist_iter_init(&devices, &iter);
+		while ((n = klist_next(&iter))) {
+			dev = container_of(n, struct device, knode);
+			if (READ_ONCE(dev->magic) != DEV_LIVE)
+				w->stale++;
+			sum += dev->id;
+			w->visited++;
+		}
+		klist_iter_exit(&iter);
+		w->walks++;
+	}
+	rcu_unregister_thread();
+	/* Keep the loads */
+	w->visited += !sum;
+	return NULL;
+}
+
+static void *writer_fn(void *arg)
+{
+	struct worker *w = arg;
+	unsigned long seed = 88172645463325252UL, slot;
+	struct device *dev;
+
+	wait_for_start(w);
+	while (!READ_ONCE(stop_flag)) {
+		dev = device_alloc();
+		if (!dev) {
+			sched_yield();
+			continue;
+		}
+		slot = xorshift(&seed) % nr_devices;
+		if (w->writes % REMOVE_EVERY)
+			klist_del(&live_devs[slot]->knode);
+		else
+			klist_remove(&live_devs[slot]->knode);
+		live_devs[slot] = dev;
+		klist_add_tail(&dev->knode, &devices);
+		w->writes++;
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void setup(void)
+{
+	unsigned long i;
+
+	klist_init(&devices, NULL, device_put);
+	nr_free = 0;
+	for (i = 0; i < 2 * nr_devices; i++) {
+		pool[i].magic = DEV_FREE;
+		pool[i].id = i << 20;
+		free_devs[nr_free++] = &pool[i];
+	}
+	for (i = 0; i < nr_devices; i++) {
+		live_devs[i] = device_alloc();
+		klist_add_tail(&live_devs[i]->knode, &devices);
+	}
+}
+
+/* Returns non-zero if a device went missing */
+static int teardown(void)
+{
+	unsigned long i;
+
+	for (i = 0; i < nr_devices; i++)
+		klist_remove(&live_devs[i]->knode);
+	klist_destroy(&devices);
+	return nr_free != 2 * nr_devices;
+}
+
+static unsigned long run(int nr_readers, unsigned int msecs,
+			 struct worker *sum)
+{
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	struct timespec ts = { msecs / 1000, (msecs % 1000) * 1000000L };
+	struct worker *w;
+	int t;
+
+	setup();
+	start_flag = stop_flag = 0;
+	nr_ready = 0;
+	for (t = 0; t <= nr_readers; t++) {
+		w = &workers[t];
+		memset(w, 0, sizeof(*w));
+		w->cpu = t % ncpus;
+		pthread_create(&w->tid, NULL, t ? reader_fn : writer_fn, w);
+	}
+	while (READ_ONCE(nr_ready) < (unsigned int)nr_readers + 1)
+		sched_yield();
+	smp_store_release(&start_flag, 1);
+	nanosleep(&ts, NULL);
+	WRITE_ONCE(stop_flag, 1);
+
+	memset(sum, 0, sizeof(*sum));
+	for (t = 0; t <= nr_readers; t++) {
+		w = &workers[t];
+		pthread_join(w->tid, NULL);
+		sum->walks += w->walks;
+		sum->visited += w->visited;
+		sum->stale += w->stale;
+		sum->writes += w->writes;
+	}
+	return sum->stale + teardown();
+}
+
+int main(int argc, char *argv[])
+{
+	int max_readers = sysconf(_SC_NPROCESSORS_ONLN), opt, nr, mode;
+	unsigned int msecs = 200;
+	unsigned long errors = 0;
+	struct worker sum;
+
+	while ((opt = getopt(argc, argv, "t:d:n:")) != -1) {
+		switch (opt) {
+		case 't':
+			max_readers = atoi(optarg);
+			break;
+		case 'd':
+			msecs = atoi(optarg);
+			break;
+		case 'n':
+			nr_devices = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t max_readers] [-d msecs] "
+				"[-n nr_devices]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (max_readers < 1 || max_readers > MAX_THREADS || !msecs ||
+	    !nr_devices) {
+		fprintf(stderr, "readers 1..%d, msecs > 0, nr_devices > 0\n",
+			MAX_THREADS);
+		return -1;
+	}
+
+	pool = calloc(2 * nr_devices, sizeof(*pool));
+	free_devs = malloc(2 * nr_devices * sizeof(*free_devs));
+	live_devs = malloc(nr_devices * sizeof(*live_devs));
+	if (!pool || !free_devs || !live_devs)
+		return -1;
+	rcu_register_thread();
+
+	printf("%ld CPUs, %u ms per run, %lu devices, one writer\n",
+		sysconf(_SC_NPROCESSORS_ONLN), msecs, nr_devices);
+	printf("%-10s %7s %12s %16s %14s %8s\n", "klist_next", "readers",
+		"walks/s", "nodes Mvisits/s", "writes Kops/s", "errors");
+	for (mode = 0; mode < 2; mode++) {
+		locked_walk = !mode;
+		for (nr = 1; nr <= max_readers; nr <<= 1) {
+			unsigned long err = run(nr, msecs, &sum);
+
+			printf("%-10s %7d %12.0f %16.2f %14.2f %8lu\n",
+				locked_walk ? "k_lock" : "lock-free", nr,
+				sum.walks * 1000.0 / msecs,
+				sum.visited / 1000.0 / msecs,
+				sum.writes / 1.0 / msecs, err);
+			errors += err;
+		}
+	}
+	rcu_unregister_thread();
+	free(live_devs);
+	free(free_devs);
+	free(pool);
+
+	printf(errors ? "ERRORS: %lu\n" : "No stale nodes\n", errors);
+	return errors ? -1 : 0;
+}
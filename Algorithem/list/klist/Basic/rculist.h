@@ -0,0 +1,66 @@
+#ifndef _RCULIST_H
+#define _RCULIST_H
+/*
+ * Doubly linked list with RCU traversal, the part of
+ * include/linux/list.h and include/linux/rculist.h klist needs.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stddef.h>
+
+#include "rcupdate.h"
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	WRITE_ONCE(list->next, list);
+	list->prev = list;
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+
+/* Publish @new between @prev and @next, readers see it fully built */
+static inline void __list_add_rcu(struct list_head *new,
+				  struct list_head *prev,
+				  struct list_head *next)
+{
+	new->next = next;
+	new->prev = prev;
+	rcu_assign_pointer(prev->next, new);
+	next->prev = new;
+}
+
+static inline void list_add_rcu(struct list_head *new, struct list_head *head)
+{
+	__list_add_rcu(new, head, head->next);
+}
+
+static inline void list_add_tail_rcu(struct list_head *new,
+				     struct list_head *head)
+{
+	__list_add_rcu(new, head->prev, head);
+}
+
+/*
+ * Unlink @entry, readers standing on it still see ->next. ->prev is
+ * cleared so that a second unlink oopses instead of corrupting the list.
+ */
+static inline void list_del_rcu(struct list_head *entry)
+{
+	struct list_head *prev = entry->prev, *next = entry->next;
+
+	next->prev = prev;
+	WRITE_ONCE(prev->next, next);
+	entry->prev = NULL;
+}
+
+#endif
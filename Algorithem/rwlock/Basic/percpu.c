@@ -0,0 +1,52 @@
+/*
+ * Minimal per-CPU areas.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "percpu.h"
+
+unsigned int nr_cpu_ids = 1;
+
+static void __attribute__((constructor)) percpu_init(void)
+{
+	long nr = sysconf(_SC_NPROCESSORS_CONF);
+
+	if (nr > 0)
+		nr_cpu_ids = nr;
+}
+
+/*
+ * __alloc_percpu - allocate zeroed per-CPU memory
+ *
+ * Returns the unit of CPU 0, or NULL. @align above a cache line is
+ * not supported.
+ */
+void __percpu *__alloc_percpu(size_t size, size_t align)
+{
+	size_t unit = (size + SMP_CACHE_BYTES - 1) & ~(size_t)(SMP_CACHE_BYTES - 1);
+	struct pcpu_hdr *hdr;
+
+	if (!size || align > SMP_CACHE_BYTES)
+		return NULL;
+	if (posix_memalign((void **)&hdr, SMP_CACHE_BYTES,
+			   sizeof(*hdr) + unit * nr_cpu_ids))
+		return NULL;
+	memset(hdr + 1, 0, unit * nr_cpu_ids);
+	hdr->unit_size = unit;
+	return hdr + 1;
+}
+
+void free_percpu(void __percpu *ptr)
+{
+	if (ptr)
+		free((struct pcpu_hdr *)ptr - 1);
+}
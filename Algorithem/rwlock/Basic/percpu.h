@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _PERCPU_H
+#define _PERCPU_H
+/*
+ * Minimal per-CPU areas for threaded userspace code, with the API of
+ * the Memory-Allocator/PERCPU demos: alloc_percpu(), per_cpu_ptr(),
+ * this_cpu_ptr() and for_each_possible_cpu().
+ *
+ * Each allocation is one block of nr_cpu_ids units, every unit rounded
+ * up to a cache line so two CPUs never share one. Threads can migrate
+ * at any time, so this_cpu_ptr() only says where the caller probably
+ * runs: two threads may use the same unit, and updates through it must
+ * still be atomic. They just never bounce between CPUs.
+ */
+#include <stddef.h>
+#include <sched.h>
+
+#include "spinlock.h"
+
+#define __percpu
+
+extern unsigned int nr_cpu_ids;
+
+#define for_each_possible_cpu(cpu)	\
+	for ((cpu) = 0; (cpu) < nr_cpu_ids; (cpu)++)
+
+/* Hidden in front of every percpu block */
+struct pcpu_hdr {
+	size_t unit_size;
+} ____cacheline_aligned;
+
+static inline size_t pcpu_unit_size(const void __percpu *ptr)
+{
+	return ((const struct pcpu_hdr *)ptr - 1)->unit_size;
+}
+
+#define per_cpu_ptr(ptr, cpu)						\
+	((__typeof__(ptr))((char *)(ptr) + (cpu) * pcpu_unit_size(ptr)))
+
+static inline unsigned int smp_processor_id(void)
+{
+	int cpu = sched_getcpu();
+
+	return cpu < 0 ? 0 : (unsigned int)cpu % nr_cpu_ids;
+}
+
+#define this_cpu_ptr(ptr)	per_cpu_ptr(ptr, smp_processor_id())
+#define raw_cpu_ptr(ptr)	this_cpu_ptr(ptr)
+
+extern void __percpu *__alloc_percpu(size_t size, size_t align);
+extern void free_percpu(void __percpu *ptr);
+
+#define alloc_percpu(type)					\
+	(__typeof__(type) __percpu *)__alloc_percpu(sizeof(type),	\
+					__alignof__(type))
+
+#endif
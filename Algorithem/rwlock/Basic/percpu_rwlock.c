@@ -0,0 +1,83 @@
+/*
+ * Per-CPU reader/writer lock.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+
+#include "percpu_rwlock.h"
+
+int percpu_rwlock_init(struct percpu_rwlock *lock)
+{
+	lock->read_count = alloc_percpu(long);
+	if (!lock->read_count)
+		return -ENOMEM;
+	lock->writer = 0;
+	lock->wait_lock.val = 0;
+	return 0;
+}
+
+void percpu_rwlock_destroy(struct percpu_rwlock *lock)
+{
+	free_percpu(lock->read_count);
+	lock->read_count = NULL;
+}
+
+/*
+ * A writer is active or on its way. Back off and wait for it.
+ *
+ * The increment being undone has to come off the very counter it went
+ * on, even if we migrated since: the writer may have summed that
+ * counter before our increment and another one after the decrement,
+ * and must not see -1 there to cancel out a real reader.
+ */
+void __percpu_read_lock(struct percpu_rwlock *lock, long *count)
+{
+	for (;;) {
+		__atomic_sub_fetch(count, 1, __ATOMIC_RELEASE);
+		smp_cond_load_relaxed(&lock->writer, !VAL);
+
+		count = this_cpu_ptr(lock->read_count);
+		__atomic_add_fetch(count, 1, __ATOMIC_SEQ_CST);
+		if (!READ_ONCE(lock->writer))
+			return;
+	}
+}
+
+static long readers_active(struct percpu_rwlock *lock)
+{
+	unsigned int cpu;
+	long sum = 0;
+
+	for_each_possible_cpu(cpu)
+		sum += smp_load_acquire(per_cpu_ptr(lock->read_count, cpu));
+	return sum;
+}
+
+void percpu_write_lock(struct percpu_rwlock *lock)
+{
+	queued_spin_lock(&lock->wait_lock);
+
+	/* Pairs with the full barrier in percpu_read_lock() */
+	__atomic_store_n(&lock->writer, 1, __ATOMIC_SEQ_CST);
+	smp_mb();
+
+	/*
+	 * Readers which got in before ->writer was visible are counted
+	 * somewhere. Readers unlocking on another CPU only make a sum too
+	 * large, so zero means all of them have left.
+	 */
+	while (readers_active(lock))
+		cpu_relax();
+}
+
+void percpu_write_unlock(struct percpu_rwlock *lock)
+{
+	smp_store_release(&lock->writer, 0);
+	queued_spin_unlock(&lock->wait_lock);
+}
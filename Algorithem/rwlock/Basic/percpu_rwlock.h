@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _PERCPU_RWLOCK_H
+#define _PERCPU_RWLOCK_H
+/*
+ * Per-CPU reader/writer lock, after percpu-rwsem and the old brlock.
+ *
+ * Readers bump the counter of the CPU they run on and check that no
+ * writer is around; they never write a shared cache line. A writer
+ * raises ->writer so new readers back off, then waits for the sum of
+ * all counters to reach zero. Writes get much more expensive, O(CPUs),
+ * so this only pays off for read-mostly data.
+ *
+ * Spinning lock: neither side sleeps.
+ */
+#include "percpu.h"
+#include "qspinlock.h"
+
+struct percpu_rwlock {
+	long __percpu *read_count;
+	int writer;
+	/* Serialises writers */
+	qspinlock_t wait_lock;
+};
+
+extern int percpu_rwlock_init(struct percpu_rwlock *lock);
+extern void percpu_rwlock_destroy(struct percpu_rwlock *lock);
+extern void __percpu_read_lock(struct percpu_rwlock *lock, long *count);
+extern void percpu_write_lock(struct percpu_rwlock *lock);
+extern void percpu_write_unlock(struct percpu_rwlock *lock);
+
+static inline void percpu_read_lock(struct percpu_rwlock *lock)
+{
+	long *count = this_cpu_ptr(lock->read_count);
+
+	/*
+	 * Full barrier: the writer either sees our count, or we see its
+	 * ->writer below. It costs a locked add on a line no other CPU
+	 * normally touches, not a cache miss.
+	 */
+	__atomic_add_fetch(count, 1, __ATOMIC_SEQ_CST);
+	if (likely(!READ_ONCE(lock->writer)))
+		return;
+	__percpu_read_lock(lock, count);
+}
+
+static inline void percpu_read_unlock(struct percpu_rwlock *lock)
+{
+	/* Any CPU's counter will do, only the sum means anything */
+	__atomic_sub_fetch(this_cpu_ptr(lock->read_count), 1,
+			   __ATOMIC_RELEASE);
+}
+
+#endif
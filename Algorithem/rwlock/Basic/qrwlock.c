@@ -0,0 +1,68 @@
+/*
+ * Queued read/write lock slow paths.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include "rwlock.h"
+
+/**
+ * queued_read_lock_slowpath - acquire read lock of a queue rwlock
+ * @lock: Pointer to queue rwlock structure
+ */
+void queued_read_lock_slowpath(struct qrwlock *lock)
+{
+	__atomic_sub_fetch(&lock->cnts, _QR_BIAS, __ATOMIC_RELAXED);
+
+	/*
+	 * Put the reader into the wait queue
+	 */
+	queued_spin_lock(&lock->wait_lock);
+	__atomic_add_fetch(&lock->cnts, _QR_BIAS, __ATOMIC_RELAXED);
+
+	/*
+	 * The ACQUIRE semantics of the following spinning code ensure
+	 * that accesses can't leak upwards out of our subsequent critical
+	 * section in the case that the lock is currently held for write.
+	 */
+	smp_cond_load_acquire(&lock->cnts, !(VAL & _QW_LOCKED));
+
+	/*
+	 * Signal the next one in queue to become queue head
+	 */
+	queued_spin_unlock(&lock->wait_lock);
+}
+
+/**
+ * queued_write_lock_slowpath - acquire write lock of a queue rwlock
+ * @lock : Pointer to queue rwlock structure
+ */
+void queued_write_lock_slowpath(struct qrwlock *lock)
+{
+	uint32_t cnts;
+
+	/* Put the writer into the wait queue */
+	queued_spin_lock(&lock->wait_lock);
+
+	/* Try to acquire the lock directly if no reader is present */
+	cnts = 0;
+	if (!READ_ONCE(lock->cnts) &&
+	    __atomic_compare_exchange_n(&lock->cnts, &cnts, _QW_LOCKED, 0,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		goto unlock;
+
+	/* Set the waiting flag to notify readers that a writer is pending */
+	__atomic_fetch_or(&lock->cnts, _QW_WAITING, __ATOMIC_RELAXED);
+
+	/* When no more readers or writers, set the locked flag */
+	do {
+		cnts = smp_cond_load_relaxed(&lock->cnts,
+					     VAL == _QW_WAITING);
+	} while (!__atomic_compare_exchange_n(&lock->cnts, &cnts, _QW_LOCKED,
+				0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+unlock:
+	queued_spin_unlock(&lock->wait_lock);
+}
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _RWLOCK_H
+#define _RWLOCK_H
+/*
+ * Userspace rwlock_t, port of the queued rwlock in
+ * kernel/locking/qrwlock.c.
+ *
+ * One word counts readers (in units of _QR_BIAS) and holds the writer
+ * byte, so every read_lock() and read_unlock() is an atomic add on the
+ * same cache line. Contended lockers queue on a queued spinlock, which
+ * keeps writers from starving.
+ */
+#include "qspinlock.h"
+
+typedef struct qrwlock {
+	union {
+		uint32_t cnts;
+		struct {
+			uint8_t wlocked;	/* Locked for write? */
+			uint8_t __lstate[3];
+		};
+	};
+	qspinlock_t wait_lock;
+} rwlock_t;
+
+#define __ARCH_RW_LOCK_UNLOCKED	{ { .cnts = 0 }, __ARCH_SPIN_LOCK_UNLOCKED }
+#define DEFINE_RWLOCK(x)	rwlock_t x = __ARCH_RW_LOCK_UNLOCKED
+
+/*
+ * Writer states & reader shift and bias.
+ */
+#define _QW_WAITING	0x100		/* A writer is waiting	   */
+#define _QW_LOCKED	0x0ff		/* A writer holds the lock */
+#define _QW_WMASK	0x1ff		/* Writer mask		   */
+#define _QR_SHIFT	9		/* Reader count shift	   */
+#define _QR_BIAS	(1U << _QR_SHIFT)
+
+extern void queued_read_lock_slowpath(struct qrwlock *lock);
+extern void queued_write_lock_slowpath(struct qrwlock *lock);
+
+static inline void rwlock_init(rwlock_t *lock)
+{
+	lock->cnts = 0;
+	lock->wait_lock.val = 0;
+}
+
+static inline void read_lock(rwlock_t *lock)
+{
+	uint32_t cnts;
+
+	cnts = __atomic_add_fetch(&lock->cnts, _QR_BIAS, __ATOMIC_ACQUIRE);
+	if (likely(!(cnts & _QW_WMASK)))
+		return;
+
+	/* The slowpath will decrement the reader count, if necessary. */
+	queued_read_lock_slowpath(lock);
+}
+
+static inline void write_lock(rwlock_t *lock)
+{
+	uint32_t cnts = 0;
+
+	/* Optimize for the unfair lock case where the fair flag is 0. */
+	if (likely(__atomic_compare_exchange_n(&lock->cnts, &cnts, _QW_LOCKED,
+			0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+		return;
+
+	queued_write_lock_slowpath(lock);
+}
+
+static inline void read_unlock(rwlock_t *lock)
+{
+	/*
+	 * Atomically decrement the reader count
+	 */
+	__atomic_sub_fetch(&lock->cnts, _QR_BIAS, __ATOMIC_RELEASE);
+}
+
+static inline void write_unlock(rwlock_t *lock)
+{
+	smp_store_release(&lock->wlocked, 0);
+}
+
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Read-mostly lock benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: rwlock_bench [-t max_threads] [-d msecs] [-w writes_per_mille]
+ *
+ * Every thread looks up a small config table, and one in 1000/w of
+ * its operations rewrites it, for msecs. Runs with rwlock_t, the per-CPU
+ * rwlock and seqlock_t for 1, 2, 4, ... max_threads threads.
+ *
+ * Readers check that all words of the table belong to the same update;
+ * a torn read is counted as an error.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "rwlock.h"
+#include "percpu_rwlock.h"
+#include "seqlock.h"
+
+#define MAX_THREADS	256
+#define CONFIG_WORDS	8
+
+struct config_table {
+	unsigned long word[CONFIG_WORDS];
+};
+
+static struct config_table config ____cacheline_aligned;
+
+static DEFINE_RWLOCK(rwlock);
+static struct percpu_rwlock pcpu_lock;
+static DEFINE_SEQLOCK(seqlock);
+
+/* Plain loads and stores, the lock under test makes them safe */
+static inline int read_config(struct config_table *snap)
+{
+	unsigned int i;
+
+	for (i = 0; i < CONFIG_WORDS; i++)
+		snap->word[i] = READ_ONCE(config.word[i]);
+	for (i = 1; i < CONFIG_WORDS; i++)
+		if (snap->word[i] != snap->word[0] + i)
+			return 0;
+	return 1;
+}
+
+static inline void write_config(void)
+{
+	unsigned long v = config.word[0] + CONFIG_WORDS;
+	unsigned int i;
+
+	for (i = 0; i < CONFIG_WORDS; i++)
+		WRITE_ONCE(config.word[i], v + i);
+}
+
+static int rw_read(struct config_table *snap)
+{
+	int ok;
+
+	read_lock(&rwlock);
+	ok = read_config(snap);
+	read_unlock(&rwlock);
+	return ok;
+}
+
+static void rw_write(void)
+{
+	write_lock(&rwlock);
+	write_config();
+	write_unlock(&rwlock);
+}
+
+static int pcpu_read(struct config_table *snap)
+{
+	int ok;
+
+	percpu_read_lock(&pcpu_lock);
+	ok = read_config(snap);
+	percpu_read_unlock(&pcpu_lock);
+	return ok;
+}
+
+static void pcpu_write(void)
+{
+	percpu_write_lock(&pcpu_lock);
+	write_config();
+	percpu_write_unlock(&pcpu_lock);
+}
+
+/* Torn snapshots are retried, only a stable one is checked */
+static int seq_read(struct config_table *snap)
+{
+	unsigned int i, seq;
+
+	do {
+		seq = read_seqbegin(&seqlock);
+		for (i = 0; i < CONFIG_WORDS; i++)
+			snap->word[i] = READ_ONCE(config.word[i]);
+	} while (read_seqretry(&seqlock, seq));
+
+	for (i = 1; i < CONFIG_WORDS; i++)
+		if (snap->word[i] != snap->word[0] + i)
+			return 0;
+	return 1;
+}
+
+static void seq_write(void)
+{
+	write_seqlock(&seqlock);
+	write_config();
+	write_sequnlock(&seqlock);
+}
+
+struct lock_type {
+	const char *name;
+	int (*read)(struct config_table *snap);
+	void (*write)(void);
+};
+
+static const struct lock_type lock_types[] = {
+	{ "rwlock_t",		rw_read,	rw_write },
+	{ "percpu_rwlock",	pcpu_read,	pcpu_write },
+	{ "seqlock_t",		seq_read,	seq_write },
+};
+#define NR_LOCK_TYPES	(sizeof(lock_types) / sizeof(lock_types[0]))
+
+struct worker {
+	pthread_t tid;
+	int cpu;
+	unsigned long reads;
+	unsigned long writes;
+	unsigned long torn;
+} ____cacheline_aligned;
+
+static struct worker workers[MAX_THREADS];
+static const struct lock_type *cur_lock;
+static unsigned int write_permille = 1;
+static int start_flag, stop_flag;
+static unsigned int nr_ready;
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct config_table snap;
+	unsigned long seed = 88172645463325252UL + w->cpu * 2 + 1;
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	__atomic_fetch_add(&nr_ready, 1, __ATOMIC_RELAXED);
+	while (!smp_load_acquire(&start_flag))
+		cpu_relax();
+
+	while (!READ_ONCE(stop_flag)) {
+		if (xorshift(&seed) % 1000 < write_permille) {
+			cur_lock->write();
+			w->writes++;
+		} else {
+			if (!cur_lock->read(&snap))
+				w->torn++;
+			w->reads++;
+		}
+	}
+	return NULL;
+}
+
+static unsigned long run(int nr_threads, unsigned int msecs,
+			 unsigned long *reads, unsigned long *writes)
+{
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	struct timespec ts = { msecs / 1000, (msecs % 1000) * 1000000L };
+	unsigned long torn = 0;
+	int t;
+
+	memset(&config, 0, sizeof(config));
+	write_config();
+	start_flag = stop_flag = 0;
+	nr_ready = 0;
+
+	for (t = 0; t < nr_threads; t++) {
+		memset(&workers[t], 0, sizeof(workers[t]));
+		workers[t].cpu = t % ncpus;
+		pthread_create(&workers[t].tid, NULL, worker_fn, &workers[t]);
+	}
+	while (READ_ONCE(nr_ready) < (unsigned int)nr_threads)
+		sched_yield();
+	smp_store_release(&start_flag, 1);
+	nanosleep(&ts, NULL);
+	WRITE_ONCE(stop_flag, 1);
+
+	*reads = *writes = 0;
+	for (t = 0; t < nr_threads; t++) {
+		pthread_join(workers[t].tid, NULL);
+		*reads += workers[t].reads;
+		*writes += workers[t].writes;
+		torn += workers[t].torn;
+	}
+	return torn;
+}
+
+int main(int argc, char *argv[])
+{
+	int max_threads = sysconf(_SC_NPROCESSORS_ONLN), opt, nr;
+	unsigned long reads, writes, torn, errors = 0;
+	unsigned int msecs = 200;
+	size_t l;
+
+	while ((opt = getopt(argc, argv, "t:d:w:")) != -1) {
+		switch (opt) {
+		case 't':
+			max_threads = atoi(optarg);
+			break;
+		case 'd':
+			msecs = atoi(optarg);
+			break;
+		case 'w':
+			write_permille = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t max_threads] [-d msecs] "
+				"[-w writes_per_mille]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (max_threads < 1 || max_threads > MAX_THREADS || !msecs ||
+	    write_permille > 1000) {
+		fprintf(stderr, "threads 1..%d, msecs > 0, writes <= 1000\n",
+			MAX_THREADS);
+		return -1;
+	}
+	if (percpu_rwlock_init(&pcpu_lock))
+		return -1;
+
+	printf("%ld CPUs, %u ms per run, %u.%u%% writes\n",
+		sysconf(_SC_NPROCESSORS_ONLN), msecs,
+		write_permille / 10, write_permille % 10);
+	printf("%-14s %7s %14s %14s\n", "lock", "threads", "reads Mops/s",
+		"writes Kops/s");
+
+	for (l = 0; l < NR_LOCK_TYPES; l++) {
+		cur_lock = &lock_types[l];
+		for (nr = 1; ; nr = nr * 2 > max_threads ? max_threads : nr * 2) {
+			torn = run(nr, msecs, &reads, &writes);
+			errors += torn;
+			printf("%-14s %7d %14.3f %14.3f", cur_lock->name, nr,
+				reads / (msecs * 1e3), writes / (double)msecs);
+			if (torn)
+				printf("  %lu TORN", torn);
+			printf("\n");
+			if (nr == max_threads)
+				break;
+		}
+	}
+	percpu_rwlock_destroy(&pcpu_lock);
+	return errors ? -1 : 0;
+}
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _SEQLATCH_H
+#define _SEQLATCH_H
+/*
+ * Seqcount latch container: lock-free consistent snapshots of a
+ * multi-word struct, the way the fast timekeeper keeps tk_fast.
+ *
+ *   seq even: readers use data[0]      seq odd: readers use data[1]
+ *
+ *   writer:  latch  -> seq odd,  readers move to data[1]
+ *            data[0] = new
+ *            latch  -> seq even, readers move to data[0]
+ *            data[1] = new
+ *
+ * A reader copies the copy the sequence points at and retries only if
+ * the sequence moved meanwhile, i.e. a writer went past that copy
+ * while it was being read. Unlike seqlock_t, readers never spin on an
+ * odd sequence: a writer in progress leaves the other copy stable.
+ *
+ * Writers are serialised by ->lock. To change a single field, read
+ * the current value with seqlatch_read() under the same lock, or keep
+ * the master copy elsewhere, and publish the whole struct.
+ */
+#include "seqlock.h"
+
+#define SEQLATCH(type)				\
+	struct {				\
+		seqcount_t seq;			\
+		qspinlock_t lock;		\
+		type data[2];			\
+	}
+
+#define SEQLATCH_INIT(val)						\
+	{								\
+		.seq = SEQCNT_ZERO(seq),				\
+		.lock = __ARCH_SPIN_LOCK_UNLOCKED,			\
+		.data = { val, val },					\
+	}
+
+#define DEFINE_SEQLATCH(name, type, val)	\
+	SEQLATCH(type) name = SEQLATCH_INIT(val)
+
+/*
+ * seqlatch_read - copy a consistent snapshot of @latch into *@dst
+ *
+ * Returns the number of retries, zero unless a writer overtook us.
+ */
+#define seqlatch_read(latch, dst)					\
+({									\
+	unsigned __seq, __retries = 0;					\
+									\
+	for (;;) {							\
+		__seq = raw_read_seqcount_latch(&(latch)->seq);		\
+		*(dst) = (latch)->data[__seq & 1];			\
+		if (!read_seqcount_latch_retry(&(latch)->seq, __seq))	\
+			break;						\
+		__retries++;						\
+	}								\
+	__retries;							\
+})
+
+/* seqlatch_write - publish *@src; readers see the old or new value */
+#define seqlatch_write(latch, src)					\
+do {									\
+	queued_spin_lock(&(latch)->lock);				\
+	raw_write_seqcount_latch(&(latch)->seq);			\
+	(latch)->data[0] = *(src);					\
+	raw_write_seqcount_latch(&(latch)->seq);			\
+	(latch)->data[1] = *(src);					\
+	queued_spin_unlock(&(latch)->lock);				\
+} while (0)
+
+#endif
@@ -0,0 +1,269 @@
+/*
+ * Seqcount latch benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: seqlatch_bench [-t max_readers] [-d msecs] [-p writer_pause]
+ *
+ * One writer thread republishes a 16-word snapshot (two cache lines,
+ * timekeeper sized) in a loop, pausing writer_pause spins between
+ * updates, while 1, 2, 4, ... max_readers threads take snapshots
+ * through a mutex, seqlock_t and the latch. Every snapshot is checked
+ * for words from different updates.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "seqlatch.h"
+
+#define MAX_READERS	256
+#define SNAP_WORDS	16
+
+struct snapshot {
+	unsigned long word[SNAP_WORDS];
+};
+
+static pthread_mutex_t snap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct snapshot snap_plain ____cacheline_aligned;
+static DEFINE_SEQLOCK(snap_seqlock);
+static SEQLATCH(struct snapshot) snap_latch ____cacheline_aligned;
+
+static inline int snapshot_torn(const struct snapshot *s)
+{
+	unsigned int i;
+
+	for (i = 1; i < SNAP_WORDS; i++)
+		if (s->word[i] != s->word[0] + i)
+			return 1;
+	return 0;
+}
+
+static inline void snapshot_make(struct snapshot *s, unsigned long gen)
+{
+	unsigned int i;
+
+	for (i = 0; i < SNAP_WORDS; i++)
+		s->word[i] = gen * SNAP_WORDS + i;
+}
+
+static unsigned int mutex_read(struct snapshot *s)
+{
+	pthread_mutex_lock(&snap_mutex);
+	*s = snap_plain;
+	pthread_mutex_unlock(&snap_mutex);
+	return 0;
+}
+
+static void mutex_write(const struct snapshot *s)
+{
+	pthread_mutex_lock(&snap_mutex);
+	snap_plain = *s;
+	pthread_mutex_unlock(&snap_mutex);
+}
+
+static unsigned int seqlock_read(struct snapshot *s)
+{
+	unsigned int seq, retries = 0;
+
+	for (;;) {
+		seq = read_seqbegin(&snap_seqlock);
+		*s = snap_plain;
+		if (!read_seqretry(&snap_seqlock, seq))
+			break;
+		retries++;
+	}
+	return retries;
+}
+
+static void seqlock_write(const struct snapshot *s)
+{
+	write_seqlock(&snap_seqlock);
+	snap_plain = *s;
+	write_sequnlock(&snap_seqlock);
+}
+
+static unsigned int latch_read(struct snapshot *s)
+{
+	return seqlatch_read(&snap_latch, s);
+}
+
+static void latch_write(const struct snapshot *s)
+{
+	seqlatch_write(&snap_latch, s);
+}
+
+struct reader_type {
+	const char *name;
+	unsigned int (*read)(struct snapshot *s);
+	void (*write)(const struct snapshot *s);
+};
+
+static const struct reader_type reader_types[] = {
+	{ "mutex",	mutex_read,	mutex_write },
+	{ "seqlock_t",	seqlock_read,	seqlock_write },
+	{ "seqlatch",	latch_read,	latch_write },
+};
+#define NR_READER_TYPES	(sizeof(reader_types) / sizeof(reader_types[0]))
+
+struct worker {
+	pthread_t tid;
+	int cpu;
+	unsigned long ops;
+	unsigned long retries;
+	unsigned long torn;
+} ____cacheline_aligned;
+
+static struct worker readers[MAX_READERS], writer;
+static const struct reader_type *cur;
+static unsigned int writer_pause;
+static int start_flag, stop_flag;
+static unsigned int nr_ready;
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void wait_start(void)
+{
+	__atomic_fetch_add(&nr_ready, 1, __ATOMIC_RELAXED);
+	while (!smp_load_acquire(&start_flag))
+		cpu_relax();
+}
+
+static void *reader_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct snapshot s;
+
+	pin(w->cpu);
+	wait_start();
+	while (!READ_ONCE(stop_flag)) {
+		w->retries += cur->read(&s);
+		w->torn += snapshot_torn(&s);
+		w->ops++;
+	}
+	return NULL;
+}
+
+static void *writer_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct snapshot s;
+	unsigned int i;
+
+	pin(w->cpu);
+	wait_start();
+	while (!READ_ONCE(stop_flag)) {
+		snapshot_make(&s, ++w->ops);
+		cur->write(&s);
+		for (i = 0; i < writer_pause; i++)
+			cpu_relax();
+	}
+	return NULL;
+}
+
+static void run(int nr_readers, unsigned int msecs)
+{
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	struct timespec ts = { msecs / 1000, (msecs % 1000) * 1000000L };
+	unsigned long ops = 0, retries = 0, torn = 0;
+	struct snapshot s;
+	int t;
+
+	snapshot_make(&s, 0);
+	snap_plain = s;
+	snap_latch.data[0] = snap_latch.data[1] = s;
+	start_flag = stop_flag = 0;
+	nr_ready = 0;
+
+	/* The writer gets CPU 0, readers the CPUs after it */
+	memset(&writer, 0, sizeof(writer));
+	pthread_create(&writer.tid, NULL, writer_fn, &writer);
+	for (t = 0; t < nr_readers; t++) {
+		memset(&readers[t], 0, sizeof(readers[t]));
+		readers[t].cpu = (t + 1) % ncpus;
+		pthread_create(&readers[t].tid, NULL, reader_fn, &readers[t]);
+	}
+	while (READ_ONCE(nr_ready) < (unsigned int)nr_readers + 1)
+		sched_yield();
+	smp_store_release(&start_flag, 1);
+	nanosleep(&ts, NULL);
+	WRITE_ONCE(stop_flag, 1);
+
+	pthread_join(writer.tid, NULL);
+	for (t = 0; t < nr_readers; t++) {
+		pthread_join(readers[t].tid, NULL);
+		ops += readers[t].ops;
+		retries += readers[t].retries;
+		torn += readers[t].torn;
+	}
+	printf("%-10s %7d %13.3f %13.3f %13.2f", cur->name, nr_readers,
+		ops / (msecs * 1e3), writer.ops / (msecs * 1e3),
+		ops ? retries * 1000.0 / ops : 0);
+	if (torn)
+		printf("  %lu TORN", torn);
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int max_readers = sysconf(_SC_NPROCESSORS_ONLN) - 1, opt, nr;
+	unsigned int msecs = 200;
+	size_t l;
+
+	while ((opt = getopt(argc, argv, "t:d:p:")) != -1) {
+		switch (opt) {
+		case 't':
+			max_readers = atoi(optarg);
+			break;
+		case 'd':
+			msecs = atoi(optarg);
+			break;
+		case 'p':
+			writer_pause = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t max_readers] [-d msecs] "
+				"[-p writer_pause]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (max_readers < 1)
+		max_readers = 1;
+	if (max_readers > MAX_READERS || !msecs) {
+		fprintf(stderr, "readers 1..%d, msecs > 0\n", MAX_READERS);
+		return -1;
+	}
+
+	seqlock_init(&snap_seqlock);
+	seqcount_init(&snap_latch.seq);
+	snap_latch.lock.val = 0;
+
+	printf("%ld CPUs, %u ms per run, writer pause %u\n",
+		sysconf(_SC_NPROCESSORS_ONLN), msecs, writer_pause);
+	printf("%-10s %7s %13s %13s %13s\n", "", "readers", "reads Mops/s",
+		"writes Mops/s", "retries/1000");
+	for (l = 0; l < NR_READER_TYPES; l++) {
+		cur = &reader_types[l];
+		for (nr = 1; ; nr = nr * 2 > max_readers ? max_readers : nr * 2) {
+			run(nr, msecs);
+			if (nr == max_readers)
+				break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _SEQLOCK_H
+#define _SEQLOCK_H
+/*
+ * Userspace seqcount_t and seqlock_t, after include/linux/seqlock.h.
+ *
+ * Readers never write shared memory: they sample the sequence, read,
+ * and retry if it was odd or has moved. Writers must be serialised,
+ * seqlock_t does that with a queued spinlock from ../../spinlock/Basic.
+ */
+#include "qspinlock.h"
+
+typedef struct seqcount {
+	unsigned sequence;
+} seqcount_t;
+
+#define SEQCNT_ZERO(lockname)	{ .sequence = 0 }
+
+static inline void seqcount_init(seqcount_t *s)
+{
+	s->sequence = 0;
+}
+
+/* Wait for an even sequence, i.e. no writer in progress */
+static inline unsigned __read_seqcount_begin(const seqcount_t *s)
+{
+	return smp_cond_load_relaxed((unsigned *)&s->sequence, !(VAL & 1));
+}
+
+static inline unsigned raw_read_seqcount(const seqcount_t *s)
+{
+	unsigned ret = READ_ONCE(s->sequence);
+
+	smp_rmb();
+	return ret;
+}
+
+static inline unsigned read_seqcount_begin(const seqcount_t *s)
+{
+	unsigned ret = __read_seqcount_begin(s);
+
+	smp_rmb();
+	return ret;
+}
+
+static inline int __read_seqcount_retry(const seqcount_t *s, unsigned start)
+{
+	return unlikely(READ_ONCE(s->sequence) != start);
+}
+
+static inline int read_seqcount_retry(const seqcount_t *s, unsigned start)
+{
+	smp_rmb();
+	return __read_seqcount_retry(s, start);
+}
+
+static inline void raw_write_seqcount_begin(seqcount_t *s)
+{
+	WRITE_ONCE(s->sequence, s->sequence + 1);
+	smp_wmb();
+}
+
+static inline void raw_write_seqcount_end(seqcount_t *s)
+{
+	smp_wmb();
+	WRITE_ONCE(s->sequence, s->sequence + 1);
+}
+
+#define write_seqcount_begin(s)		raw_write_seqcount_begin(s)
+#define write_seqcount_end(s)		raw_write_seqcount_end(s)
+
+/*
+ * Latch: the data is kept twice and the low bit of the sequence says
+ * which copy is stable, so readers never wait for a writer. See
+ * seqlatch.h for the usage pattern.
+ */
+static inline unsigned raw_read_seqcount_latch(const seqcount_t *s)
+{
+	/* Pairs with the first smp_wmb() in raw_write_seqcount_latch() */
+	return smp_load_acquire(&s->sequence);
+}
+
+static inline int read_seqcount_latch_retry(const seqcount_t *s,
+					    unsigned start)
+{
+	return read_seqcount_retry(s, start);
+}
+
+static inline void raw_write_seqcount_latch(seqcount_t *s)
+{
+	smp_wmb();	/* prior stores before incrementing "sequence" */
+	WRITE_ONCE(s->sequence, s->sequence + 1);
+	smp_wmb();	/* increment "sequence" before following stores */
+}
+
+typedef struct {
+	struct seqcount seqcount;
+	qspinlock_t lock;
+} seqlock_t;
+
+#define __SEQLOCK_UNLOCKED(lockname)			\
+	{						\
+		.seqcount = SEQCNT_ZERO(lockname),	\
+		.lock = __ARCH_SPIN_LOCK_UNLOCKED	\
+	}
+
+#define DEFINE_SEQLOCK(x)	seqlock_t x = __SEQLOCK_UNLOCKED(x)
+
+static inline void seqlock_init(seqlock_t *sl)
+{
+	seqcount_init(&sl->seqcount);
+	sl->lock.val = 0;
+}
+
+static inline unsigned read_seqbegin(const seqlock_t *sl)
+{
+	return read_seqcount_begin(&sl->seqcount);
+}
+
+static inline unsigned read_seqretry(const seqlock_t *sl, unsigned start)
+{
+	return read_seqcount_retry(&sl->seqcount, start);
+}
+
+static inline void write_seqlock(seqlock_t *sl)
+{
+	queued_spin_lock(&sl->lock);
+	write_seqcount_begin(&sl->seqcount);
+}
+
+static inline void write_sequnlock(seqlock_t *sl)
+{
+	write_seqcount_end(&sl->seqcount);
+	queued_spin_unlock(&sl->lock);
+}
+
+#endif
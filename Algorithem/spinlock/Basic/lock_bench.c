@@ -0,0 +1,251 @@
+/*
+ * Spinlock benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: lock_bench [-t max_threads] [-d msecs] [-c cs_len,...]
+ *                   [-o outside_len] [-l lock,...]
+ *
+ * For every lock, thread count (1, 2, 4, ... max_threads) and critical
+ * section length, all threads loop on lock / cs_len shared cache-line
+ * updates / unlock / outside_len private work for msecs. Prints the
+ * throughput and the fairness of the split: Jain's index over the per
+ * thread acquisitions (1.0 all equal, 1/n one thread got them all)
+ * and the min/max ratio.
+ *
+ * The protected counters are checked afterwards, so a broken lock
+ * shows up as an error rather than as a fast result.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "spinlock.h"
+#include "mcs_spinlock.h"
+#include "qspinlock.h"
+
+#define MAX_THREADS	256
+#define MAX_CS		16
+#define CS_LINES	4
+
+struct lock_type {
+	const char *name;
+	void (*lock)(void);
+	void (*unlock)(void);
+};
+
+/* The lock under test and the data it protects, on separate lines */
+static union {
+	tas_lock_t tas;
+	ticket_lock_t ticket;
+	struct mcs_spinlock *mcs;
+	qspinlock_t q;
+} test_lock ____cacheline_aligned;
+
+static struct {
+	unsigned long val[SMP_CACHE_BYTES / sizeof(unsigned long)];
+} shared[CS_LINES] ____cacheline_aligned;
+
+static __thread struct mcs_spinlock mcs_node ____cacheline_aligned;
+
+static void do_tas_lock(void)		{ tas_lock(&test_lock.tas); }
+static void do_ttas_lock(void)		{ ttas_lock(&test_lock.tas); }
+static void do_tas_unlock(void)		{ tas_unlock(&test_lock.tas); }
+static void do_ticket_lock(void)	{ ticket_lock(&test_lock.ticket); }
+static void do_ticket_unlock(void)	{ ticket_unlock(&test_lock.ticket); }
+static void do_mcs_lock(void)		{ mcs_spin_lock(&test_lock.mcs, &mcs_node); }
+static void do_mcs_unlock(void)		{ mcs_spin_unlock(&test_lock.mcs, &mcs_node); }
+static void do_q_lock(void)		{ queued_spin_lock(&test_lock.q); }
+static void do_q_unlock(void)		{ queued_spin_unlock(&test_lock.q); }
+
+static const struct lock_type lock_types[] = {
+	{ "tas",	do_tas_lock,	do_tas_unlock },
+	{ "ttas",	do_ttas_lock,	do_tas_unlock },
+	{ "ticket",	do_ticket_lock,	do_ticket_unlock },
+	{ "mcs",	do_mcs_lock,	do_mcs_unlock },
+	{ "qspinlock",	do_q_lock,	do_q_unlock },
+};
+#define NR_LOCK_TYPES	(sizeof(lock_types) / sizeof(lock_types[0]))
+
+struct worker {
+	pthread_t tid;
+	int cpu;
+	unsigned long ops;
+} ____cacheline_aligned;
+
+static struct worker workers[MAX_THREADS];
+static const struct lock_type *cur_lock;
+static unsigned int cs_len, outside_len;
+static int start_flag, stop_flag;
+static unsigned int nr_ready;
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	unsigned long ops = 0, priv = 0;
+	unsigned int i;
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	__atomic_fetch_add(&nr_ready, 1, __ATOMIC_RELAXED);
+	while (!smp_load_acquire(&start_flag))
+		cpu_relax();
+
+	while (!READ_ONCE(stop_flag)) {
+		cur_lock->lock();
+		for (i = 0; i < cs_len; i++)
+			shared[i % CS_LINES].val[0]++;
+		cur_lock->unlock();
+		ops++;
+		for (i = 0; i < outside_len; i++) {
+			priv++;
+			barrier();
+		}
+	}
+	w->ops = ops;
+	return NULL;
+}
+
+/* Run one configuration, returns non-zero if the counters are off */
+static int run(int nr_threads, unsigned int msecs, double *mops,
+	       double *jain, double *minmax)
+{
+	unsigned long total = 0, expect = 0, min = ~0UL, max = 0;
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	struct timespec ts = { msecs / 1000, (msecs % 1000) * 1000000L };
+	double sumsq = 0;
+	int t, l;
+
+	memset(&test_lock, 0, sizeof(test_lock));
+	memset(shared, 0, sizeof(shared));
+	start_flag = stop_flag = 0;
+	nr_ready = 0;
+
+	for (t = 0; t < nr_threads; t++) {
+		workers[t].cpu = t % ncpus;
+		workers[t].ops = 0;
+		pthread_create(&workers[t].tid, NULL, worker_fn, &workers[t]);
+	}
+	while (READ_ONCE(nr_ready) < (unsigned int)nr_threads)
+		sched_yield();
+	smp_store_release(&start_flag, 1);
+	nanosleep(&ts, NULL);
+	WRITE_ONCE(stop_flag, 1);
+
+	for (t = 0; t < nr_threads; t++) {
+		pthread_join(workers[t].tid, NULL);
+		total += workers[t].ops;
+		sumsq += (double)workers[t].ops * workers[t].ops;
+		if (workers[t].ops < min)
+			min = workers[t].ops;
+		if (workers[t].ops > max)
+			max = workers[t].ops;
+	}
+	*mops = total / (msecs * 1e3);
+	*jain = sumsq ? (double)total * total / (nr_threads * sumsq) : 0;
+	*minmax = max ? (double)min / max : 0;
+
+	for (l = 0; l < CS_LINES; l++)
+		expect += shared[l].val[0];
+	return expect != total * cs_len;
+}
+
+/* Parse "a,b,c" into @out, returns the count */
+static int parse_list(char *arg, unsigned int *out, int max)
+{
+	char *tok;
+	int n = 0;
+
+	for (tok = strtok(arg, ","); tok && n < max; tok = strtok(NULL, ","))
+		out[n++] = strtoul(tok, NULL, 0);
+	return n;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int cs_lens[MAX_CS] = { 0, 10, 100, 1000 };
+	int nr_cs = 4, max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int msecs = 200, c;
+	unsigned long lock_mask = (1UL << NR_LOCK_TYPES) - 1;
+	int opt, nr, errors = 0;
+	char *tok;
+	size_t l;
+
+	while ((opt = getopt(argc, argv, "t:d:c:o:l:")) != -1) {
+		switch (opt) {
+		case 't':
+			max_threads = atoi(optarg);
+			break;
+		case 'd':
+			msecs = atoi(optarg);
+			break;
+		case 'c':
+			nr_cs = parse_list(optarg, cs_lens, MAX_CS);
+			break;
+		case 'o':
+			outside_len = atoi(optarg);
+			break;
+		case 'l':
+			lock_mask = 0;
+			for (tok = strtok(optarg, ","); tok;
+			     tok = strtok(NULL, ","))
+				for (l = 0; l < NR_LOCK_TYPES; l++)
+					if (!strcmp(tok, lock_types[l].name))
+						lock_mask |= 1UL << l;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-t max_threads] [-d msecs] "
+				"[-c cs_len,...] [-o outside_len] "
+				"[-l lock,...]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (max_threads < 1 || max_threads > MAX_THREADS || !msecs) {
+		fprintf(stderr, "threads 1..%d, msecs > 0\n", MAX_THREADS);
+		return -1;
+	}
+
+	printf("%ld CPUs, %u ms per run, %u outside loops\n",
+		sysconf(_SC_NPROCESSORS_ONLN), msecs, outside_len);
+	if (max_threads > sysconf(_SC_NPROCESSORS_ONLN))
+		printf("More threads than CPUs: waiters spin on preempted "
+			"owners, the queued locks suffer most\n");
+	printf("%-10s %7s %6s %12s %8s %8s\n", "lock", "threads", "cs",
+		"Mops/s", "jain", "min/max");
+
+	for (l = 0; l < NR_LOCK_TYPES; l++) {
+		if (!(lock_mask & (1UL << l)))
+			continue;
+		cur_lock = &lock_types[l];
+		for (c = 0; c < (unsigned int)nr_cs; c++) {
+			cs_len = cs_lens[c];
+			for (nr = 1; nr <= max_threads;
+			     nr = nr < max_threads && nr * 2 > max_threads ?
+				  max_threads : nr * 2) {
+				double mops, jain, minmax;
+				int bad;
+
+				bad = run(nr, msecs, &mops, &jain, &minmax);
+				errors += bad;
+				printf("%-10s %7d %6u %12.3f %8.3f %8.3f%s\n",
+					cur_lock->name, nr, cs_len, mops,
+					jain, minmax, bad ? "  BROKEN" : "");
+				if (nr == max_threads)
+					break;
+			}
+		}
+	}
+	return errors ? -1 : 0;
+}
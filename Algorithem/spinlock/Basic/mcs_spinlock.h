@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _MCS_SPINLOCK_H
+#define _MCS_SPINLOCK_H
+/*
+ * MCS lock, port of kernel/locking/mcs_spinlock.h.
+ *
+ * The lock is a pointer to the last waiter. Each locker brings its own
+ * node and spins on node->locked, which only its predecessor writes,
+ * so a release touches exactly one other cache line.
+ */
+#include <stddef.h>
+
+#include "spinlock.h"
+
+struct mcs_spinlock {
+	struct mcs_spinlock *next;
+	int locked;	/* 1 if lock acquired */
+	int count;	/* nesting count, see qspinlock.c */
+};
+
+/* Spin until our predecessor hands the lock over */
+#define arch_mcs_spin_lock_contended(l)		\
+	smp_cond_load_acquire(l, VAL)
+
+#define arch_mcs_spin_unlock_contended(l)	\
+	smp_store_release((l), 1)
+
+static inline void mcs_spin_lock(struct mcs_spinlock **lock,
+				 struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *prev;
+
+	/* Init node */
+	node->locked = 0;
+	node->next = NULL;
+
+	/*
+	 * The xchg orders the node initialisation before publishing it,
+	 * and acquires the lock when there was no tail.
+	 */
+	prev = __atomic_exchange_n(lock, node, __ATOMIC_ACQ_REL);
+	if (likely(prev == NULL))
+		return;
+	WRITE_ONCE(prev->next, node);
+
+	/* Wait until the lock holder passes the lock down. */
+	arch_mcs_spin_lock_contended(&node->locked);
+}
+
+static inline void mcs_spin_unlock(struct mcs_spinlock **lock,
+				   struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next = READ_ONCE(node->next);
+
+	if (likely(!next)) {
+		struct mcs_spinlock *expected = node;
+
+		/* Release the lock by setting it to NULL */
+		if (likely(__atomic_compare_exchange_n(lock, &expected, NULL,
+				0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)))
+			return;
+		/* Wait until the next pointer is set */
+		next = smp_cond_load_relaxed(&node->next, VAL);
+	}
+
+	/* Pass lock to next waiter. */
+	arch_mcs_spin_unlock_contended(&next->locked);
+}
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * Queued spinlock slow path.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <pthread.h>
+
+#include "qspinlock.h"
+
+/*
+ * Four nodes per thread, one per nesting level, as the kernel keeps
+ * one per context (task, softirq, hardirq, nmi). A thread only ever
+ * spins on its own nodes, so each set gets a cache line to itself.
+ */
+#define MAX_NODES		4
+#define _Q_PENDING_LOOPS	1
+
+struct qnode {
+	struct mcs_spinlock mcs;
+};
+
+static struct qnode qnodes[QSPIN_MAX_THREADS][MAX_NODES] ____cacheline_aligned;
+static __thread int qnode_slot = -1;
+
+/*
+ * Slots of threads that have exited go back on a free list through the
+ * key destructor; a thread holds no lock by then, so nobody else is
+ * looking at its nodes. Taking a slot happens once per thread.
+ */
+static pthread_mutex_t qnode_free_lock = PTHREAD_MUTEX_INITIALIZER;
+static int qnode_free[QSPIN_MAX_THREADS];
+static unsigned int qnode_nr_free;
+static unsigned int qnode_slots;
+static pthread_key_t qnode_key;
+static pthread_once_t qnode_once = PTHREAD_ONCE_INIT;
+
+static void qnode_put_slot(void *arg)
+{
+	pthread_mutex_lock(&qnode_free_lock);
+	qnode_free[qnode_nr_free++] = (int)(long)arg - 1;
+	pthread_mutex_unlock(&qnode_free_lock);
+}
+
+static void qnode_key_init(void)
+{
+	pthread_key_create(&qnode_key, qnode_put_slot);
+}
+
+/* Slot of the calling thread, -1 while all of them are taken */
+static inline int qnode_this_slot(void)
+{
+	int slot = -1;
+
+	if (likely(qnode_slot >= 0))
+		return qnode_slot;
+
+	pthread_once(&qnode_once, qnode_key_init);
+	pthread_mutex_lock(&qnode_free_lock);
+	if (qnode_nr_free)
+		slot = qnode_free[--qnode_nr_free];
+	else if (qnode_slots < QSPIN_MAX_THREADS)
+		slot = qnode_slots++;
+	pthread_mutex_unlock(&qnode_free_lock);
+
+	if (slot >= 0) {
+		qnode_slot = slot;
+		pthread_setspecific(qnode_key, (void *)(long)(slot + 1));
+	}
+	return slot;
+}
+
+static inline uint32_t encode_tail(int slot, int idx)
+{
+	uint32_t tail;
+
+	tail  = (slot + 1) << _Q_TAIL_CPU_OFFSET;
+	tail |= idx << _Q_TAIL_IDX_OFFSET; /* assume < 4 */
+
+	return tail;
+}
+
+static inline struct mcs_spinlock *decode_tail(uint32_t tail)
+{
+	int slot = (tail >> _Q_TAIL_CPU_OFFSET) - 1;
+	int idx = (tail &  _Q_TAIL_IDX_MASK) >> _Q_TAIL_IDX_OFFSET;
+
+	return &qnodes[slot][idx].mcs;
+}
+
+/* *,1,0 -> *,0,0 */
+static inline void clear_pending(struct qspinlock *lock)
+{
+	WRITE_ONCE(lock->pending, 0);
+}
+
+/* *,1,0 -> *,0,1 */
+static inline void clear_pending_set_locked(struct qspinlock *lock)
+{
+	WRITE_ONCE(lock->locked_pending, _Q_LOCKED_VAL);
+}
+
+/* *,*,0 -> *,0,1 */
+static inline void set_locked(struct qspinlock *lock)
+{
+	WRITE_ONCE(lock->locked, _Q_LOCKED_VAL);
+}
+
+/* p,*,* -> n,*,* ; returns the old tail word */
+static inline uint32_t xchg_tail(struct qspinlock *lock, uint32_t tail)
+{
+	/* Publishes the node initialisation, hence release */
+	return (uint32_t)__atomic_exchange_n(&lock->tail,
+			(uint16_t)(tail >> _Q_TAIL_OFFSET),
+			__ATOMIC_RELEASE) << _Q_TAIL_OFFSET;
+}
+
+/* *,*,* -> *,1,* */
+static inline uint32_t queued_fetch_set_pending_acquire(struct qspinlock *lock)
+{
+	return __atomic_fetch_or(&lock->val, _Q_PENDING_VAL, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * queued_spin_lock_slowpath - acquire the queued spinlock
+ * @lock: Pointer to queued spinlock structure
+ * @val: Current value of the queued spinlock 32-bit word
+ *
+ * (queue tail, pending bit, lock value)
+ *
+ *              fast     :    slow                                  :    unlock
+ *                       :                                          :
+ * uncontended  (0,0,0) -:--> (0,0,1) ------------------------------:--> (*,*,0)
+ *                       :       | ^--------.------.             /  :
+ *                       :       v           \      \            |  :
+ * pending               :    (0,1,1) +--> (0,1,0)   \           |  :
+ *                       :       | ^--'              |           |  :
+ *                       :       v                   |           |  :
+ * uncontended           :    (n,x,y) +--> (n,0,0) --'           |  :
+ *   queue               :       | ^--'                          |  :
+ *                       :       v                               |  :
+ * contended             :    (*,x,y) +--> (*,0,0) ---> (*,0,1) -'  :
+ *   queue               :         ^--'                             :
+ */
+void queued_spin_lock_slowpath(struct qspinlock *lock, uint32_t val)
+{
+	struct mcs_spinlock *prev, *next, *node;
+	uint32_t old, tail;
+	int slot, idx;
+
+	/*
+	 * Wait for in-progress pending->locked hand-overs with a bounded
+	 * number of spins so that we guarantee forward progress.
+	 *
+	 * 0,1,0 -> 0,0,1
+	 */
+	if (val == _Q_PENDING_VAL) {
+		int cnt = _Q_PENDING_LOOPS;
+
+		val = smp_cond_load_relaxed(&lock->val,
+				(VAL != _Q_PENDING_VAL) || !cnt--);
+	}
+
+	/*
+	 * If we observe any contention; queue.
+	 */
+	if (val & ~_Q_LOCKED_MASK)
+		goto queue;
+
+	/*
+	 * trylock || pending
+	 *
+	 * 0,0,* -> 0,1,* -> 0,0,1 pending, trylock
+	 */
+	val = queued_fetch_set_pending_acquire(lock);
+
+	/*
+	 * If we observe contention, there is a concurrent locker.
+	 *
+	 * Undo and queue; our setting of PENDING might have made the
+	 * n,0,0 -> 0,0,0 transition fail and it will now be waiting
+	 * on @next to become !NULL.
+	 */
+	if (unlikely(val & ~_Q_LOCKED_MASK)) {
+		/* Undo PENDING if we set it. */
+		if (!(val & _Q_PENDING_MASK))
+			clear_pending(lock);
+		goto queue;
+	}
+
+	/*
+	 * We're pending, wait for the owner to go away.
+	 *
+	 * 0,1,1 -> 0,1,0
+	 *
+	 * this wait loop must be a load-acquire such that we match the
+	 * store-release that clears the locked bit and create lock
+	 * sequentiality; this is because not all
+	 * clear_pending_set_locked() implementations imply full
+	 * barriers.
+	 */
+	if (val & _Q_LOCKED_MASK)
+		smp_cond_load_acquire(&lock->val, !(VAL & _Q_LOCKED_MASK));
+
+	/*
+	 * take ownership and clear the pending bit.
+	 *
+	 * 0,1,0 -> 0,0,1
+	 */
+	clear_pending_set_locked(lock);
+	return;
+
+	/*
+	 * End of pending bit optimistic spinning and beginning of MCS
+	 * queuing.
+	 */
+queue:
+	slot = qnode_this_slot();
+	if (unlikely(slot < 0)) {
+		while (!queued_spin_trylock(lock))
+			cpu_relax();
+		return;
+	}
+	node = &qnodes[slot][0].mcs;
+	idx = node->count++;
+	tail = encode_tail(slot, idx);
+
+	/*
+	 * Nested deeper than MAX_NODES: fall back to spinning on the
+	 * lock directly, which is not fair but always makes progress.
+	 */
+	if (unlikely(idx >= MAX_NODES)) {
+		while (!queued_spin_trylock(lock))
+			cpu_relax();
+		goto release;
+	}
+
+	node = &qnodes[slot][idx].mcs;
+
+	/*
+	 * Ensure that we increment the head node->count before initialising
+	 * the actual node. If the queue is nested, we need to make sure
+	 * that the new node is initialised before we publish it.
+	 */
+	barrier();
+
+	node->locked = 0;
+	node->next = NULL;
+
+	/*
+	 * We touched a (possibly) cold cacheline in the per-thread queue
+	 * node; attempt the trylock once more in the hope someone let go
+	 * while we weren't watching.
+	 */
+	if (queued_spin_trylock(lock))
+		goto release;
+
+	/*
+	 * Publish the updated tail.
+	 *
+	 * p,*,* -> n,*,*
+	 */
+	old = xchg_tail(lock, tail);
+	next = NULL;
+
+	/*
+	 * if there was a previous node; link it and wait until reaching the
+	 * head of the waitqueue.
+	 */
+	if (old & _Q_TAIL_MASK) {
+		prev = decode_tail(old);
+
+		/* Link @node into the waitqueue. */
+		WRITE_ONCE(prev->next, node);
+
+		arch_mcs_spin_lock_contended(&node->locked);
+
+		/*
+		 * While waiting for the MCS lock, the next pointer may have
+		 * been set by another lock waiter. Load it now so the store
+		 * to the lock word below does not delay it.
+		 */
+		next = READ_ONCE(node->next);
+		if (next)
+			__builtin_prefetch(next, 1);
+	}
+
+	/*
+	 * we're at the head of the waitqueue, wait for the owner & pending
+	 * to go away.
+	 *
+	 * *,x,y -> *,0,0
+	 *
+	 * this wait loop must use a load-acquire such that we match the
+	 * store-release that clears the locked bit and create lock
+	 * sequentiality.
+	 */
+	val = smp_cond_load_acquire(&lock->val,
+				    !(VAL & _Q_LOCKED_PENDING_MASK));
+
+	/*
+	 * claim the lock:
+	 *
+	 * n,0,0 -> 0,0,1 : lock, uncontended
+	 * *,*,0 -> *,*,1 : lock, contended
+	 *
+	 * If the queue head is the only one in the queue (lock value ==
+	 * tail) and nobody is pending, clear the tail code and grab the
+	 * lock. Otherwise, we only need to grab the lock.
+	 */
+	if ((val & _Q_TAIL_MASK) == tail) {
+		if (__atomic_compare_exchange_n(&lock->val, &val,
+				_Q_LOCKED_VAL, 0, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED))
+			goto release; /* No contention */
+	}
+
+	/*
+	 * Either somebody is queued behind us or _Q_PENDING_VAL got set
+	 * which will then detect the remaining tail and queue behind us
+	 * ensuring we'll see a @next.
+	 */
+	set_locked(lock);
+
+	/*
+	 * contended path; wait for next if not observed yet, release.
+	 */
+	if (!next)
+		next = smp_cond_load_relaxed(&node->next, (VAL));
+
+	arch_mcs_spin_unlock_contended(&next->locked);
+
+release:
+	/*
+	 * release the node
+	 */
+	qnodes[slot][0].mcs.count--;
+}
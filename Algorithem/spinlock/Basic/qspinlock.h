@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _QSPINLOCK_H
+#define _QSPINLOCK_H
+/*
+ * Queued spinlock, port of kernel/locking/qspinlock.c without the
+ * paravirt hooks.
+ *
+ * The whole lock is one 32-bit word, so it embeds like a ticket lock,
+ * while waiters queue MCS style on nodes owned by each thread:
+ *
+ *  31                    18 17  16 15      9   8   7        0
+ * +------------------------+------+---------+-----+----------+
+ * |   tail thread slot + 1 | idx  |  unused | pend|  locked  |
+ * +------------------------+------+---------+-----+----------+
+ *
+ * Uncontended: one cmpxchg 0 -> locked. One waiter: it sets pending and
+ * spins on the lock word, no queue node is touched. From the second
+ * waiter on, they queue and only the queue head spins on the lock word.
+ */
+#include "mcs_spinlock.h"
+
+typedef struct qspinlock {
+	union {
+		uint32_t val;
+		struct {
+			uint8_t locked;
+			uint8_t pending;
+		};
+		struct {
+			uint16_t locked_pending;
+			uint16_t tail;
+		};
+	};
+} qspinlock_t;
+
+#define __ARCH_SPIN_LOCK_UNLOCKED	{ { 0 } }
+
+#define _Q_LOCKED_OFFSET	0
+#define _Q_LOCKED_BITS		8
+#define _Q_LOCKED_MASK		(((1U << _Q_LOCKED_BITS) - 1) << _Q_LOCKED_OFFSET)
+
+#define _Q_PENDING_OFFSET	(_Q_LOCKED_OFFSET + _Q_LOCKED_BITS)
+#define _Q_PENDING_BITS		8
+#define _Q_PENDING_MASK		(((1U << _Q_PENDING_BITS) - 1) << _Q_PENDING_OFFSET)
+
+#define _Q_TAIL_IDX_OFFSET	(_Q_PENDING_OFFSET + _Q_PENDING_BITS)
+#define _Q_TAIL_IDX_BITS	2
+#define _Q_TAIL_IDX_MASK	(((1U << _Q_TAIL_IDX_BITS) - 1) << _Q_TAIL_IDX_OFFSET)
+
+#define _Q_TAIL_CPU_OFFSET	(_Q_TAIL_IDX_OFFSET + _Q_TAIL_IDX_BITS)
+#define _Q_TAIL_CPU_BITS	(32 - _Q_TAIL_CPU_OFFSET)
+#define _Q_TAIL_CPU_MASK	(((1U << _Q_TAIL_CPU_BITS) - 1) << _Q_TAIL_CPU_OFFSET)
+
+#define _Q_TAIL_OFFSET		_Q_TAIL_IDX_OFFSET
+#define _Q_TAIL_MASK		(_Q_TAIL_IDX_MASK | _Q_TAIL_CPU_MASK)
+
+#define _Q_LOCKED_VAL		(1U << _Q_LOCKED_OFFSET)
+#define _Q_PENDING_VAL		(1U << _Q_PENDING_OFFSET)
+#define _Q_LOCKED_PENDING_MASK	(_Q_LOCKED_MASK | _Q_PENDING_MASK)
+
+/*
+ * Queue nodes are per thread instead of per CPU. Threads get a slot on
+ * their first contended lock and keep it until they exit; with more
+ * than QSPIN_MAX_THREADS threads alive the rest spin with trylock
+ * instead of queueing.
+ */
+#define QSPIN_MAX_THREADS	1024
+
+extern void queued_spin_lock_slowpath(struct qspinlock *lock, uint32_t val);
+
+static inline int queued_spin_is_locked(struct qspinlock *lock)
+{
+	return READ_ONCE(lock->val);
+}
+
+static inline int queued_spin_trylock(struct qspinlock *lock)
+{
+	uint32_t val = READ_ONCE(lock->val);
+
+	if (unlikely(val))
+		return 0;
+	return likely(__atomic_compare_exchange_n(&lock->val, &val,
+			_Q_LOCKED_VAL, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+}
+
+static inline void queued_spin_lock(struct qspinlock *lock)
+{
+	uint32_t val = 0;
+
+	if (likely(__atomic_compare_exchange_n(&lock->val, &val, _Q_LOCKED_VAL,
+			0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)))
+		return;
+	queued_spin_lock_slowpath(lock, val);
+}
+
+static inline void queued_spin_unlock(struct qspinlock *lock)
+{
+	/* Only the locked byte: pending and tail belong to the waiters */
+	smp_store_release(&lock->locked, 0);
+}
+
+#endif
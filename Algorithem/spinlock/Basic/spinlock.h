@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _SPINLOCK_H
+#define _SPINLOCK_H
+/*
+ * Userspace spinlocks: test-and-set, ticket, MCS and qspinlock.
+ *
+ * The simple locks all spin on the lock word itself, so every waiter
+ * pulls the same cache line on every release. The ticket lock adds
+ * FIFO order but not locality; MCS and qspinlock give each waiter its
+ * own line to spin on (see mcs_spinlock.h and qspinlock.h).
+ */
+#include <stdint.h>
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+#define SMP_CACHE_BYTES		64
+#define ____cacheline_aligned	__attribute__((aligned(SMP_CACHE_BYTES)))
+
+#define barrier()		__asm__ __volatile__("" : : : "memory")
+#define READ_ONCE(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, v)	__atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define smp_load_acquire(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define smp_mb()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb()		__atomic_thread_fence(__ATOMIC_RELEASE)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax()		__asm__ __volatile__("pause" : : : "memory")
+#elif defined(__aarch64__)
+#define cpu_relax()		__asm__ __volatile__("yield" : : : "memory")
+#else
+#define cpu_relax()		barrier()
+#endif
+
+/*
+ * smp_cond_load_acquire - spin until @cond_expr holds for *@ptr
+ *
+ * VAL names the value just loaded inside @cond_expr, as in the kernel.
+ */
+#define smp_cond_load_relaxed(ptr, cond_expr) ({		\
+	__typeof__(*(ptr)) VAL;					\
+	for (;;) {						\
+		VAL = __atomic_load_n((ptr), __ATOMIC_RELAXED);	\
+		if (cond_expr)					\
+			break;					\
+		cpu_relax();					\
+	}							\
+	VAL;							\
+})
+
+#define smp_cond_load_acquire(ptr, cond_expr) ({		\
+	__typeof__(*(ptr)) VAL;					\
+	for (;;) {						\
+		VAL = __atomic_load_n((ptr), __ATOMIC_ACQUIRE);	\
+		if (cond_expr)					\
+			break;					\
+		cpu_relax();					\
+	}							\
+	VAL;							\
+})
+
+/*
+ * Test-and-set. tas_lock() hammers the line with xchg; ttas_lock()
+ * only retries the xchg once a plain load has seen the lock free.
+ */
+typedef struct {
+	uint32_t locked;
+} tas_lock_t;
+
+#define TAS_LOCK_UNLOCKED	{ 0 }
+
+static inline void tas_lock(tas_lock_t *lock)
+{
+	while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE))
+		cpu_relax();
+}
+
+static inline void ttas_lock(tas_lock_t *lock)
+{
+	while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE))
+		smp_cond_load_relaxed(&lock->locked, !VAL);
+}
+
+static inline int tas_trylock(tas_lock_t *lock)
+{
+	return !READ_ONCE(lock->locked) &&
+		!__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE);
+}
+
+static inline void tas_unlock(tas_lock_t *lock)
+{
+	smp_store_release(&lock->locked, 0);
+}
+
+/*
+ * Ticket lock, as the x86 arch_spinlock_t before qspinlock: take a
+ * ticket from tail, wait until head gets there. Strict FIFO.
+ */
+typedef struct {
+	union {
+		uint32_t head_tail;
+		struct {
+			uint16_t head;
+			uint16_t tail;
+		} tickets;
+	};
+} ticket_lock_t;
+
+#define TICKET_LOCK_UNLOCKED	{ { 0 } }
+#define TICKET_SHIFT		16
+
+static inline void ticket_lock(ticket_lock_t *lock)
+{
+	uint32_t inc = __atomic_fetch_add(&lock->head_tail, 1 << TICKET_SHIFT,
+					  __ATOMIC_ACQUIRE);
+	uint16_t ticket = inc >> TICKET_SHIFT;
+
+	if (likely((uint16_t)inc == ticket))
+		return;
+	smp_cond_load_acquire(&lock->tickets.head, VAL == ticket);
+}
+
+static inline int ticket_trylock(ticket_lock_t *lock)
+{
+	uint32_t old = READ_ONCE(lock->head_tail);
+
+	if ((uint16_t)old != (uint16_t)(old >> TICKET_SHIFT))
+		return 0;
+	return __atomic_compare_exchange_n(&lock->head_tail, &old,
+			old + (1 << TICKET_SHIFT), 0, __ATOMIC_ACQUIRE,
+			__ATOMIC_RELAXED);
+}
+
+static inline void ticket_unlock(ticket_lock_t *lock)
+{
+	/* Only the owner writes head */
+	smp_store_release(&lock->tickets.head,
+			  (uint16_t)(READ_ONCE(lock->tickets.head) + 1));
+}
+
+#endif
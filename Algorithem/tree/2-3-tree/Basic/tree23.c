@@ -701,6 +701,7 @@ static struct tree23_node * mrmval(float val, struct tree23_node * top_node)
 			break;
 		}
 	} 
+	return NULL;
 }
 
 /* Discerns which child the node is.
@@ -0,0 +1,555 @@
+/*
+ * B+Tree with cache-line sized nodes.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "bptree.h"
+
+#define BPTREE_LEAF_MIN		(BPTREE_LEAF_MAX / 2)
+#define BPTREE_INNER_MIN	(BPTREE_INNER_MAX / 2)
+
+#define to_leaf(n)	((struct bptree_leaf *)(n))
+#define to_inner(n)	((struct bptree_inner *)(n))
+
+static void *bptree_node_alloc(int leaf)
+{
+	struct bptree_node *node;
+
+	node = aligned_alloc(L1_CACHE_BYTES, BPTREE_NODE_SIZE);
+	if (!node)
+		return NULL;
+	memset(node, 0, BPTREE_NODE_SIZE);
+	node->leaf = leaf;
+	return node;
+}
+
+/* Index of the child of @inner which covers @key */
+static inline unsigned int bptree_inner_slot(const struct bptree_inner *inner,
+					     unsigned long key)
+{
+	unsigned int lo = 0, hi = inner->node.nr;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (key < inner->keys[mid])
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/* Index of the first key of @leaf which is not below @key */
+static inline unsigned int bptree_leaf_slot(const struct bptree_leaf *leaf,
+					    unsigned long key)
+{
+	unsigned int lo = 0, hi = leaf->node.nr;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (leaf->keys[mid] < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static struct bptree_leaf *bptree_find_leaf(struct bptree *tree,
+					    unsigned long key)
+{
+	struct bptree_node *node = tree->root;
+
+	if (!node)
+		return NULL;
+	while (!node->leaf) {
+		struct bptree_inner *inner = to_inner(node);
+
+		node = inner->child[bptree_inner_slot(inner, key)];
+	}
+	return to_leaf(node);
+}
+
+/*
+ * bptree_lookup - find the value stored under @key
+ *
+ * Returns NULL if @key is not in the tree.
+ */
+void *bptree_lookup(struct bptree *tree, unsigned long key)
+{
+	struct bptree_leaf *leaf = bptree_find_leaf(tree, key);
+	unsigned int pos;
+
+	if (!leaf)
+		return NULL;
+	pos = bptree_leaf_slot(leaf, key);
+	if (pos < leaf->node.nr && leaf->keys[pos] == key)
+		return leaf->vals[pos];
+	return NULL;
+}
+
+/*
+ * bptree_update - replace the value stored under @key
+ *
+ * Returns 0 on success, -ENOENT if @key is not in the tree.
+ */
+int bptree_update(struct bptree *tree, unsigned long key, void *val)
+{
+	struct bptree_leaf *leaf = bptree_find_leaf(tree, key);
+	unsigned int pos;
+
+	if (!leaf)
+		return -ENOENT;
+	pos = bptree_leaf_slot(leaf, key);
+	if (pos >= leaf->node.nr || leaf->keys[pos] != key)
+		return -ENOENT;
+	leaf->vals[pos] = val;
+	return 0;
+}
+
+static void bptree_leaf_insert_at(struct bptree_leaf *leaf, unsigned int pos,
+				  unsigned long key, void *val)
+{
+	unsigned int nr = leaf->node.nr;
+
+	memmove(&leaf->keys[pos + 1], &leaf->keys[pos],
+				(nr - pos) * sizeof(unsigned long));
+	memmove(&leaf->vals[pos + 1], &leaf->vals[pos],
+				(nr - pos) * sizeof(void *));
+	leaf->keys[pos] = key;
+	leaf->vals[pos] = val;
+	leaf->node.nr++;
+}
+
+static void bptree_leaf_remove_at(struct bptree_leaf *leaf, unsigned int pos)
+{
+	unsigned int nr = --leaf->node.nr;
+
+	memmove(&leaf->keys[pos], &leaf->keys[pos + 1],
+				(nr - pos) * sizeof(unsigned long));
+	memmove(&leaf->vals[pos], &leaf->vals[pos + 1],
+				(nr - pos) * sizeof(void *));
+}
+
+/* Insert @key with @right as the child just after it */
+static void bptree_inner_insert_at(struct bptree_inner *inner,
+			unsigned int pos, unsigned long key,
+			struct bptree_node *right)
+{
+	unsigned int nr = inner->node.nr;
+
+	memmove(&inner->keys[pos + 1], &inner->keys[pos],
+				(nr - pos) * sizeof(unsigned long));
+	memmove(&inner->child[pos + 2], &inner->child[pos + 1],
+				(nr - pos) * sizeof(void *));
+	inner->keys[pos] = key;
+	inner->child[pos + 1] = right;
+	inner->node.nr++;
+}
+
+/* Remove key @pos together with the child just after it */
+static void bptree_inner_remove_at(struct bptree_inner *inner,
+				   unsigned int pos)
+{
+	unsigned int nr = --inner->node.nr;
+
+	memmove(&inner->keys[pos], &inner->keys[pos + 1],
+				(nr - pos) * sizeof(unsigned long));
+	memmove(&inner->child[pos + 1], &inner->child[pos + 2],
+				(nr - pos) * sizeof(void *));
+}
+
+/*
+ * Split the full @leaf and insert the record at @pos. Appending to the
+ * last leaf keeps it full and starts a new leaf, so ascending loads end
+ * up with full leaves instead of half-full ones. The new last leaf
+ * starts below BPTREE_LEAF_MIN, removal copes with that.
+ */
+static void bptree_leaf_split(struct bptree_leaf *leaf,
+			struct bptree_leaf *new, unsigned int pos,
+			unsigned long key, void *val)
+{
+	unsigned int split;
+
+	if (pos == BPTREE_LEAF_MAX && !leaf->next)
+		split = BPTREE_LEAF_MAX;
+	else
+		split = (BPTREE_LEAF_MAX + 1) / 2;
+
+	if (pos < split)
+		split--;
+	new->node.nr = BPTREE_LEAF_MAX - split;
+	memcpy(new->keys, &leaf->keys[split],
+				new->node.nr * sizeof(unsigned long));
+	memcpy(new->vals, &leaf->vals[split], new->node.nr * sizeof(void *));
+	leaf->node.nr = split;
+
+	if (pos <= split && split < BPTREE_LEAF_MAX)
+		bptree_leaf_insert_at(leaf, pos, key, val);
+	else
+		bptree_leaf_insert_at(new, pos - split, key, val);
+
+	new->prev = leaf;
+	new->next = leaf->next;
+	if (leaf->next)
+		leaf->next->prev = new;
+	leaf->next = new;
+}
+
+/*
+ * Split the full @inner and insert @key/@right at @pos. The middle key
+ * moves up and is returned.
+ */
+static unsigned long bptree_inner_split(struct bptree_inner *inner,
+			struct bptree_inner *new, unsigned int pos,
+			unsigned long key, struct bptree_node *right)
+{
+	unsigned long keys[BPTREE_INNER_MAX + 1];
+	struct bptree_node *child[BPTREE_INNER_MAX + 2];
+	unsigned int nr = BPTREE_INNER_MAX + 1;
+	unsigned int mid = nr / 2;
+
+	memcpy(keys, inner->keys, pos * sizeof(unsigned long));
+	keys[pos] = key;
+	memcpy(&keys[pos + 1], &inner->keys[pos],
+			(BPTREE_INNER_MAX - pos) * sizeof(unsigned long));
+	memcpy(child, inner->child, (pos + 1) * sizeof(void *));
+	child[pos + 1] = right;
+	memcpy(&child[pos + 2], &inner->child[pos + 1],
+			(BPTREE_INNER_MAX - pos) * sizeof(void *));
+
+	inner->node.nr = mid;
+	memcpy(inner->keys, keys, mid * sizeof(unsigned long));
+	memcpy(inner->child, child, (mid + 1) * sizeof(void *));
+
+	new->node.nr = nr - mid - 1;
+	memcpy(new->keys, &keys[mid + 1], new->node.nr * sizeof(unsigned long));
+	memcpy(new->child, &child[mid + 1], (new->node.nr + 1) * sizeof(void *));
+
+	return keys[mid];
+}
+
+/*
+ * bptree_insert - insert @val under @key
+ *
+ * All nodes a split could need are allocated before the tree is
+ * touched, so a failed allocation leaves the tree unchanged.
+ *
+ * Returns 0 on success, -EEXIST if @key is already in the tree or
+ * -ENOMEM.
+ */
+int bptree_insert(struct bptree *tree, unsigned long key, void *val)
+{
+	struct bptree_inner *path[BPTREE_MAX_HEIGHT];
+	unsigned int slot[BPTREE_MAX_HEIGHT];
+	void *spare[BPTREE_MAX_HEIGHT + 1];
+	struct bptree_node *node = tree->root, *right;
+	struct bptree_leaf *leaf;
+	unsigned int pos, nr_spare = 0;
+	unsigned long sep;
+	int level, i;
+
+	if (!node) {
+		leaf = bptree_node_alloc(1);
+		if (!leaf)
+			return -ENOMEM;
+		bptree_leaf_insert_at(leaf, 0, key, val);
+		tree->root = &leaf->node;
+		tree->first = leaf;
+		tree->height = 1;
+		tree->nr = 1;
+		return 0;
+	}
+
+	for (level = 0; !node->leaf; level++) {
+		struct bptree_inner *inner = to_inner(node);
+
+		path[level] = inner;
+		slot[level] = bptree_inner_slot(inner, key);
+		node = inner->child[slot[level]];
+	}
+	leaf = to_leaf(node);
+	pos = bptree_leaf_slot(leaf, key);
+	if (pos < leaf->node.nr && leaf->keys[pos] == key)
+		return -EEXIST;
+
+	if (leaf->node.nr < BPTREE_LEAF_MAX) {
+		bptree_leaf_insert_at(leaf, pos, key, val);
+		tree->nr++;
+		return 0;
+	}
+
+	/* One leaf, one inner per full ancestor, maybe a new root */
+	spare[nr_spare++] = bptree_node_alloc(1);
+	for (i = level - 1; i >= 0 && path[i]->node.nr == BPTREE_INNER_MAX; i--)
+		spare[nr_spare++] = bptree_node_alloc(0);
+	if (i < 0)
+		spare[nr_spare++] = bptree_node_alloc(0);
+	for (i = 0; i < nr_spare; i++) {
+		if (!spare[i]) {
+			while (nr_spare--)
+				free(spare[nr_spare]);
+			return -ENOMEM;
+		}
+	}
+
+	nr_spare = 0;
+	bptree_leaf_split(leaf, spare[nr_spare], pos, key, val);
+	right = spare[nr_spare++];
+	sep = to_leaf(right)->keys[0];
+	tree->nr++;
+
+	while (level-- > 0) {
+		struct bptree_inner *inner = path[level];
+
+		if (inner->node.nr < BPTREE_INNER_MAX) {
+			bptree_inner_insert_at(inner, slot[level], sep, right);
+			return 0;
+		}
+		sep = bptree_inner_split(inner, spare[nr_spare], slot[level],
+					 sep, right);
+		right = spare[nr_spare++];
+	}
+
+	/* The root was split, grow the tree by one level */
+	{
+		struct bptree_inner *root = spare[nr_spare];
+
+		root->node.nr = 1;
+		root->keys[0] = sep;
+		root->child[0] = tree->root;
+		root->child[1] = right;
+		tree->root = &root->node;
+		tree->height++;
+	}
+	return 0;
+}
+
+/*
+ * Refill the underflowed leaf at child @pos of @parent from a sibling,
+ * or merge it with one. Returns true if @parent lost a key.
+ */
+static int bptree_leaf_rebalance(struct bptree_inner *parent,
+				 unsigned int pos)
+{
+	struct bptree_leaf *leaf = to_leaf(parent->child[pos]);
+	struct bptree_leaf *left = NULL, *right = NULL;
+
+	if (pos > 0) {
+		left = to_leaf(parent->child[pos - 1]);
+		if (left->node.nr > BPTREE_LEAF_MIN) {
+			unsigned int last = left->node.nr - 1;
+
+			bptree_leaf_insert_at(leaf, 0, left->keys[last],
+					      left->vals[last]);
+			left->node.nr--;
+			parent->keys[pos - 1] = leaf->keys[0];
+			return 0;
+		}
+	}
+	if (pos < parent->node.nr) {
+		right = to_leaf(parent->child[pos + 1]);
+		if (right->node.nr > BPTREE_LEAF_MIN) {
+			bptree_leaf_insert_at(leaf, leaf->node.nr,
+					right->keys[0], right->vals[0]);
+			bptree_leaf_remove_at(right, 0);
+			parent->keys[pos] = right->keys[0];
+			return 0;
+		}
+	}
+
+	/* Merge the right one of the pair into the left one */
+	if (left) {
+		right = leaf;
+		pos--;
+	} else {
+		left = leaf;
+	}
+	memcpy(&left->keys[left->node.nr], right->keys,
+				right->node.nr * sizeof(unsigned long));
+	memcpy(&left->vals[left->node.nr], right->vals,
+				right->node.nr * sizeof(void *));
+	left->node.nr += right->node.nr;
+	left->next = right->next;
+	if (right->next)
+		right->next->prev = left;
+	free(right);
+	bptree_inner_remove_at(parent, pos);
+	return 1;
+}
+
+/*
+ * Same as bptree_leaf_rebalance() for an inner node, the separator
+ * key in @parent rotates through.
+ */
+static int bptree_inner_rebalance(struct bptree_inner *parent,
+				  unsigned int pos)
+{
+	struct bptree_inner *inner = to_inner(parent->child[pos]);
+	struct bptree_inner *left = NULL, *right = NULL;
+
+	if (pos > 0) {
+		left = to_inner(parent->child[pos - 1]);
+		if (left->node.nr > BPTREE_INNER_MIN) {
+			unsigned int nr = inner->node.nr;
+
+			memmove(&inner->keys[1], inner->keys,
+					nr * sizeof(unsigned long));
+			memmove(&inner->child[1], inner->child,
+					(nr + 1) * sizeof(void *));
+			inner->keys[0] = parent->keys[pos - 1];
+			inner->child[0] = left->child[left->node.nr];
+			inner->node.nr++;
+			parent->keys[pos - 1] = left->keys[left->node.nr - 1];
+			left->node.nr--;
+			return 0;
+		}
+	}
+	if (pos < parent->node.nr) {
+		right = to_inner(parent->child[pos + 1]);
+		if (right->node.nr > BPTREE_INNER_MIN) {
+			unsigned int nr = inner->node.nr;
+
+			inner->keys[nr] = parent->keys[pos];
+			inner->child[nr + 1] = right->child[0];
+			inner->node.nr++;
+			parent->keys[pos] = right->keys[0];
+			memmove(right->keys, &right->keys[1],
+				(right->node.nr - 1) * sizeof(unsigned long));
+			memmove(right->child, &right->child[1],
+				right->node.nr * sizeof(void *));
+			right->node.nr--;
+			return 0;
+		}
+	}
+
+	if (left) {
+		right = inner;
+		pos--;
+	} else {
+		left = inner;
+	}
+	left->keys[left->node.nr] = parent->keys[pos];
+	memcpy(&left->keys[left->node.nr + 1], right->keys,
+				right->node.nr * sizeof(unsigned long));
+	memcpy(&left->child[left->node.nr + 1], right->child,
+				(right->node.nr + 1) * sizeof(void *));
+	left->node.nr += right->node.nr + 1;
+	free(right);
+	bptree_inner_remove_at(parent, pos);
+	return 1;
+}
+
+/*
+ * bptree_remove - remove @key from the tree
+ *
+ * Returns the value which was stored under @key, or NULL if @key was
+ * not in the tree.
+ */
+void *bptree_remove(struct bptree *tree, unsigned long key)
+{
+	struct bptree_inner *path[BPTREE_MAX_HEIGHT];
+	unsigned int slot[BPTREE_MAX_HEIGHT];
+	struct bptree_node *node = tree->root;
+	struct bptree_leaf *leaf;
+	unsigned int pos;
+	int level;
+	void *val;
+
+	if (!node)
+		return NULL;
+
+	for (level = 0; !node->leaf; level++) {
+		struct bptree_inner *inner = to_inner(node);
+
+		path[level] = inner;
+		slot[level] = bptree_inner_slot(inner, key);
+		node = inner->child[slot[level]];
+	}
+	leaf = to_leaf(node);
+	pos = bptree_leaf_slot(leaf, key);
+	if (pos >= leaf->node.nr || leaf->keys[pos] != key)
+		return NULL;
+
+	val = leaf->vals[pos];
+	bptree_leaf_remove_at(leaf, pos);
+	tree->nr--;
+
+	if (!level) {
+		if (!leaf->node.nr) {
+			free(leaf);
+			tree->root = NULL;
+			tree->first = NULL;
+			tree->height = 0;
+		}
+		return val;
+	}
+	if (leaf->node.nr >= BPTREE_LEAF_MIN)
+		return val;
+
+	level--;
+	if (!bptree_leaf_rebalance(path[level], slot[level]))
+		return val;
+	while (level > 0 && path[level]->node.nr < BPTREE_INNER_MIN) {
+		level--;
+		if (!bptree_inner_rebalance(path[level], slot[level]))
+			break;
+	}
+
+	/* Shrink the tree when the root is left with a single child */
+	node = tree->root;
+	if (!node->leaf && !node->nr) {
+		tree->root = to_inner(node)->child[0];
+		tree->height--;
+		free(node);
+	}
+	return val;
+}
+
+/*
+ * bptree_iter_seek - position @iter on the first record not below @key
+ *
+ * @iter->leaf is NULL if there is no such record.
+ */
+void bptree_iter_seek(struct bptree *tree, struct bptree_iter *iter,
+		      unsigned long key)
+{
+	iter->leaf = bptree_find_leaf(tree, key);
+	if (!iter->leaf)
+		return;
+	iter->pos = bptree_leaf_slot(iter->leaf, key);
+	if (iter->pos >= iter->leaf->node.nr) {
+		iter->leaf = iter->leaf->next;
+		iter->pos = 0;
+	}
+}
+
+static void bptree_free_node(struct bptree_node *node)
+{
+	unsigned int i;
+
+	if (!node->leaf)
+		for (i = 0; i <= node->nr; i++)
+			bptree_free_node(to_inner(node)->child[i]);
+	free(node);
+}
+
+/*
+ * bptree_destroy - free all nodes, the values are left to the caller
+ */
+void bptree_destroy(struct bptree *tree)
+{
+	if (tree->root)
+		bptree_free_node(tree->root);
+	*tree = BPTREE_INIT;
+}
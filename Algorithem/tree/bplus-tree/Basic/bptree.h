@@ -0,0 +1,115 @@
+#ifndef _BPTREE_H
+#define _BPTREE_H
+/*
+ * B+Tree with cache-line sized nodes.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Every node is BPTREE_NODE_SIZE bytes and cache-line aligned. Keys and
+ * values live in separate arrays, so a search only touches the key lines
+ * of each node. Records are only stored in the leaves, which are linked
+ * in key order for range scans.
+ */
+
+#define L1_CACHE_BYTES		64
+#define BPTREE_NODE_SIZE	(L1_CACHE_BYTES * 8)
+/* Enough for 2^64 keys with half-full nodes */
+#define BPTREE_MAX_HEIGHT	16
+
+/* Common header of leaf and inner nodes */
+struct bptree_node {
+	unsigned int nr;
+	unsigned int leaf;
+};
+
+#define BPTREE_LEAF_MAX							\
+	((BPTREE_NODE_SIZE - sizeof(struct bptree_node) -		\
+	  2 * sizeof(void *)) / (sizeof(unsigned long) + sizeof(void *)))
+#define BPTREE_INNER_MAX						\
+	((BPTREE_NODE_SIZE - sizeof(struct bptree_node) -		\
+	  sizeof(void *)) / (sizeof(unsigned long) + sizeof(void *)))
+
+struct bptree_leaf {
+	struct bptree_node node;
+	struct bptree_leaf *prev;
+	struct bptree_leaf *next;
+	unsigned long keys[BPTREE_LEAF_MAX];
+	void *vals[BPTREE_LEAF_MAX];
+} __attribute__((aligned(L1_CACHE_BYTES)));
+
+/*
+ * child[i] holds the keys in [keys[i - 1], keys[i]).
+ */
+struct bptree_inner {
+	struct bptree_node node;
+	unsigned long keys[BPTREE_INNER_MAX];
+	struct bptree_node *child[BPTREE_INNER_MAX + 1];
+} __attribute__((aligned(L1_CACHE_BYTES)));
+
+struct bptree {
+	struct bptree_node *root;
+	struct bptree_leaf *first;
+	unsigned int height;
+	unsigned long nr;
+};
+
+#define BPTREE_INIT	(struct bptree) { NULL, NULL, 0, 0 }
+
+/* Cursor on one record, used for ordered and range scans */
+struct bptree_iter {
+	struct bptree_leaf *leaf;
+	unsigned int pos;
+};
+
+extern void *bptree_lookup(struct bptree *tree, unsigned long key);
+extern int bptree_insert(struct bptree *tree, unsigned long key, void *val);
+extern int bptree_update(struct bptree *tree, unsigned long key, void *val);
+extern void *bptree_remove(struct bptree *tree, unsigned long key);
+extern void bptree_destroy(struct bptree *tree);
+extern void bptree_iter_seek(struct bptree *tree, struct bptree_iter *iter,
+			     unsigned long key);
+
+static inline void bptree_iter_first(struct bptree *tree,
+				     struct bptree_iter *iter)
+{
+	iter->leaf = tree->first;
+	iter->pos = 0;
+}
+
+static inline void bptree_iter_next(struct bptree_iter *iter)
+{
+	if (++iter->pos >= iter->leaf->node.nr) {
+		iter->leaf = iter->leaf->next;
+		iter->pos = 0;
+	}
+}
+
+#define bptree_iter_key(iter)	((iter)->leaf->keys[(iter)->pos])
+#define bptree_iter_val(iter)	((iter)->leaf->vals[(iter)->pos])
+
+/*
+ * bptree_for_each - iterate over all records in ascending key order
+ * @tree:	the bptree.
+ * @iter:	'struct bptree_iter *' to use as a loop cursor.
+ */
+#define bptree_for_each(tree, iter)					\
+	for (bptree_iter_first(tree, iter); (iter)->leaf;		\
+	     bptree_iter_next(iter))
+
+/*
+ * bptree_for_each_range - iterate over the records in [start, last]
+ * @tree:	the bptree.
+ * @iter:	'struct bptree_iter *' to use as a loop cursor.
+ * @start:	first key (inclusive).
+ * @last:	last key (inclusive).
+ */
+#define bptree_for_each_range(tree, iter, start, last)			\
+	for (bptree_iter_seek(tree, iter, start);			\
+	     (iter)->leaf && bptree_iter_key(iter) <= (last);		\
+	     bptree_iter_next(iter))
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * B+Tree performance test, against the 2-3 tree and the rbtree.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: bptree_test [nr_keys]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bptree.h"
+#include <tree23.h>
+
+#define DEFAULT_KEYS	10000000UL
+
+/* Provided by bptree_perform_rb.c */
+extern void rbtree_perform(unsigned long *keys, unsigned long nr);
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long xorshift(unsigned long *state)
+{
+	unsigned long x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static void bptree_perform(unsigned long *keys, unsigned long nr)
+{
+	struct bptree tree = BPTREE_INIT;
+	struct bptree_iter iter;
+	unsigned long i, sum = 0;
+	double start;
+
+	start = now();
+	for (i = 0; i < nr; i++)
+		bptree_insert(&tree, keys[i], (void *)keys[i]);
+	printf("bptree  insert: %8.3fs (height %u)\n", now() - start,
+							tree.height);
+
+	start = now();
+	for (i = 0; i < nr; i++)
+		sum += (unsigned long)bptree_lookup(&tree, keys[i]);
+	printf("bptree  lookup: %8.3fs\n", now() - start);
+
+	start = now();
+	bptree_for_each(&tree, &iter)
+		sum += (unsigned long)bptree_iter_val(&iter);
+	printf("bptree  scan:   %8.3fs\n", now() - start);
+
+	start = now();
+	for (i = 0; i < nr / 2; i++)
+		bptree_remove(&tree, keys[i]);
+	printf("bptree  erase:  %8.3fs\n", now() - start);
+
+	bptree_destroy(&tree);
+	if (sum == 1)
+		printf("\n");
+}
+
+/* tree23 only has float keys and no lookup, so time insert and erase */
+static void tree23_perform(unsigned long *keys, unsigned long nr)
+{
+	struct tree23_root *t = tree23_root_init();
+	unsigned long i;
+	double start;
+
+	start = now();
+	for (i = 0; i < nr; i++)
+		tree23_insert((float)(keys[i] >> 40), t);
+	printf("tree23  insert: %8.3fs\n", now() - start);
+
+	start = now();
+	for (i = 0; i < nr / 2; i++)
+		tree23_erase((float)(keys[i] >> 40), t);
+	printf("tree23  erase:  %8.3fs\n", now() - start);
+
+	tree23_deltree(t);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long nr = DEFAULT_KEYS, seed = 0x2545f4914f6cdd1dUL;
+	unsigned long *keys, i;
+
+	if (argc > 1)
+		nr = strtoul(argv[1], NULL, 0);
+
+	keys = malloc(nr * sizeof(unsigned long));
+	if (!keys)
+		return -1;
+	for (i = 0; i < nr; i++)
+		keys[i] = xorshift(&seed);
+
+	printf("%lu random keys\n", nr);
+	bptree_perform(keys, nr);
+	rbtree_perform(keys, nr);
+	tree23_perform(keys, nr);
+
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * rbtree half of the B+Tree performance test. rbtree.h brings its own
+ * bool, so it can't share a translation unit with tree23.h.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rbtree.h>
+
+struct node {
+	struct rb_node node;
+	unsigned long key;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void rbtree_insert(struct rb_root *root, struct node *node)
+{
+	struct rb_node **new = &(root->rb_node), *parent = NULL;
+
+	while (*new) {
+		struct node *this = rb_entry(*new, struct node, node);
+
+		parent = *new;
+		if (node->key < this->key)
+			new = &((*new)->rb_left);
+		else if (node->key > this->key)
+			new = &((*new)->rb_right);
+		else
+			return;
+	}
+
+	rb_link_node(&node->node, parent, new);
+	rb_insert_color(&node->node, root);
+}
+
+static struct node *rbtree_search(struct rb_root *root, unsigned long key)
+{
+	struct rb_node *node = root->rb_node;
+
+	while (node) {
+		struct node *this = rb_entry(node, struct node, node);
+
+		if (key < this->key)
+			node = node->rb_left;
+		else if (key > this->key)
+			node = node->rb_right;
+		else
+			return this;
+	}
+	return NULL;
+}
+
+void rbtree_perform(unsigned long *keys, unsigned long nr)
+{
+	struct rb_root root = RB_ROOT;
+	struct rb_node *rb;
+	struct node **nodes, *node;
+	unsigned long i, sum = 0;
+	double start;
+
+	/* Nodes are allocated one by one, as an rbtree user would */
+	nodes = malloc(nr * sizeof(*nodes));
+	if (!nodes)
+		return;
+
+	start = now();
+	for (i = 0; i < nr; i++) {
+		node = malloc(sizeof(*node));
+		node->key = keys[i];
+		nodes[i] = node;
+		rbtree_insert(&root, node);
+	}
+	printf("rbtree  insert: %8.3fs\n", now() - start);
+
+	start = now();
+	for (i = 0; i < nr; i++) {
+		node = rbtree_search(&root, keys[i]);
+		sum += node->key;
+	}
+	printf("rbtree  lookup: %8.3fs\n", now() - start);
+
+	start = now();
+	for (rb = rb_first(&root); rb; rb = rb_next(rb))
+		sum += rb_entry(rb, struct node, node)->key;
+	printf("rbtree  scan:   %8.3fs\n", now() - start);
+
+	start = now();
+	for (i = 0; i < nr / 2; i++) {
+		node = rbtree_search(&root, keys[i]);
+		rb_erase(&node->node, &root);
+	}
+	printf("rbtree  erase:  %8.3fs\n", now() - start);
+
+	for (i = 0; i < nr; i++)
+		free(nodes[i]);
+	free(nodes);
+	if (sum == 1)
+		printf("\n");
+}
@@ -0,0 +1,72 @@
+/*
+ * B+Tree Manual.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bptree.h"
+
+struct node {
+	unsigned long runtime;
+	char name[16];
+};
+
+static struct node nodes[] = {
+	{ 25, "task25" }, { 5, "task5" }, { 30, "task30" },
+	{ 12, "task12" }, { 55, "task55" }, { 1, "task1" },
+	{ 42, "task42" }, { 17, "task17" }, { 90, "task90" },
+	{ 66, "task66" }, { 8, "task8" },  { 71, "task71" },
+};
+
+/* Root of B+Tree */
+static struct bptree BiscuitOS_bptree = BPTREE_INIT;
+
+int main()
+{
+	struct bptree_iter iter;
+	struct node *node;
+	int i;
+
+	/* Insert nodes into B+Tree, the key is runtime */
+	for (i = 0; i < sizeof(nodes) / sizeof(nodes[0]); i++)
+		bptree_insert(&BiscuitOS_bptree, nodes[i].runtime, &nodes[i]);
+
+	/* Traverser all nodes in key order */
+	printf("Iterate over B+Tree.\n");
+	bptree_for_each(&BiscuitOS_bptree, &iter) {
+		node = bptree_iter_val(&iter);
+		printf("%#lx %s\n", bptree_iter_key(&iter), node->name);
+	}
+
+	/* Search */
+	node = bptree_lookup(&BiscuitOS_bptree, 42);
+	if (node)
+		printf("Find %s\n", node->name);
+
+	/* Range [10, 60] */
+	printf("Iterate over range [10, 60].\n");
+	bptree_for_each_range(&BiscuitOS_bptree, &iter, 10, 60) {
+		node = bptree_iter_val(&iter);
+		printf("%#lx %s\n", bptree_iter_key(&iter), node->name);
+	}
+
+	/* Erase */
+	node = bptree_remove(&BiscuitOS_bptree, 30);
+	if (node)
+		printf("Erase %s\n", node->name);
+
+	printf("Iterate over B+Tree.\n");
+	bptree_for_each(&BiscuitOS_bptree, &iter) {
+		node = bptree_iter_val(&iter);
+		printf("%#lx %s\n", bptree_iter_key(&iter), node->name);
+	}
+
+	bptree_destroy(&BiscuitOS_bptree);
+	return 0;
+}
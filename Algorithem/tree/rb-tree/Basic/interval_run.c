@@ -0,0 +1,89 @@
+/*
+ * Interval Tree Manual.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* interval tree */
+#include "interval_tree.h"
+
+#define NR_RANGES	100000
+#define NR_QUERIES	10000
+#define ADDR_SPACE	(1UL << 32)
+#define RANGE_MAX	(1UL << 16)
+
+static struct interval_tree_node ranges[NR_RANGES];
+
+/* rbroot */
+static struct rb_root_cached BiscuitOS_it = RB_ROOT_CACHED;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long random_addr(void)
+{
+	return (((unsigned long)rand() << 16) ^ rand()) % ADDR_SPACE;
+}
+
+int main()
+{
+	struct interval_tree_node *node;
+	unsigned long tree_hits = 0, scan_hits = 0;
+	double tree_time = 0, scan_time = 0, t;
+	int i, j;
+
+	/* Insert address ranges */
+	for (i = 0; i < NR_RANGES; i++) {
+		ranges[i].start = random_addr();
+		ranges[i].last = ranges[i].start + rand() % RANGE_MAX;
+		interval_tree_insert(&ranges[i], &BiscuitOS_it);
+	}
+
+	/* Drop every other range to exercise rb_erase_augmented() */
+	for (i = 0; i < NR_RANGES; i += 2)
+		interval_tree_remove(&ranges[i], &BiscuitOS_it);
+
+	printf("Overlap with [%#lx - %#lx]:\n", ranges[1].start,
+						ranges[1].last);
+	interval_tree_for_each_overlap(node, &BiscuitOS_it, ranges[1].start,
+						ranges[1].last)
+		printf("  [%#lx - %#lx]\n", node->start, node->last);
+
+	for (i = 0; i < NR_QUERIES; i++) {
+		unsigned long start = random_addr();
+		unsigned long last = start + rand() % RANGE_MAX;
+
+		t = now();
+		interval_tree_for_each_overlap(node, &BiscuitOS_it, start, last)
+			tree_hits++;
+		tree_time += now() - t;
+
+		t = now();
+		for (j = 1; j < NR_RANGES; j += 2)
+			if (ranges[j].start <= last && start <= ranges[j].last)
+				scan_hits++;
+		scan_time += now() - t;
+	}
+
+	printf("%d queries over %d ranges\n", NR_QUERIES, NR_RANGES / 2);
+	printf("  interval tree: %lu hits %.3f ms\n", tree_hits,
+							tree_time * 1e3);
+	printf("  linear scan:   %lu hits %.3f ms\n", scan_hits,
+							scan_time * 1e3);
+	if (tree_hits != scan_hits)
+		printf("Interval tree mismatch!\n");
+
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Interval Tree
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * linux/include/linux/interval_tree.h
+ */
+#ifndef _INTERVAL_TREE_H
+#define _INTERVAL_TREE_H
+
+#include "rbtree.h"
+
+/*
+ * Interval [start, last] on the augmented rbtree, sorted by start
+ * and augmented with the largest last in each subtree.
+ */
+struct interval_tree_node {
+	struct rb_node rb;
+	unsigned long start;	/* Start of interval */
+	unsigned long last;	/* Last location _in_ interval */
+	unsigned long __subtree_last;
+};
+
+extern void
+interval_tree_insert(struct interval_tree_node *node,
+		     struct rb_root_cached *root);
+
+extern void
+interval_tree_remove(struct interval_tree_node *node,
+		     struct rb_root_cached *root);
+
+extern struct interval_tree_node *
+interval_tree_iter_first(struct rb_root_cached *root,
+			 unsigned long start, unsigned long last);
+
+extern struct interval_tree_node *
+interval_tree_iter_next(struct interval_tree_node *node,
+			unsigned long start, unsigned long last);
+
+/*
+ * interval_tree_for_each_overlap - iterate over all intervals overlapping
+ * [start, last] in ascending order of start, in O(log n + k).
+ */
+#define interval_tree_for_each_overlap(node, root, start, last)		\
+	for (node = interval_tree_iter_first(root, start, last);	\
+	     node; node = interval_tree_iter_next(node, start, last))
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * RB-Tree leftmost-cached and bulk-load benchmark.
+ *
+ * (C) 2026.10.18 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* rbtree */
+#include "rbtree.h"
+
+#define NR_NODES	1000000
+#define NR_EVENTS	4000000
+
+struct node {
+	struct rb_node node;
+	unsigned long runtime;
+};
+
+static struct node *nodes;
+static struct rb_node **sorted;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Insert private node into rbtree, as rb_run.c does */
+static void rbtree_insert(struct rb_root *root, struct node *node)
+{
+	struct rb_node **new = &(root->rb_node), *parent = NULL;
+
+	while (*new) {
+		struct node *this = rb_entry(*new, struct node, node);
+
+		parent = *new;
+		if (node->runtime < this->runtime)
+			new = &((*new)->rb_left);
+		else
+			new = &((*new)->rb_right);
+	}
+
+	rb_link_node(&node->node, parent, new);
+	rb_insert_color(&node->node, root);
+}
+
+/* Same as rbtree_insert(), but keep track of the leftmost node */
+static void rbtree_insert_cached(struct rb_root_cached *root,
+						struct node *node)
+{
+	struct rb_node **new = &(root->rb_root.rb_node), *parent = NULL;
+	bool leftmost = true;
+
+	while (*new) {
+		struct node *this = rb_entry(*new, struct node, node);
+
+		parent = *new;
+		if (node->runtime < this->runtime)
+			new = &((*new)->rb_left);
+		else {
+			new = &((*new)->rb_right);
+			leftmost = false;
+		}
+	}
+
+	rb_link_node(&node->node, parent, new);
+	rb_insert_color_cached(&node->node, root, leftmost);
+}
+
+/* Return black height, or -1 if any rbtree property is broken */
+static int rbtree_verify(struct rb_node *node, struct rb_node *parent)
+{
+	int left, right;
+
+	if (!node)
+		return 0;
+	if (rb_parent(node) != parent)
+		return -1;
+	if (rb_is_red(node) && parent && rb_is_red(parent))
+		return -1;
+	left = rbtree_verify(node->rb_left, node);
+	right = rbtree_verify(node->rb_right, node);
+	if (left < 0 || left != right)
+		return -1;
+	return left + rb_is_black(node);
+}
+
+static void reset_nodes(void)
+{
+	unsigned long i;
+
+	for (i = 0; i < NR_NODES; i++) {
+		nodes[i].runtime = i * 16;
+		sorted[i] = &nodes[i].node;
+	}
+}
+
+static void bench_build(void)
+{
+	struct rb_root root = RB_ROOT;
+	struct rb_root_cached croot = RB_ROOT_CACHED;
+	unsigned long i;
+	double t;
+
+	reset_nodes();
+	t = now();
+	for (i = 0; i < NR_NODES; i++)
+		rbtree_insert(&root, &nodes[i]);
+	t = now() - t;
+	printf("  per-node rb_insert_color: %8.2f ms black-height %d\n",
+				t * 1e3, rbtree_verify(root.rb_node, NULL));
+
+	reset_nodes();
+	t = now();
+	rb_build_sorted_cached(sorted, NR_NODES, &croot);
+	t = now() - t;
+	printf("  rb_build_sorted_cached:   %8.2f ms black-height %d\n",
+			t * 1e3, rbtree_verify(croot.rb_root.rb_node, NULL));
+
+	for (i = 0; i < NR_NODES; i++)
+		if (rb_first_cached(&croot) != &nodes[i].node ||
+			(rb_erase_cached(&nodes[i].node, &croot), 0))
+			break;
+	if (i != NR_NODES || !RB_EMPTY_ROOT(&croot.rb_root))
+		printf("  rb_build_sorted_cached: bad order at %lu\n", i);
+}
+
+/*
+ * Deadline queue: pop the earliest node and requeue it at a later
+ * deadline, as a timer wheel replacement would.
+ */
+static void bench_queue(void)
+{
+	struct rb_root root = RB_ROOT;
+	struct rb_root_cached croot = RB_ROOT_CACHED;
+	struct rb_node *rb;
+	struct node *np;
+	unsigned long i;
+	double t;
+
+	reset_nodes();
+	for (i = 0; i < NR_NODES; i++)
+		rbtree_insert(&root, &nodes[i]);
+	srand(1);
+	t = now();
+	for (i = 0; i < NR_EVENTS; i++) {
+		rb = rb_first(&root);
+		np = rb_entry(rb, struct node, node);
+		rb_erase(rb, &root);
+		np->runtime += rand() % (NR_NODES * 16);
+		rbtree_insert(&root, np);
+	}
+	t = now() - t;
+	printf("  rb_first + rb_erase:               %8.2f ms\n", t * 1e3);
+
+	reset_nodes();
+	rb_build_sorted_cached(sorted, NR_NODES, &croot);
+	srand(1);
+	t = now();
+	for (i = 0; i < NR_EVENTS; i++) {
+		rb = rb_first_cached(&croot);
+		np = rb_entry(rb, struct node, node);
+		rb_erase_cached(rb, &croot);
+		np->runtime += rand() % (NR_NODES * 16);
+		rbtree_insert_cached(&croot, np);
+	}
+	t = now() - t;
+	printf("  rb_first_cached + rb_erase_cached: %8.2f ms\n", t * 1e3);
+
+	if (rb_first(&croot.rb_root) != rb_first_cached(&croot) ||
+			rbtree_verify(croot.rb_root.rb_node, NULL) < 0)
+		printf("  rb_root_cached: corrupted\n");
+}
+
+int main()
+{
+	nodes = malloc(sizeof(*nodes) * NR_NODES);
+	sorted = malloc(sizeof(*sorted) * NR_NODES);
+	if (!nodes || !sorted)
+		return -1;
+
+	printf("Build %d sorted nodes:\n", NR_NODES);
+	bench_build();
+	printf("Deadline queue, %d nodes %d events:\n", NR_NODES, NR_EVENTS);
+	bench_queue();
+
+	free(sorted);
+	free(nodes);
+	return 0;
+}
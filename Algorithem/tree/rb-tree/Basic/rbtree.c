@@ -405,6 +405,12 @@ ____rb_erase_color(struct rb_node *parent, struct rb_root *root,
 	}
 }
 
+void __rb_erase_color(struct rb_node *parent, struct rb_root *root,
+	void (*augment_rotate)(struct rb_node *old, struct rb_node *new))
+{
+	____rb_erase_color(parent, root, augment_rotate);
+}
+
 /*
  * Non-augmented rbtree manipulation functions.
  *
@@ -437,6 +443,36 @@ void rb_erase(struct rb_node *node, struct rb_root *root)
 		____rb_erase_color(rebalance, root, dummy_rotate);
 }
 
+void rb_insert_color_cached(struct rb_node *node,
+			    struct rb_root_cached *root, bool leftmost)
+{
+	__rb_insert(node, &root->rb_root, leftmost,
+		    &root->rb_leftmost, dummy_rotate);
+}
+
+void rb_erase_cached(struct rb_node *node, struct rb_root_cached *root)
+{
+	struct rb_node *rebalance;
+	rebalance = __rb_erase_augmented(node, &root->rb_root,
+					 &root->rb_leftmost, &dummy_callbacks);
+	if (rebalance)
+		____rb_erase_color(rebalance, &root->rb_root, dummy_rotate);
+}
+
+/*
+ * Augmented rbtree manipulation functions.
+ *
+ * This instantiates the same __always_inline functions as in the non-augmented
+ * case, but this time with user-defined callbacks.
+ */
+
+void __rb_insert_augmented(struct rb_node *node, struct rb_root *root,
+	bool newleft, struct rb_node **leftmost,
+	void (*augment_rotate)(struct rb_node *old, struct rb_node *new))
+{
+	__rb_insert(node, root, newleft, leftmost, augment_rotate);
+}
+
 /*
  * This function returns the first node (in sort order) of the tree.
  */
@@ -538,6 +574,73 @@ void rb_replace_node(struct rb_node *victim, struct rb_node *new,
 	__rb_change_child(victim, new, parent, root);
 }
 
+void rb_replace_node_cached(struct rb_node *victim, struct rb_node *new,
+			    struct rb_root_cached *root)
+{
+	if (root->rb_leftmost == victim)
+		root->rb_leftmost = new;
+	rb_replace_node(victim, new, &root->rb_root);
+}
+
+/*
+ * Link nodes[0..nr) below @parent as a perfectly balanced subtree.
+ * Splitting at the middle keeps the sizes of both subtrees within one
+ * of each other, so every level but the deepest one is full.
+ */
+static struct rb_node *__rb_build_sorted(struct rb_node **nodes,
+			unsigned long nr, struct rb_node *parent,
+			int depth, int red_depth)
+{
+	struct rb_node *node;
+	unsigned long mid;
+
+	if (!nr)
+		return NULL;
+
+	mid = nr / 2;
+	node = nodes[mid];
+	rb_set_parent_color(node, parent,
+			    depth == red_depth ? RB_RED : RB_BLACK);
+	node->rb_left = __rb_build_sorted(nodes, mid, node,
+					  depth + 1, red_depth);
+	node->rb_right = __rb_build_sorted(nodes + mid + 1, nr - mid - 1,
+					   node, depth + 1, red_depth);
+	return node;
+}
+
+/*
+ * rb_build_sorted - build an rbtree from nodes already in sort order
+ * @nodes: array of @nr nodes, sorted the same way as the tree
+ * @nr: number of nodes
+ * @root: rbtree root, any previous content is discarded
+ *
+ * Builds the tree in O(n) without a single rotation. All levels but
+ * the deepest are black and the deepest level is red, which keeps the
+ * black height equal on every path. Augmented trees must recompute
+ * their augmented data afterwards.
+ */
+void rb_build_sorted(struct rb_node **nodes, unsigned long nr,
+		     struct rb_root *root)
+{
+	unsigned long capacity = 0;
+	int height = 0;
+
+	/* Number of levels, ceil(log2(nr + 1)) */
+	while (capacity < nr) {
+		capacity = capacity * 2 + 1;
+		height++;
+	}
+	root->rb_node = __rb_build_sorted(nodes, nr, NULL, 0,
+					  height > 1 ? height - 1 : -1);
+}
+
+void rb_build_sorted_cached(struct rb_node **nodes, unsigned long nr,
+			    struct rb_root_cached *root)
+{
+	rb_build_sorted(nodes, nr, &root->rb_root);
+	root->rb_leftmost = nr ? nodes[0] : NULL;
+}
+
 static struct rb_node *rb_left_deepest_node(const struct rb_node *node)
 {
 	for (;;) {
@@ -73,6 +73,21 @@ struct rb_root {
 	struct rb_node *rb_node;
 };
 
+/*
+ * Leftmost-cached rbtrees.
+ *
+ * We do not cache the rightmost node based on footprint
+ * size vs number of potential users that could benefit
+ * from O(1) rb_last(). Just not worth it, users that want
+ * this feature can always implement the logic explicitly.
+ * Furthermore, users that want to cache both pointers may
+ * find it a bit asymmetric, but that's ok.
+ */
+struct rb_root_cached {
+	struct rb_root rb_root;
+	struct rb_node *rb_leftmost;
+};
+
 /*
  * Please note - only struct rb_augment_callbacks and the prototypes for
  * rb_insert_augmented() and rb_erase_augmented() are intended to the public.
@@ -90,6 +105,7 @@ struct rb_augment_callbacks {
 #define rb_parent(r)	((struct rb_node *)((r)->__rb_parent_color & ~3))
 
 #define RB_ROOT (struct rb_root) { NULL, }
+#define RB_ROOT_CACHED (struct rb_root_cached) { {NULL, }, NULL }
 #define rb_entry(ptr, type, member) container_of(ptr, type, member)
 
 #define RB_EMPTY_ROOT(root)  ((root)->rb_node == NULL)
@@ -151,6 +167,26 @@ extern void rb_replace_node(struct rb_node *victim, struct rb_node *new,
 extern struct rb_node *rb_next_postorder(const struct rb_node *node);
 extern struct rb_node *rb_first_postorder(const struct rb_root *root);
 
+extern void rb_insert_color_cached(struct rb_node *,
+				   struct rb_root_cached *, bool);
+extern void rb_erase_cached(struct rb_node *node, struct rb_root_cached *);
+extern void rb_replace_node_cached(struct rb_node *victim, struct rb_node *new,
+				   struct rb_root_cached *root);
+
+/* Same as rb_first(), but O(1) */
+#define rb_first_cached(root) (root)->rb_leftmost
+
+extern void rb_build_sorted(struct rb_node **nodes, unsigned long nr,
+			    struct rb_root *root);
+extern void rb_build_sorted_cached(struct rb_node **nodes, unsigned long nr,
+				   struct rb_root_cached *root);
+
+extern void __rb_insert_augmented(struct rb_node *node, struct rb_root *root,
+	bool newleft, struct rb_node **leftmost,
+	void (*augment_rotate)(struct rb_node *old, struct rb_node *new));
+extern void __rb_erase_color(struct rb_node *parent, struct rb_root *root,
+	void (*augment_rotate)(struct rb_node *old, struct rb_node *new));
+
 #define rb_entry_safe(ptr, type, member) \
 	({ typeof(ptr) ____ptr = (ptr); \
 	   ____ptr ? rb_entry(____ptr, type, member) : NULL; \
@@ -179,7 +215,7 @@ extern struct rb_node *rb_first_postorder(const struct rb_root *root);
 			   typeof(*pos), field); 1; }); \
 		pos = n)
 
-#define offsetof(TYPE, MEMBER)	((size_t)&((TYPE *)0)->MEMBER)
+#define offsetof(TYPE, MEMBER)	((unsigned long)&((TYPE *)0)->MEMBER)
 /**
  * container_of - cast a member of a structure out to the containing structure.
  * @ptr:          the pointer to the member.
@@ -190,6 +226,107 @@ extern struct rb_node *rb_first_postorder(const struct rb_root *root);
 	void *__mptr = (void *)(ptr);					\
 	((type *)(__mptr - offsetof(type, member))); })
 
+/*
+ * Fixup the rbtree and update the augmented information when rebalancing.
+ *
+ * On insertion, the user must update the augmented information on the path
+ * leading to the inserted node, then call rb_link_node() as usual and
+ * rb_insert_augmented() instead of the usual rb_insert_color() call.
+ * If rb_insert_augmented() rebalances the rbtree, it will callback into
+ * a user provided function to update the augmented information on the
+ * affected subtrees.
+ */
+static inline void
+rb_insert_augmented(struct rb_node *node, struct rb_root *root,
+		    const struct rb_augment_callbacks *augment)
+{
+	__rb_insert_augmented(node, root, false, NULL, augment->rotate);
+}
+
+static inline void
+rb_insert_augmented_cached(struct rb_node *node,
+			   struct rb_root_cached *root, bool newleft,
+			   const struct rb_augment_callbacks *augment)
+{
+	__rb_insert_augmented(node, &root->rb_root,
+			      newleft, &root->rb_leftmost, augment->rotate);
+}
+
+/*
+ * Template for declaring augmented rbtree callbacks
+ *
+ * rbstatic:    'static' or empty
+ * rbname:      name of the rb_augment_callbacks structure
+ * rbstruct:    struct type of the tree nodes
+ * rbfield:     name of struct rb_node field within rbstruct
+ * rbtype:      type of the rbaugmented field
+ * rbaugmented: name of rbtype field within rbstruct holding data for subtree
+ * rbcompute:   name of function that recomputes the rbaugmented data
+ */
+#define RB_DECLARE_CALLBACKS(rbstatic, rbname, rbstruct, rbfield,	\
+			     rbtype, rbaugmented, rbcompute)		\
+static inline void							\
+rbname ## _propagate(struct rb_node *rb, struct rb_node *stop)		\
+{									\
+	while (rb != stop) {						\
+		rbstruct *node = rb_entry(rb, rbstruct, rbfield);	\
+		rbtype augmented = rbcompute(node);			\
+		if (node->rbaugmented == augmented)			\
+			break;						\
+		node->rbaugmented = augmented;				\
+		rb = rb_parent(&node->rbfield);				\
+	}								\
+}									\
+static inline void							\
+rbname ## _copy(struct rb_node *rb_old, struct rb_node *rb_new)		\
+{									\
+	rbstruct *old = rb_entry(rb_old, rbstruct, rbfield);		\
+	rbstruct *new = rb_entry(rb_new, rbstruct, rbfield);		\
+	new->rbaugmented = old->rbaugmented;				\
+}									\
+static void								\
+rbname ## _rotate(struct rb_node *rb_old, struct rb_node *rb_new)	\
+{									\
+	rbstruct *old = rb_entry(rb_old, rbstruct, rbfield);		\
+	rbstruct *new = rb_entry(rb_new, rbstruct, rbfield);		\
+	new->rbaugmented = old->rbaugmented;				\
+	old->rbaugmented = rbcompute(old);				\
+}									\
+rbstatic const struct rb_augment_callbacks rbname = {			\
+	.propagate = rbname ## _propagate,				\
+	.copy = rbname ## _copy,					\
+	.rotate = rbname ## _rotate					\
+};
+
+/*
+ * Template for declaring augmented rbtree callbacks,
+ * computing the max of a per-node scalar over each subtree
+ * (e.g. the last address of an interval, or the largest free gap).
+ *
+ * rbcompute:   name of function that returns the per-node rbtype scalar
+ * Other arguments are the same as for RB_DECLARE_CALLBACKS().
+ */
+#define RB_DECLARE_CALLBACKS_MAX(rbstatic, rbname, rbstruct, rbfield,	\
+				 rbtype, rbaugmented, rbcompute)	\
+static inline rbtype rbname ## _compute_max(rbstruct *node)		\
+{									\
+	rbstruct *child;						\
+	rbtype max = rbcompute(node);					\
+	if (node->rbfield.rb_left) {					\
+		child = rb_entry(node->rbfield.rb_left, rbstruct, rbfield); \
+		if (child->rbaugmented > max)				\
+			max = child->rbaugmented;			\
+	}								\
+	if (node->rbfield.rb_right) {					\
+		child = rb_entry(node->rbfield.rb_right, rbstruct, rbfield); \
+		if (child->rbaugmented > max)				\
+			max = child->rbaugmented;			\
+	}								\
+	return max;							\
+}									\
+RB_DECLARE_CALLBACKS(rbstatic, rbname, rbstruct, rbfield,		\
+		     rbtype, rbaugmented, rbname ## _compute_max)
+
 static inline void rb_set_parent(struct rb_node *rb, struct rb_node *p)
 {
 	rb->__rb_parent_color = rb_color(rb) | (unsigned long)p;
@@ -304,4 +441,25 @@ __rb_erase_augmented(struct rb_node *node, struct rb_root *root,
 	return rebalance;
 }
 
+static inline void
+rb_erase_augmented(struct rb_node *node, struct rb_root *root,
+		   const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *rebalance = __rb_erase_augmented(node, root,
+							 NULL, augment);
+	if (rebalance)
+		__rb_erase_color(rebalance, root, augment->rotate);
+}
+
+static inline void
+rb_erase_augmented_cached(struct rb_node *node, struct rb_root_cached *root,
+			  const struct rb_augment_callbacks *augment)
+{
+	struct rb_node *rebalance = __rb_erase_augmented(node, &root->rb_root,
+							 &root->rb_leftmost,
+							 augment);
+	if (rebalance)
+		__rb_erase_color(rebalance, &root->rb_root, augment->rotate);
+}
+
 #endif
@@ -6,7 +6,11 @@
 
 /* Helper for export */
 
+#ifdef __LP64__
+#define BITS_PER_LONG	64
+#else
 #define BITS_PER_LONG	32
+#endif
 
 #define BITS_PER_LONG_LONG	64
 
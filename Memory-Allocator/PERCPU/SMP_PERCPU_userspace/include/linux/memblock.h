@@ -156,8 +156,8 @@ extern void *memblock_alloc_try_nid(phys_addr_t size, phys_addr_t align,
 
 static inline void *memblock_alloc(phys_addr_t size, phys_addr_t align)
 {
-	memblock_alloc_try_nid(size, align, MEMBLOCK_LOW_LIMIT,
-				MEMBLOCK_ALLOC_ACCESSIBLE, NUMA_NO_NODE);
+	return memblock_alloc_try_nid(size, align, MEMBLOCK_LOW_LIMIT,
+				      MEMBLOCK_ALLOC_ACCESSIBLE, NUMA_NO_NODE);
 }
 
 extern void * memblock_alloc_try_nid_nopanic(
@@ -221,6 +221,22 @@ extern unsigned long __per_cpu_offset[NR_CPUS];
 
 #define per_cpu_offset(x)	(__per_cpu_offset[x])
 
+/*
+ * Emulate CPUs with threads: a thread runs as the CPU it has bound
+ * with bind_cpu(), thread 0 as CPU 0. As with preemption disabled in
+ * the kernel, only one thread may run as a given CPU at a time.
+ */
+extern __thread unsigned int __cpu_number;
+
+#define smp_processor_id()	(__cpu_number)
+#define my_cpu_offset		per_cpu_offset(smp_processor_id())
+#define arch_raw_cpu_ptr(ptr)	SHIFT_PERCPU_PTR(ptr, my_cpu_offset)
+
+static inline void bind_cpu(unsigned int cpu)
+{
+	__cpu_number = cpu;
+}
+
 /*      
  * Add an offset to a pointer but keep the pointer as-is.  Use RELOC_HIDE()
  * to prevent the compiler from making incorrect assumptions about the
@@ -255,6 +271,9 @@ extern unsigned long __per_cpu_offset[NR_CPUS];
 	(typeof(*(__p)) *)(__p);					\
 })
 
+#define smp_processor_id()	0U
+#define bind_cpu(cpu)		do { (void)(cpu); } while (0)
+
 #define per_cpu_ptr(ptr, cpu)	({ (void)(cpu); VERIFY_PERCPU_PTR(ptr); })
 #define raw_cpu_ptr(ptr)	per_cpu_ptr(ptr, 0)
 #define this_cpu_ptr(ptr)	raw_cpu_ptr(ptr)
@@ -0,0 +1,100 @@
+#ifndef _BISCUITOS_PERCPU_COUNTER_H
+#define _BISCUITOS_PERCPU_COUNTER_H
+/*
+ * A simple "approximate counter" for use in ext2 and ext3 superblocks.
+ *
+ * WARNING: these things are HUGE.  4 kbytes per counter on 32-way P4.
+ *
+ * Userspace: the per-CPU deltas live in the emulated percpu area and
+ * each thread adds to the delta of the CPU it is bound to, see
+ * bind_cpu(). ->count is only written with ->lock held.
+ */
+#include <pthread.h>
+
+#include "linux/biscuitos.h"
+#include "linux/mm.h"
+#include "linux/percpu.h"
+
+typedef long long s64;
+typedef int s32;
+
+struct percpu_counter {
+	pthread_spinlock_t lock;
+	s64 count;
+	s32 __percpu *counters;
+};
+
+extern int percpu_counter_batch;
+
+extern int percpu_counter_init(struct percpu_counter *fbc, s64 amount,
+			       gfp_t gfp);
+extern void percpu_counter_destroy(struct percpu_counter *fbc);
+extern void percpu_counter_set(struct percpu_counter *fbc, s64 amount);
+extern void percpu_counter_add_batch(struct percpu_counter *fbc, s64 amount,
+				     s32 batch);
+extern s64 __percpu_counter_sum(struct percpu_counter *fbc);
+extern int __percpu_counter_compare(struct percpu_counter *fbc, s64 rhs,
+				    s32 batch);
+extern void percpu_counter_set_batch(int batch);
+
+static inline int percpu_counter_compare(struct percpu_counter *fbc, s64 rhs)
+{
+	return __percpu_counter_compare(fbc, rhs, percpu_counter_batch);
+}
+
+static inline void percpu_counter_add(struct percpu_counter *fbc, s64 amount)
+{
+	percpu_counter_add_batch(fbc, amount, percpu_counter_batch);
+}
+
+static inline s64 percpu_counter_sum_positive(struct percpu_counter *fbc)
+{
+	s64 ret = __percpu_counter_sum(fbc);
+
+	return ret < 0 ? 0 : ret;
+}
+
+static inline s64 percpu_counter_sum(struct percpu_counter *fbc)
+{
+	return __percpu_counter_sum(fbc);
+}
+
+/*
+ * Without the per-CPU deltas: off by less than batch per CPU, but a
+ * single load of a line that only changes once per batch.
+ */
+static inline s64 percpu_counter_read(struct percpu_counter *fbc)
+{
+	return __atomic_load_n(&fbc->count, __ATOMIC_RELAXED);
+}
+
+/*
+ * It is possible for the percpu_counter_read() to return a small negative
+ * number for some counter which should never be negative.
+ *
+ */
+static inline s64 percpu_counter_read_positive(struct percpu_counter *fbc)
+{
+	s64 ret = percpu_counter_read(fbc);
+
+	if (ret >= 0)
+		return ret;
+	return 0;
+}
+
+static inline void percpu_counter_inc(struct percpu_counter *fbc)
+{
+	percpu_counter_add(fbc, 1);
+}
+
+static inline void percpu_counter_dec(struct percpu_counter *fbc)
+{
+	percpu_counter_add(fbc, -1);
+}
+
+static inline void percpu_counter_sub(struct percpu_counter *fbc, s64 amount)
+{
+	percpu_counter_add(fbc, -amount);
+}
+
+#endif
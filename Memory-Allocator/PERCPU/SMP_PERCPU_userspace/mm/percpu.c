@@ -85,6 +85,7 @@ void *pcpu_base_addr;
  * mappings on applicable archs.
  */
 unsigned long __per_cpu_offset[NR_CPUS];
+__thread unsigned int __cpu_number;
 #endif
 
 
@@ -0,0 +1,148 @@
+/*
+ * Fast batching percpu counters.
+ *
+ * (C) 2026.10.18 BuddyZhang1 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include "linux/biscuitos.h"
+#include "linux/percpu_counter.h"
+
+/*
+ * Largest per-CPU delta before it is folded into ->count, by default
+ * max(32, 2 * NR_CPUS) as in the kernel. Bigger
+ * batches take ->lock less often and make percpu_counter_read()
+ * less accurate, by up to batch * NR_CPUS.
+ */
+int percpu_counter_batch = NR_CPUS * 2 > 32 ? NR_CPUS * 2 : 32;
+
+/*
+ * The per-CPU delta is only written by the thread bound to that CPU,
+ * but __percpu_counter_sum() reads it from others: single-copy atomic
+ * loads and stores, no read-modify-write needed.
+ */
+static inline s32 pcpu_delta_read(s32 *pcount)
+{
+	return __atomic_load_n(pcount, __ATOMIC_RELAXED);
+}
+
+static inline void pcpu_delta_write(s32 *pcount, s32 val)
+{
+	__atomic_store_n(pcount, val, __ATOMIC_RELAXED);
+}
+
+void percpu_counter_set(struct percpu_counter *fbc, s64 amount)
+{
+	unsigned int cpu;
+
+	pthread_spin_lock(&fbc->lock);
+	for_each_possible_cpu(cpu)
+		pcpu_delta_write(per_cpu_ptr(fbc->counters, cpu), 0);
+	__atomic_store_n(&fbc->count, amount, __ATOMIC_RELAXED);
+	pthread_spin_unlock(&fbc->lock);
+}
+
+/*
+ * This function is both preempt and irq safe. The former is due to
+ * explicit preemption disable. The latter is guaranteed by the fact
+ * that the slow path is explicitly protected by an irq-safe spinlock
+ * whereas the fast patch uses this_cpu_add which is irq-safe by
+ * definition. Hence there is no need muck with irq state before
+ * calling this one
+ *
+ * Userspace: "preemption disabled" is the one-thread-per-CPU rule of
+ * bind_cpu().
+ */
+void percpu_counter_add_batch(struct percpu_counter *fbc, s64 amount,
+			      s32 batch)
+{
+	s32 *pcount = this_cpu_ptr(fbc->counters);
+	s64 count;
+
+	count = pcpu_delta_read(pcount) + amount;
+	if (count >= batch || count <= -batch) {
+		pthread_spin_lock(&fbc->lock);
+		__atomic_store_n(&fbc->count, fbc->count + count,
+				 __ATOMIC_RELAXED);
+		pcpu_delta_write(pcount, 0);
+		pthread_spin_unlock(&fbc->lock);
+	} else {
+		pcpu_delta_write(pcount, count);
+	}
+}
+
+/*
+ * Add up all the per-cpu counts, return the result.  This is a more
+ * accurate but much slower version of percpu_counter_read_positive()
+ */
+s64 __percpu_counter_sum(struct percpu_counter *fbc)
+{
+	unsigned int cpu;
+	s64 ret;
+
+	pthread_spin_lock(&fbc->lock);
+	ret = fbc->count;
+	for_each_possible_cpu(cpu)
+		ret += pcpu_delta_read(per_cpu_ptr(fbc->counters, cpu));
+	pthread_spin_unlock(&fbc->lock);
+	return ret;
+}
+
+int percpu_counter_init(struct percpu_counter *fbc, s64 amount, gfp_t gfp)
+{
+	(void)gfp;
+
+	if (pthread_spin_init(&fbc->lock, PTHREAD_PROCESS_PRIVATE))
+		return -ENOMEM;
+	fbc->count = amount;
+	fbc->counters = alloc_percpu(s32);
+	if (!fbc->counters) {
+		pthread_spin_destroy(&fbc->lock);
+		return -ENOMEM;
+	}
+	percpu_counter_set(fbc, amount);
+	return 0;
+}
+
+void percpu_counter_destroy(struct percpu_counter *fbc)
+{
+	if (!fbc->counters)
+		return;
+
+	free_percpu(fbc->counters);
+	fbc->counters = NULL;
+	pthread_spin_destroy(&fbc->lock);
+}
+
+/*
+ * Compare counter against given value.
+ * Return 1 if greater, 0 if equal and -1 if less
+ */
+int __percpu_counter_compare(struct percpu_counter *fbc, s64 rhs, s32 batch)
+{
+	s64	count;
+
+	count = percpu_counter_read(fbc);
+	/* Check to see if rough count will be sufficient for comparison */
+	if (count - rhs > (s64)batch * NR_CPUS) {
+		return 1;
+	} else if (count - rhs < -(s64)batch * NR_CPUS) {
+		return -1;
+	}
+	/* Need to use precise count */
+	count = percpu_counter_sum(fbc);
+	if (count > rhs)
+		return 1;
+	else if (count < rhs)
+		return -1;
+	else
+		return 0;
+}
+
+/* Tune the default batch of percpu_counter_add() */
+void percpu_counter_set_batch(int batch)
+{
+	percpu_counter_batch = max(batch, 1);
+}
@@ -0,0 +1,177 @@
+/*
+ * percpu_counter benchmark
+ *
+ * (C) 2026.10.18 BuddyZhang1 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Usage: percpu_counter_bench [-t threads] [-n incs_per_thread]
+ *
+ * Every thread runs as one emulated CPU (threads <= CPUS given to make)
+ * and adds 1 to a shared counter n times: first to a single atomic
+ * long, then to a percpu_counter with growing batches. Afterwards the
+ * cost and the error of percpu_counter_read() against
+ * percpu_counter_sum() are shown.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "linux/biscuitos.h"
+#include "linux/memblock.h"
+#include "linux/percpu.h"
+#include "linux/percpu_counter.h"
+
+#define NR_READS	1000000
+
+static const int batches[] = { 1, 32, 256, 4096 };
+#define NR_BATCHES	(sizeof(batches) / sizeof(batches[0]))
+
+static long atomic_counter;
+static struct percpu_counter pcpu_counter;
+static int cur_batch;	/* 0: atomic long */
+static unsigned long nr_incs;
+static int start_flag;
+
+struct worker {
+	pthread_t tid;
+	unsigned int cpu;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long i;
+	cpu_set_t set;
+
+	bind_cpu(w->cpu);
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu % ncpus, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	while (!__atomic_load_n(&start_flag, __ATOMIC_ACQUIRE))
+		sched_yield();
+
+	if (!cur_batch) {
+		for (i = 0; i < nr_incs; i++)
+			__atomic_fetch_add(&atomic_counter, 1, __ATOMIC_RELAXED);
+	} else {
+		for (i = 0; i < nr_incs; i++)
+			percpu_counter_add_batch(&pcpu_counter, 1, cur_batch);
+	}
+	return NULL;
+}
+
+static double run(unsigned int nr_threads)
+{
+	struct worker workers[NR_CPUS];
+	unsigned int t;
+	double start;
+
+	start_flag = 0;
+	for (t = 0; t < nr_threads; t++) {
+		workers[t].cpu = t;
+		pthread_create(&workers[t].tid, NULL, worker_fn, &workers[t]);
+	}
+	start = now();
+	__atomic_store_n(&start_flag, 1, __ATOMIC_RELEASE);
+	for (t = 0; t < nr_threads; t++)
+		pthread_join(workers[t].tid, NULL);
+	return now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int nr_threads = NR_CPUS, i;
+	s64 expect, read, sum;
+	volatile s64 sink;
+	double t;
+	int opt, ret = 0;
+
+	nr_incs = 10000000;
+	while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'n':
+			nr_incs = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			printk("Usage: %s [-t threads] [-n incs_per_thread]\n",
+								argv[0]);
+			return -1;
+		}
+	}
+	if (!nr_threads || nr_threads > NR_CPUS) {
+		printk("threads 1..%d, build with CPUS=N for more\n", NR_CPUS);
+		return -1;
+	}
+
+	memory_init();
+	if (percpu_counter_init(&pcpu_counter, 0, GFP_KERNEL))
+		return -1;
+
+	expect = (s64)nr_threads * nr_incs;
+	printk("\n%u threads x %lu increments\n", nr_threads, nr_incs);
+	printk("%-22s %10s %12s %12s\n", "", "Mops/s", "read", "sum");
+
+	cur_batch = 0;
+	atomic_counter = 0;
+	t = run(nr_threads);
+	printk("%-22s %10.2f %12ld %12ld\n", "atomic long", expect / t / 1e6,
+				atomic_counter, atomic_counter);
+	if (atomic_counter != expect)
+		ret = -1;
+
+	for (i = 0; i < NR_BATCHES; i++) {
+		char name[32];
+
+		cur_batch = batches[i];
+		percpu_counter_set(&pcpu_counter, 0);
+		t = run(nr_threads);
+		read = percpu_counter_read(&pcpu_counter);
+		sum = percpu_counter_sum(&pcpu_counter);
+		sprintf(name, "percpu_counter b=%d", cur_batch);
+		printk("%-22s %10.2f %12lld %12lld\n", name, expect / t / 1e6,
+								read, sum);
+		/* read() lags by less than one batch per CPU */
+		if (sum != expect || expect - read >= (s64)cur_batch * NR_CPUS)
+			ret = -1;
+	}
+
+	/* What a reader pays */
+	t = now();
+	for (i = 0; i < NR_READS; i++)
+		sink = __atomic_load_n(&atomic_counter, __ATOMIC_RELAXED);
+	printk("\n%-22s %8.2f ns\n", "atomic long load", (now() - t) * 1e9 / NR_READS);
+	t = now();
+	for (i = 0; i < NR_READS; i++)
+		sink = percpu_counter_read(&pcpu_counter);
+	printk("%-22s %8.2f ns\n", "percpu_counter_read", (now() - t) * 1e9 / NR_READS);
+	t = now();
+	for (i = 0; i < NR_READS; i++)
+		sink = percpu_counter_sum(&pcpu_counter);
+	printk("%-22s %8.2f ns (%d CPUs)\n", "percpu_counter_sum",
+				(now() - t) * 1e9 / NR_READS, NR_CPUS);
+	(void)sink;
+
+	percpu_counter_destroy(&pcpu_counter);
+	memory_exit();
+	if (ret)
+		printk("Counter mismatch\n");
+	return ret;
+}
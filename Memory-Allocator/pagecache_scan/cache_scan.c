@@ -17,10 +17,63 @@ iterate_supers_addr iterate_supers_function;
 
 
 
-static LIST_HEAD(ordered_list);
-static DEFINE_SPINLOCK(ordered_list_lock);
+/*
+ * Top-N inodes by ->key, as a min-heap over a pool allocated when
+ * the scan starts: heap[0] is the smallest entry kept, so a candidate
+ * is either dropped after one compare or replaces it in O(log N).
+ */
+struct pgc_heap {
+    pgcount_node_t **heap;
+    pgcount_node_t *pool;
+    int nr;
+    int max;
+};
+
+static struct pgc_heap top_heap;
+static DEFINE_SPINLOCK(top_heap_lock);
+
+/* Drop inode_sb_list_lock after this many inodes */
+#define PGC_SCAN_BATCH  1024
+
+struct pgc_fd_ctx {
+    struct task_struct *tsk;
+    struct pgc_scan_stat *stat;
+    char *buf;
+};
 
-void order_list_clear(void);
+/*
+ * Incremental mode: nrpages of every inode with pagecache as of the
+ * last incremental scan. Entries not refreshed by a scan belong to
+ * inodes which went away and are reaped at its end. All of it is
+ * serialised by pgc_scan_mutex.
+ */
+struct pgc_track {
+    struct hlist_node node;
+    dev_t dev;
+    unsigned long ino;
+    unsigned long nrpages;
+    unsigned int gen;
+};
+
+/*
+ * The table is sized to the number of tracked inodes rather than
+ * fixed, so chains stay short with millions of inodes: it starts at
+ * 2^PGC_TRACK_MIN_BITS buckets and doubles (at least) whenever there
+ * are more entries than buckets. Resizing only happens where no
+ * spinlock is held: before a scan and at its lock drops.
+ */
+#define PGC_TRACK_MIN_BITS  10
+#define PGC_TRACK_MAX_BITS  22
+
+static struct hlist_head *pgc_track_hash;
+static unsigned int pgc_track_bits;
+static unsigned long pgc_nr_tracked;
+static unsigned int pgc_track_gen;
+static DEFINE_MUTEX(pgc_scan_mutex);
+
+void top_heap_clear(void);
+int top_heap_reset(int max);
+void pgc_track_clear(void);
 void print_top_num(int n);
 void scan_inodes_pagecache_one_sb(struct super_block *sb, void *arg);
 int scan_file_inode(const void *v, struct file *f, unsigned fd);
@@ -30,39 +83,137 @@ int scan_caches_sysctl_handler(struct ctl_table *table, int write,
 
 
 
-static void order_list_add(pgcount_node_t *new) 
+static void pgc_heap_sift_up(struct pgc_heap *h, int i)
 {
-    pgcount_node_t *node = NULL, *tmp = NULL;
+    int parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (h->heap[parent]->key <= h->heap[i]->key)
+            break;
+        swap(h->heap[parent], h->heap[i]);
+        i = parent;
+    }
+}
+
+static void pgc_heap_sift_down(struct pgc_heap *h, int i)
+{
+    int child;
+
+    while ((child = 2 * i + 1) < h->nr) {
+        if (child + 1 < h->nr &&
+            h->heap[child + 1]->key < h->heap[child]->key)
+            child++;
+        if (h->heap[i]->key <= h->heap[child]->key)
+            break;
+        swap(h->heap[i], h->heap[child]);
+        i = child;
+    }
+}
+
+/* Caller holds top_heap_lock */
+static bool pgc_heap_wants(struct pgc_heap *h, uint64_t key)
+{
+    return h->nr < h->max || (h->max && key > h->heap[0]->key);
+}
 
-    if (list_empty(&ordered_list)) {
-        list_add(&new->list, &ordered_list);
+/*
+ * Keep a copy of @src if it is among the top N so far. Called with
+ * spinlocks held, so @path is duplicated with GFP_ATOMIC; if that fails
+ * the entry is kept without a path.
+ */
+static void top_heap_add(const pgcount_node_t *src, const char *path)
+{
+    struct pgc_heap *h = &top_heap;
+    pgcount_node_t *node;
+    char *old_path;
+    bool grow;
+
+    spin_lock(&top_heap_lock);
+    if (!pgc_heap_wants(h, src->key)) {
+        spin_unlock(&top_heap_lock);
         return;
     }
 
-    list_for_each_entry_safe(node, tmp, &ordered_list, list) {
-        if (new->pagecount > node->pagecount) {
-            list_add(&new->list, node->list.prev);
-            return;
-        } 
+    grow = h->nr < h->max;
+    if (grow) {
+        node = &h->pool[h->nr];
+        h->heap[h->nr++] = node;
+    } else {
+        node = h->heap[0];
     }
+    old_path = node->abspath;
+    *node = *src;
+    node->abspath = path ? kstrdup(path, GFP_ATOMIC) : NULL;
 
-    list_add_tail(&new->list, &ordered_list);
+    if (grow)
+        pgc_heap_sift_up(h, h->nr - 1);
+    else
+        pgc_heap_sift_down(h, 0);
+    spin_unlock(&top_heap_lock);
 
-    return;
+    kfree(old_path);
 }
 
-void order_list_clear(void)
+static void pgc_heap_free(struct pgc_heap *h)
 {
-    pgcount_node_t *node = NULL, *tmp = NULL;
+    int i;
 
-    spin_lock(&ordered_list_lock);
-    list_for_each_entry_safe(node, tmp, &ordered_list, list) {
-        list_del(&node->list);
-        kfree(node);
+    for (i = 0; i < h->nr; i++)
+        kfree(h->heap[i]->abspath);
+    vfree(h->heap);
+    vfree(h->pool);
+}
+
+/*
+ * Start a new scan keeping the top @max inodes. Allocates outside of
+ * any lock, so the walk itself never allocates.
+ */
+int top_heap_reset(int max)
+{
+    struct pgc_heap new = { .max = max }, old;
+
+    if (max) {
+        new.heap = vzalloc(max * sizeof(*new.heap));
+        new.pool = vzalloc(max * sizeof(*new.pool));
+        if (!new.heap || !new.pool) {
+            vfree(new.heap);
+            vfree(new.pool);
+            return -ENOMEM;
+        }
     }
-    spin_unlock(&ordered_list_lock);
 
-    return;
+    spin_lock(&top_heap_lock);
+    old = top_heap;
+    top_heap = new;
+    spin_unlock(&top_heap_lock);
+
+    pgc_heap_free(&old);
+    return 0;
+}
+
+void top_heap_clear(void)
+{
+    top_heap_reset(0);
+}
+
+static int pgc_cmp(const void *a, const void *b)
+{
+    const pgcount_node_t *x = *(pgcount_node_t * const *)a;
+    const pgcount_node_t *y = *(pgcount_node_t * const *)b;
+
+    if (x->key < y->key)
+        return -1;
+    return x->key > y->key;
+}
+
+static void pgc_devname(struct super_block *sb, char *buf, size_t len)
+{
+    if (sb && sb->s_bdev && sb->s_bdev->bd_part && sb->s_bdev->bd_disk)
+        snprintf(buf, len, "%s%d", sb->s_bdev->bd_disk->disk_name,
+                               sb->s_bdev->bd_part->partno);
+    else
+        snprintf(buf, len, "(null)");
 }
 
 #define K (1024)
@@ -71,99 +222,253 @@ void order_list_clear(void)
 
 void print_top_num(int num)
 {
-    int count = 0;
+    struct pgc_heap *h = &top_heap;
     uint64_t gb = 0UL, mb = 0UL, kb = 0UL;
     uint64_t bytes = 0UL;
-    pgcount_node_t *n = NULL, *tmp = NULL;
+    pgcount_node_t *n = NULL;
+    int i;
 
-    if (list_empty(&ordered_list)) {
-        printk("ordered_list is empty !\n");
-	goto out;
+    spin_lock(&top_heap_lock);
+    if (h->nr == 0) {
+        printk("pgscan: nothing to report !\n");
+        goto out;
     }
 
-    spin_lock(&ordered_list_lock);
-    printk("\n"); 
-    list_for_each_entry_safe(n, tmp, &ordered_list, list) {
-        if (count++ < num) {
-            bytes = n->pagecount * PAGE_SIZE;
-            gb  = bytes / G;
-            mb  = (bytes - (gb * G)) / M;
-            kb  = (bytes - (gb * G) - (mb * M)) / K; 
-
-            if (gb != 0) {
-                printk("pgscan: %6s ino: %10llu icount: %u nrpage: %8llu %3lluGB,%3lluMB,%3lluKB isz: %llu\t pid: %-6u\t comm: %s path: %s\n", 
-                    n->devname, n->ino, n->icount, n->pagecount, gb, mb, kb, n->size, n->pid, n->comm, n->abspath);
-            } else if (mb != 0) {
-                printk("pgscan: %6s ino: %10llu icount: %u nrpage: %8llu %3lluGB,%3lluMB,%3lluKB isz: %llu\t pid: %-6u\t comm: %s path: %s\n", 
-                    n->devname, n->ino, n->icount, n->pagecount, gb, mb, kb, n->size, n->pid, n->comm, n->abspath);
-            } else if (kb != 0) {
-                printk("pgscan: %6s ino: %10llu icount: %u nrpage: %8llu %3lluGB,%3lluMb,%3lluKB isz: %llu\t pid: %-6u\t comm: %s path: %s\n", 
-                    n->devname, n->ino, n->icount, n->pagecount, gb, mb, kb, n->size, n->pid, n->comm, n->abspath);
-            }
+    /* Ascending order is still a valid min-heap, print it backwards */
+    sort(h->heap, h->nr, sizeof(*h->heap), pgc_cmp, NULL);
+    printk("\n");
+    for (i = h->nr - 1; i >= 0 && i >= h->nr - num; i--) {
+        n = h->heap[i];
+        bytes = n->pagecount * PAGE_SIZE;
+        gb  = bytes / G;
+        mb  = (bytes - (gb * G)) / M;
+        kb  = (bytes - (gb * G) - (mb * M)) / K;
+
+        if (n->delta) {
+            printk("pgscan: %6s ino: %10llu icount: %u nrpage: %8llu %3lluGB,%3lluMB,%3lluKB delta: %+lld isz: %llu\n",
+                n->devname, n->ino, n->icount, n->pagecount, gb, mb, kb, n->delta, n->size);
+            continue;
         }
+        printk("pgscan: %6s ino: %10llu icount: %u nrpage: %8llu %3lluGB,%3lluMB,%3lluKB isz: %llu\t pid: %-6u\t comm: %s path: %s\n",
+            n->devname, n->ino, n->icount, n->pagecount, gb, mb, kb, n->size, n->pid, n->comm, n->abspath);
     }
-    printk("\n"); 
+    printk("\n");
 
 out:
-    spin_unlock(&ordered_list_lock);
-    return;    
+    spin_unlock(&top_heap_lock);
+    return;
+}
+
+static inline struct hlist_head *pgc_track_bucket(dev_t dev, unsigned long ino)
+{
+    unsigned long key = ino ^ ((unsigned long)dev << 20);
+
+    return &pgc_track_hash[hash_long(key, pgc_track_bits)];
+}
+
+static struct pgc_track *pgc_track_lookup(dev_t dev, unsigned long ino)
+{
+    struct pgc_track *t;
+
+    hlist_for_each_entry(t, pgc_track_bucket(dev, ino), node)
+        if (t->dev == dev && t->ino == ino)
+            return t;
+    return NULL;
+}
+
+static void pgc_track_del(struct pgc_track *t)
+{
+    hlist_del(&t->node);
+    kfree(t);
+    pgc_nr_tracked--;
 }
 
+/*
+ * Make sure the table has at least one bucket per tracked inode.
+ * Sleeps; called under pgc_scan_mutex only. On allocation failure the
+ * old table is kept, just with longer chains.
+ */
+static int pgc_track_grow(void)
+{
+    struct hlist_head *old = pgc_track_hash, *new;
+    unsigned int old_bits = pgc_track_bits, bits;
+    struct hlist_node *tmp;
+    struct pgc_track *t;
+    unsigned long i;
+
+    bits = max_t(unsigned int, PGC_TRACK_MIN_BITS, fls_long(pgc_nr_tracked));
+    bits = min_t(unsigned int, bits, PGC_TRACK_MAX_BITS);
+    if (old && bits <= old_bits)
+        return 0;
+
+    new = vzalloc(sizeof(*new) << bits);
+    if (new == NULL)
+        return old ? 0 : -ENOMEM;
+
+    pgc_track_hash = new;
+    pgc_track_bits = bits;
+    if (old == NULL)
+        return 0;
+
+    for (i = 0; i < (1UL << old_bits); i++)
+        hlist_for_each_entry_safe(t, tmp, &old[i], node) {
+            hlist_del(&t->node);
+            hlist_add_head(&t->node, pgc_track_bucket(t->dev, t->ino));
+        }
+    vfree(old);
+    return 0;
+}
+
+/*
+ * Incremental mode, called under inode->i_lock: refresh @inode's entry
+ * and offer it to the top heap by how far nrpages moved.
+ */
+static void pgc_track_inode(struct inode *inode, pgcount_node_t *pgc,
+                            struct pgc_scan_stat *stat)
+{
+    unsigned long nrpages = inode->i_mapping->nrpages;
+    dev_t dev = inode->i_sb->s_dev;
+    struct pgc_track *t;
+    int64_t delta;
+
+    t = pgc_track_lookup(dev, inode->i_ino);
+    if (t == NULL) {
+        if (nrpages == 0)
+            return;
+        t = kmalloc(sizeof(*t), GFP_NOWAIT | __GFP_NOWARN);
+        if (t == NULL) {
+            stat->untracked++;
+            return;
+        }
+        t->dev = dev;
+        t->ino = inode->i_ino;
+        t->nrpages = 0;
+        hlist_add_head(&t->node, pgc_track_bucket(dev, t->ino));
+        pgc_nr_tracked++;
+    }
+
+    delta = (int64_t)nrpages - (int64_t)t->nrpages;
+    t->nrpages = nrpages;
+    t->gen = pgc_track_gen;
+    if (nrpages == 0)
+        pgc_track_del(t);
+    if (delta == 0)
+        return;
+
+    stat->changed++;
+    pgc->ino = inode->i_ino;
+    pgc->pagecount = nrpages;
+    pgc->icount = atomic_read(&inode->i_count);
+    pgc->size = i_size_read(inode);
+    pgc->delta = delta;
+    pgc->key = abs64(delta);
+    top_heap_add(pgc, NULL);
+}
+
+/* Inodes not seen by this scan were evicted, report their pages gone */
+static void pgc_track_reap(struct pgc_scan_stat *stat)
+{
+    struct hlist_node *tmp;
+    struct pgc_track *t;
+    pgcount_node_t pgc;
+    unsigned long bkt;
+
+    memset(&pgc, 0, sizeof(pgc));
+    for (bkt = 0; bkt < (1UL << pgc_track_bits); bkt++)
+        hlist_for_each_entry_safe(t, tmp, &pgc_track_hash[bkt], node) {
+            if (t->gen == pgc_track_gen)
+                continue;
+            stat->changed++;
+            snprintf(pgc.devname, sizeof(pgc.devname), "%u:%u",
+                     MAJOR(t->dev), MINOR(t->dev));
+            pgc.ino = t->ino;
+            pgc.delta = -(int64_t)t->nrpages;
+            pgc.key = t->nrpages;
+            top_heap_add(&pgc, NULL);
+            pgc_track_del(t);
+        }
+}
+
+void pgc_track_clear(void)
+{
+    struct hlist_node *tmp;
+    struct pgc_track *t;
+    unsigned long bkt;
+
+    mutex_lock(&pgc_scan_mutex);
+    if (pgc_track_hash) {
+        for (bkt = 0; bkt < (1UL << pgc_track_bits); bkt++)
+            hlist_for_each_entry_safe(t, tmp, &pgc_track_hash[bkt], node)
+                pgc_track_del(t);
+        vfree(pgc_track_hash);
+        pgc_track_hash = NULL;
+        pgc_track_bits = 0;
+    }
+    mutex_unlock(&pgc_scan_mutex);
+}
+
+/*
+ * Walk sb->s_inodes without holding inode_sb_list_lock for the whole
+ * superblock: every PGC_SCAN_BATCH inodes, or when we should resched,
+ * pin the current inode as a cursor and drop the lock, as
+ * drop_pagecache_sb() does. A pinned inode stays on s_inodes, so the
+ * walk carries on from it.
+ */
 void scan_inodes_pagecache_one_sb(struct super_block *sb, void *arg)
 {
-    struct inode *inode = NULL;
-    pgcount_node_t *pgc = NULL;
+    struct pgc_scan_stat *stat = arg;
+    struct inode *inode = NULL, *toput_inode = NULL;
     struct address_space *mapping = NULL;
-    //struct dentry *de   = NULL;
-  
-    spin_lock(&ordered_list_lock); 
+    pgcount_node_t pgc;
+    int batch = 0;
+
+    memset(&pgc, 0, sizeof(pgc));
+    pgc_devname(sb, pgc.devname, sizeof(pgc.devname));
+
     spin_lock(inode_sb_list_lock);
     list_for_each_entry(inode, &sb->s_inodes, i_sb_list) {
-        if (pgc == NULL) {
-            pgc = kzalloc((sizeof(pgcount_node_t)), GFP_KERNEL);
-            if (pgc == NULL) {
-                printk("kmalloc failed, nomem");
-                goto out;
-            }
+        spin_lock(&inode->i_lock);
+        batch++;
+        stat->inodes++;
+        if (inode->i_state & (I_FREEING | I_WILL_FREE | I_NEW)) {
+            spin_unlock(&inode->i_lock);
+            continue;
         }
 
-        spin_lock(&inode->i_lock);
         mapping = inode->i_mapping;
-        if (inode->i_state & (I_FREEING | I_WILL_FREE | I_NEW) || mapping->nrpages == 0) {
+        if (stat->incremental) {
+            pgc_track_inode(inode, &pgc, stat);
+        } else if (mapping->nrpages) {
+            pgc.ino = inode->i_ino;
+            pgc.pagecount = mapping->nrpages;
+            pgc.key = pgc.pagecount;
+            pgc.icount = atomic_read(&inode->i_count);
+            pgc.size = i_size_read(inode);
+            top_heap_add(&pgc, NULL);
+        }
+
+        if (batch < PGC_SCAN_BATCH && !need_resched()) {
             spin_unlock(&inode->i_lock);
             continue;
         }
-	if (sb->s_bdev && sb->s_bdev->bd_part && sb->s_bdev->bd_disk) {
-            pgc->ino = inode->i_ino;
-            snprintf(pgc->devname, sizeof(pgc->devname), "%s%d",  sb->s_bdev->bd_disk->disk_name, 
-                               sb->s_bdev->bd_part->partno);
-            pgc->pagecount = mapping->nrpages;
-            pgc->icount = atomic_read(&inode->i_count);
-        } else {
-            snprintf(pgc->devname, sizeof(pgc->devname), "(null)");
-            //printk("%s ino: %ul\tnrpages: %ul\n", __FUNCTION__, inode->i_ino, mapping->nrpages);
-        }
-        
+
+        /* __iget(), which is not exported */
+        atomic_inc(&inode->i_count);
         spin_unlock(&inode->i_lock);
-/*
-        de = d_find_alias(inode);
-        if (de) {
-            memset(buf, 0, PATH_MAX);
-            res = dentry_path_raw(de, buf, (PATH_MAX - 10 - 1));
-        printk("res=%d path = %s\n", IS_ERR(res), buf);
-            if (!IS_ERR(res) && d_unlinked(de)) {
-                memcpy((ptr + strlen(buf)), "//deleted", 10);
-                memcpy(pgc->abspath, buf, strlen(buf));
-            }
-        }
-*/
-        order_list_add(pgc);
-        pgc = NULL;
-    } // list_for_each_entry
+        spin_unlock(inode_sb_list_lock);
 
-out:
+        iput(toput_inode);
+        toput_inode = inode;
+        batch = 0;
+        stat->lock_drops++;
+        if (stat->incremental)
+            pgc_track_grow();
+        cond_resched();
+
+        spin_lock(inode_sb_list_lock);
+    }
     spin_unlock(inode_sb_list_lock);
-    spin_unlock(&ordered_list_lock); 
+    iput(toput_inode);
 
     return;
 }
@@ -184,104 +489,105 @@ static int count_open_files(struct fdtable *fdt)
 }
 #endif
 
+/* iterate_fd() callback, runs under files->file_lock */
 int scan_file_inode(const void *v, struct file *f, unsigned fd)
 {
-    int ret = 0;
+    const struct pgc_fd_ctx *ctx = v;
+    const struct task_struct *tsk = ctx->tsk;
+    struct inode *inode = NULL;
+    struct address_space *mapping = NULL;
+    pgcount_node_t pgc;
+    bool wanted;
     char *p = NULL;
-   struct inode *inode = NULL; 
-    struct address_space *mapping = NULL; 
-    pgcount_node_t *pgc = NULL;
-    struct super_block *sb = NULL;
-    const struct task_struct *tsk = v;
 
-    if (!f) 
+    if (!f)
         return 0;
 
-    //spin_lock(&f->f_lock); 
-    inode = f->f_mapping->host; //f->f_inode only is cached 
-    if (inode) {
-        //iget(inode);
-        mapping = inode->i_mapping;
-        if (mapping->nrpages == 0)
-            goto out;
+    ctx->stat->files++;
+    inode = f->f_mapping->host; //f->f_inode only is cached
+    if (!inode)
+        return 0;
 
-        if (sysctl_pgcache_scan_file_deleted_but_used) {
-            if (!((inode->i_nlink == 0) && (atomic_read(&inode->i_count) != 0))) {
-                goto out;
-            }
-        }
-        pgc = kzalloc((sizeof(pgcount_node_t) + PATH_MAX + 11), GFP_KERNEL);
-        if (pgc == NULL) {
-            ret = -ENOMEM;
-            goto out;
-        }
-        pgc->abspath = (char *)(pgc + 1);
-        p = d_path(&f->f_path, pgc->abspath, (PATH_MAX + 11));
-        pgc->ino = inode->i_ino;
-        pgc->size = i_size_read(inode);
-        pgc->abspath = p;
-        if (inode->i_sb) {
-            sb = inode->i_sb;
-            if (sb && sb->s_bdev && sb->s_bdev->bd_disk) {
-                snprintf(pgc->devname, sizeof(pgc->devname), "%s%d",  sb->s_bdev->bd_disk->disk_name, 
-                               sb->s_bdev->bd_part->partno);
-            } else {
-                snprintf(pgc->devname, sizeof(pgc->devname), "(null)");
-            }
-        }
-        pgc->pagecount = mapping->nrpages;
-        pgc->icount = atomic_read(&inode->i_count);
-        if (tsk) {
-            pgc->pid = tsk->pid;
-            memcpy(pgc->comm, tsk->comm, TASK_COMM_LEN);
-        }
-#if 0
-        printk("path = %s, ino = %lu fd: %u devname: %s com: %s nrpage： %d\n", pgc->abspath, pgc->ino, fd, 
-                     pgc->devname, tsk->comm, pgc->pagecount);
-#endif
-        if (pgc) {
-            order_list_add(pgc);
-        }
-        
-        //iput(inode);
+    mapping = inode->i_mapping;
+    if (mapping->nrpages == 0)
+        return 0;
+
+    if (sysctl_pgcache_scan_file_deleted_but_used) {
+        if (!((inode->i_nlink == 0) && (atomic_read(&inode->i_count) != 0)))
+            return 0;
     }
 
-out:
+    /* Most files don't make the top N, skip d_path() for them */
+    spin_lock(&top_heap_lock);
+    wanted = pgc_heap_wants(&top_heap, mapping->nrpages);
+    spin_unlock(&top_heap_lock);
+    if (!wanted)
+        return 0;
+
+    memset(&pgc, 0, sizeof(pgc));
+    pgc.ino = inode->i_ino;
+    pgc.size = i_size_read(inode);
+    pgc.pagecount = mapping->nrpages;
+    pgc.key = pgc.pagecount;
+    pgc.icount = atomic_read(&inode->i_count);
+    pgc_devname(inode->i_sb, pgc.devname, sizeof(pgc.devname));
+    if (tsk) {
+        pgc.pid = tsk->pid;
+        memcpy(pgc.comm, tsk->comm, TASK_COMM_LEN);
+    }
+
+    p = d_path(&f->f_path, ctx->buf, (PATH_MAX + 11));
+    top_heap_add(&pgc, IS_ERR(p) ? NULL : p);
+
     return 0;
 }
- 
-int scan_process_inodes_pagecache(void)
+
+int scan_process_inodes_pagecache(struct pgc_scan_stat *stat)
 {
     struct task_struct *p = NULL;
-    //struct fdtable *fdt = NULL;
-    //const struct cred *cred;
-    //pid_t ppid, tpid;
+    struct pgc_fd_ctx ctx = { .stat = stat };
+
+    /* One d_path() buffer for the whole scan */
+    ctx.buf = kmalloc(PATH_MAX + 11, GFP_KERNEL);
+    if (ctx.buf == NULL)
+        return -ENOMEM;
 
     rcu_read_lock();
     for_each_process(p) {
         if ((p == &init_task) || (p == current)) {
             continue;
         }
-        //cred = get_task_cred(p);
 	task_lock(p);
         if (p->files) {
-            spin_lock(&ordered_list_lock); 
-            iterate_fd(p->files, 1, scan_file_inode, p);
-            spin_unlock(&ordered_list_lock); 
+            ctx.tsk = p;
+            iterate_fd(p->files, 1, scan_file_inode, &ctx);
         }
 	task_unlock(p);
-
-//	put_cred(cred);
     }
     rcu_read_unlock();
 
+    kfree(ctx.buf);
     return 0;
 }
 
+static void pgc_scan_report(int mode, struct pgc_scan_stat *stat,
+                            ktime_t start)
+{
+    printk("pgscan: mode %d scan: %lu inodes, %lu files, %lu lock drops, %lld us\n",
+        mode, stat->inodes, stat->files, stat->lock_drops,
+        (long long)ktime_us_delta(ktime_get(), start));
+    if (stat->incremental)
+        printk("pgscan: %lu inodes tracked, %lu changed, %lu not tracked (no memory)\n",
+            pgc_nr_tracked, stat->changed, stat->untracked);
+}
+
 int scan_caches_sysctl_handler(struct ctl_table *table, int write,
         void __user *buffer, size_t *length, loff_t *ppos)
 {
+    struct pgc_scan_stat stat;
+    ktime_t start;
     int ret = 0;
+    int mode;
 
     ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
     if (ret)
@@ -289,30 +595,46 @@ int scan_caches_sysctl_handler(struct ctl_table *table, int write,
 #if 0
     printk("%s ret = %d sysctl_pgcache_scan_mode = %d\n", __FUNCTION__, ret, sysctl_pgcache_scan_mode);
 #endif
-    if (write) {
-        switch (sysctl_pgcache_scan_mode) {
-            case 0:
-                order_list_clear();
-                scan_process_inodes_pagecache();
-                print_top_num(sysctl_pgcache_scan_top_n);
-                break;
-            case 1:
-                order_list_clear();
-                iterate_supers_function(scan_inodes_pagecache_one_sb, NULL);
-                print_top_num(sysctl_pgcache_scan_top_n);
-                break;
-            case 2:
-                order_list_clear();
-                iterate_supers_function(scan_inodes_pagecache_one_sb, NULL);
-                scan_process_inodes_pagecache();
-                print_top_num(sysctl_pgcache_scan_top_n);
-                break;
-            default:
-                break;
-        }
+    if (!write)
+        return 0;
+
+    mutex_lock(&pgc_scan_mutex);
+    ret = top_heap_reset(sysctl_pgcache_scan_top_n);
+    if (ret)
+        goto out;
+
+    mode = sysctl_pgcache_scan_mode;
+    memset(&stat, 0, sizeof(stat));
+    stat.incremental = (mode == PGC_SCAN_INCREMENTAL);
+    start = ktime_get();
+
+    switch (mode) {
+        case PGC_SCAN_FILES:
+            scan_process_inodes_pagecache(&stat);
+            break;
+        case PGC_SCAN_SUPERS:
+            iterate_supers_function(scan_inodes_pagecache_one_sb, &stat);
+            break;
+        case PGC_SCAN_ALL:
+            iterate_supers_function(scan_inodes_pagecache_one_sb, &stat);
+            scan_process_inodes_pagecache(&stat);
+            break;
+        case PGC_SCAN_INCREMENTAL:
+            /* Only inodes whose nrpages moved since the last one */
+            ret = pgc_track_grow();
+            if (ret)
+                goto out;
+            pgc_track_gen++;
+            iterate_supers_function(scan_inodes_pagecache_one_sb, &stat);
+            pgc_track_reap(&stat);
+            break;
+        default:
+            goto out;
     }
+    print_top_num(sysctl_pgcache_scan_top_n);
+    pgc_scan_report(mode, &stat, start);
 
-    return 0;
+out:
+    mutex_unlock(&pgc_scan_mutex);
+    return ret;
 }
-
-
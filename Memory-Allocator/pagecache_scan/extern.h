@@ -6,9 +6,13 @@
 extern unsigned long kallsyms_lookup_name_addr;
 extern int get_kallsyms_lookup_name_function(void);
 
-extern int scan_process_inodes_pagecache(void);
+struct pgc_scan_stat;
+
+extern int scan_process_inodes_pagecache(struct pgc_scan_stat *stat);
 extern void scan_inodes_pagecache_one_sb(struct super_block *sb, void *arg);
-extern void order_list_clear(void);
+extern void top_heap_clear(void);
+extern int top_heap_reset(int max);
+extern void pgc_track_clear(void);
 extern void print_top_num(int num);
 
 extern int sysctl_pgcache_scan_top_n;
@@ -26,5 +26,11 @@
 #include <linux/genhd.h>
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/hashtable.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
 
 #endif
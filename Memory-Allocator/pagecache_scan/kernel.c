@@ -95,7 +95,8 @@ static __init int init(void)
 static __exit void fini(void)
 {
     pgcache_scan_sysctl_unregister();
-    order_list_clear();
+    top_heap_clear();
+    pgc_track_clear();
     printk("Pgcache say: goodbye !!!\n");
     return;
 }
@@ -12,10 +12,20 @@
 
 /********************************************************/
 
+/* Upper bound of pgcache_scan_top_n, the top-N heap is preallocated */
+#define PGCACHE_SCAN_TOP_MAX	65536
+
+/* pgcache_scan_mode */
+#define PGC_SCAN_FILES		0
+#define PGC_SCAN_SUPERS		1
+#define PGC_SCAN_ALL		2
+#define PGC_SCAN_INCREMENTAL	3
+
 typedef struct {
-    struct list_head list;
     uint64_t ino;
     uint64_t pagecount;
+    uint64_t key;	/* heap order: pagecount, or |delta| */
+    int64_t  delta;	/* change since the last incremental scan */
     uint32_t icount;
     pid_t    pid;
     loff_t   size;
@@ -24,6 +34,16 @@ typedef struct {
     char *abspath;
 } pgcount_node_t;
 
+/* Cost of one scan, printed after the top list */
+struct pgc_scan_stat {
+    bool incremental;
+    unsigned long inodes;	/* inodes visited on s_inodes */
+    unsigned long files;	/* open files visited */
+    unsigned long lock_drops;	/* inode_sb_list_lock released mid-walk */
+    unsigned long changed;	/* incremental: inodes whose nrpages moved */
+    unsigned long untracked;	/* incremental: no memory to track them */
+};
+
 
 /******************* global variable *********************/
 /* Lookup the address for this symbol. Returns 0 if not found. */
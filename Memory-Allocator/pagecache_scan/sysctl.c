@@ -11,9 +11,9 @@
 
 
 static int scan_top_min = 0;
-static int scan_top_max = 0x7fffffff;
+static int scan_top_max = PGCACHE_SCAN_TOP_MAX;
 static int scan_mode_min  = 0;
-static int scan_mode_max  = 2;
+static int scan_mode_max  = PGC_SCAN_INCREMENTAL;
 static int scan_deleted_min  = 0;
 static int scan_deleted_max  = 1;
 static int debug_level_min = 0;
@@ -12,6 +12,7 @@
 #include <linux/security.h>
 #include <linux/fs.h>
 #include <linux/namei.h>
+#include <linux/hash.h>
 
 #include "linux/bsfs.h"
 
@@ -36,6 +37,102 @@ static bool bsfs_lockdep(struct bsfs_node *kn)
 	return false;
 }
 
+/*
+ * Every directory gets a hash index next to the rb-tree with its first
+ * child, so that lookup can run under RCU instead of bsfs_mutex. The
+ * index starts at four buckets and doubles as the directory grows. The
+ * rb-tree stays the authority and keeps readdir ordered by hash.
+ */
+#define BSFS_DIR_INDEX_BITS	2
+#define BSFS_DIR_INDEX_MAX_BITS	12
+
+struct bsfs_dir_index {
+	unsigned int		bits;
+	struct rcu_head		rcu;
+	struct hlist_head	buckets[];
+};
+
+static inline struct bsfs_dir_index *bsfs_dir_index(struct bsfs_node *parent)
+{
+	return rcu_dereference_protected(parent->dir.index,
+				lockdep_is_held(&bsfs_mutex));
+}
+
+static inline struct hlist_head *bsfs_dir_bucket(struct bsfs_dir_index *index,
+				unsigned int hash)
+{
+	return &index->buckets[hash_32(hash, index->bits)];
+}
+
+/*
+ * Move every child of @parent into a fresh table of 1 << @bits
+ * buckets. Readers still walking the old table may be carried into
+ * the new one half way through a chain; the seqcount tells them to
+ * look again rather than trust a miss.
+ */
+static void bsfs_dir_index_rehash(struct bsfs_node *parent, unsigned int bits)
+{
+	struct bsfs_dir_index *old = bsfs_dir_index(parent);
+	struct bsfs_dir_index *new;
+	struct rb_node *rbn;
+
+	new = kzalloc(struct_size(new, buckets, 1U << bits), GFP_KERNEL);
+	if (!new)
+		return;	/* the index is only a shortcut */
+	new->bits = bits;
+
+	if (!old)
+		seqcount_init(&parent->dir.index_seq);
+
+	write_seqcount_begin(&parent->dir.index_seq);
+	for (rbn = rb_first(&parent->dir.children); rbn; rbn = rb_next(rbn)) {
+		struct bsfs_node *kn = rb_to_kn(rbn);
+
+		if (old)
+			hlist_del_rcu(&kn->hnode);
+		hlist_add_head_rcu(&kn->hnode, bsfs_dir_bucket(new, kn->hash));
+	}
+	rcu_assign_pointer(parent->dir.index, new);
+	write_seqcount_end(&parent->dir.index_seq);
+
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+/* @kn has just been linked into its parent's rb-tree */
+static void bsfs_dir_index_add(struct bsfs_node *kn)
+{
+	struct bsfs_node *parent = kn->parent;
+	struct bsfs_dir_index *index = bsfs_dir_index(parent);
+
+	if (!index) {
+		bsfs_dir_index_rehash(parent, BSFS_DIR_INDEX_BITS);
+		return;
+	}
+
+	hlist_add_head_rcu(&kn->hnode, bsfs_dir_bucket(index, kn->hash));
+	if (parent->dir.nr_children > (1UL << index->bits) &&
+	    index->bits < BSFS_DIR_INDEX_MAX_BITS)
+		bsfs_dir_index_rehash(parent, index->bits + 1);
+}
+
+static void bsfs_dir_index_del(struct bsfs_node *kn)
+{
+	struct bsfs_node *parent = kn->parent;
+
+	if (hlist_unhashed(&kn->hnode))
+		return;
+
+	/*
+	 * Once off the chain the node may be freed and, the cache being
+	 * SLAB_TYPESAFE_BY_RCU, reused in another directory while a
+	 * reader still stands on it.
+	 */
+	write_seqcount_begin(&parent->dir.index_seq);
+	hlist_del_init_rcu(&kn->hnode);
+	write_seqcount_end(&parent->dir.index_seq);
+}
+
 static struct bsfs_node *__bsfs_new_node(struct bsfs_root *root,
 				const char *name, umode_t mode,
 				kuid_t uid, kgid_t gid,
@@ -213,6 +310,8 @@ repeat:
 			kn->name, atomic_read(&kn->active));
 	if (bsfs_type(kn) == BSFS_LINK)
 		bsfs_put(kn->symlink.target_kn);
+	if (bsfs_type(kn) == BSFS_FILE)
+		bsfs_pagebuf_free(kn);
 
 	kfree_const(kn->name);
 
@@ -223,6 +322,13 @@ repeat:
 		simple_xattrs_free(&kn->iattr->xattrs);
 	}
 	kfree(kn->iattr);
+	if (bsfs_type(kn) == BSFS_DIR) {
+		struct bsfs_dir_index *index;
+
+		index = rcu_dereference_protected(kn->dir.index, true);
+		if (index)
+			kfree_rcu(index, rcu);
+	}
 	spin_lock(&bsfs_idr_lock);
 	idr_remove(&root->ino_idr, kn->id.ino);
 	spin_unlock(&bsfs_idr_lock);
@@ -245,7 +351,9 @@ static bool bsfs_unlink_sibling(struct bsfs_node *kn)
 
 	if (bsfs_type(kn) == BSFS_DIR)
 		kn->parent->dir.subdirs--;
+	kn->parent->dir.nr_children--;
 
+	bsfs_dir_index_del(kn);
 	rb_erase(&kn->rb, &kn->parent->dir.children);
 	RB_CLEAR_NODE(&kn->rb);
 	return true;
@@ -397,6 +505,102 @@ static int bsfs_name_compare(unsigned int hash, const char *name,
 	return strcmp(name, kn->name);
 }
 
+struct bsfs_node *bsfs_new_node(struct bsfs_node *parent,
+				const char *name, umode_t mode,
+				kuid_t uid, kgid_t gid,
+				unsigned flags)
+{
+	struct bsfs_node *kn;
+
+	kn = __bsfs_new_node(bsfs_root(parent), name, mode, uid, gid, flags);
+	if (kn) {
+		bsfs_get(parent);
+		kn->parent = parent;
+	}
+	return kn;
+}
+
+static int bsfs_link_sibling(struct bsfs_node *kn)
+{
+	struct rb_node **node = &kn->parent->dir.children.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*node) {
+		struct bsfs_node *pos;
+		int result;
+
+		pos = rb_to_kn(*node);
+		parent = *node;
+		result = bsfs_name_compare(kn->hash, kn->name, kn->ns, pos);
+		if (result < 0)
+			node = &pos->rb.rb_left;
+		else if (result > 0)
+			node = &pos->rb.rb_right;
+		else
+			return -EEXIST;
+	}
+
+	rb_link_node(&kn->rb, parent, node);
+	rb_insert_color(&kn->rb, &kn->parent->dir.children);
+
+	if (bsfs_type(kn) == BSFS_DIR)
+		kn->parent->dir.subdirs++;
+	kn->parent->dir.nr_children++;
+
+	bsfs_dir_index_add(kn);
+	return 0;
+}
+
+int bsfs_add_one(struct bsfs_node *kn)
+{
+	struct bsfs_node *parent = kn->parent;
+	struct bsfs_iattrs *ps_iattr;
+	bool has_ns;
+	int ret;
+
+	mutex_lock(&bsfs_mutex);
+
+	ret = -EINVAL;
+	has_ns = bsfs_ns_enabled(parent);
+	if (WARN(has_ns != (bool)kn->ns, KERN_WARNING
+			"bsfs: ns %s in '%s' for '%s'\n",
+			has_ns ? "required" : "invalid",
+			parent->name, kn->name))
+		goto out_unlock;
+
+	if (bsfs_type(parent) != BSFS_DIR)
+		goto out_unlock;
+
+	ret = -ENOENT;
+	if (parent->flags & BSFS_EMPTY_DIR)
+		goto out_unlock;
+
+	if ((parent->flags & BSFS_ACTIVATED) && !bsfs_active(parent))
+		goto out_unlock;
+
+	kn->hash = bsfs_name_hash(kn->name, kn->ns);
+
+	ret = bsfs_link_sibling(kn);
+	if (ret)
+		goto out_unlock;
+
+	ps_iattr = parent->iattr;
+	if (ps_iattr) {
+		ktime_get_real_ts64(&ps_iattr->ia_iattr.ia_ctime);
+		ps_iattr->ia_iattr.ia_mtime = ps_iattr->ia_iattr.ia_ctime;
+	}
+
+	mutex_unlock(&bsfs_mutex);
+
+	if (!(bsfs_root(kn)->flags & BSFS_ROOT_CREATE_DEACTIVATED))
+		bsfs_activate(kn);
+	return 0;
+
+out_unlock:
+	mutex_unlock(&bsfs_mutex);
+	return ret;
+}
+
 static struct bsfs_node *bsfs_find_ns(struct bsfs_node *parent,
 				const unsigned char *name,
 				const void *ns)
@@ -429,6 +633,93 @@ static struct bsfs_node *bsfs_find_ns(struct bsfs_node *parent,
 	return NULL;
 }
 
+/*
+ * Lockless lookup in @parent's hash index. Returns the node with a
+ * reference held, ERR_PTR(-ENOENT) if the name is not there, or NULL
+ * if the index could not be allocated and the caller has to search
+ * the rb-tree.
+ */
+static struct bsfs_node *bsfs_find_ns_rcu(struct bsfs_node *parent,
+				const unsigned char *name,
+				const void *ns, unsigned int hash)
+{
+	struct bsfs_dir_index *index;
+	struct bsfs_node *kn;
+	unsigned int seq;
+
+	rcu_read_lock();
+again:
+	index = rcu_dereference(parent->dir.index);
+	if (!index) {
+		rcu_read_unlock();
+		/* never had a child; a racing add is a miss as on a chain */
+		if (!READ_ONCE(parent->dir.nr_children))
+			return ERR_PTR(-ENOENT);
+		return NULL;
+	}
+
+	seq = read_seqcount_begin(&parent->dir.index_seq);
+	hlist_for_each_entry_rcu(kn, bsfs_dir_bucket(index, hash), hnode) {
+		if (kn->hash != hash || kn->ns != ns)
+			continue;
+		if (!atomic_inc_not_zero(&kn->count))
+			continue;
+
+		/* reused or unlinked under us, the chain can't be trusted */
+		if (kn->parent != parent || hlist_unhashed(&kn->hnode)) {
+			rcu_read_unlock();
+			bsfs_put(kn);
+			rcu_read_lock();
+			goto again;
+		}
+
+		/*
+		 * The name is only stable once pinned. A mismatch here is a
+		 * collision on the 31-bit name hash: keep walking the chain.
+		 */
+		if (kn->hash == hash && kn->ns == ns &&
+		    !strcmp(name, kn->name)) {
+			rcu_read_unlock();
+			return kn;
+		}
+		bsfs_put(kn);
+	}
+
+	if (read_seqcount_retry(&parent->dir.index_seq, seq))
+		goto again;
+	rcu_read_unlock();
+	return ERR_PTR(-ENOENT);
+}
+
+/**
+ * bsfs_find_and_get_ns - find and get bsfs_node with the given name
+ * @parent: bsfs_node to search under
+ * @name: name to look for
+ * @ns: the namespace tag to use
+ *
+ * Look for bsfs_node with name @name under @parent and get a reference
+ * if found. bsfs_mutex is only taken if the directory's index could
+ * not be allocated.
+ */
+struct bsfs_node *bsfs_find_and_get_ns(struct bsfs_node *parent,
+				const char *name, const void *ns)
+{
+	struct bsfs_node *kn;
+
+	kn = bsfs_find_ns_rcu(parent, name, ns, bsfs_name_hash(name, ns));
+	if (IS_ERR(kn))
+		return NULL;
+	if (kn)
+		return kn;
+
+	mutex_lock(&bsfs_mutex);
+	kn = bsfs_find_ns(parent, name, ns);
+	bsfs_get(kn);
+	mutex_unlock(&bsfs_mutex);
+
+	return kn;
+}
+
 static struct dentry *bsfs_iop_lookup(struct inode *dir,
 			struct dentry *dentry, unsigned int flags)
 {
@@ -438,27 +729,26 @@ static struct dentry *bsfs_iop_lookup(struct inode *dir,
 	struct inode *inode;
 	const void *ns = NULL;
 
-	mutex_lock(&bsfs_mutex);
-
 	if (bsfs_ns_enabled(parent))
 		ns = bsfs_info(dir->i_sb)->ns;
 
-	kn = bsfs_find_ns(parent, dentry->d_name.name, ns);
+	kn = bsfs_find_and_get_ns(parent, dentry->d_name.name, ns);
 
-	if (!kn || !bsfs_active(kn)) {
+	/* removal deactivates before unlinking, revalidate catches the rest */
+	if (!kn || atomic_read(&kn->active) < 0) {
 		ret = NULL;
-		goto out_unlock;
+		goto out_put;
 	}
 
 	inode = bsfs_get_inode(dir->i_sb, kn);
 	if (!inode) {
 		ret = ERR_PTR(-ENOMEM);
-		goto out_unlock;
+		goto out_put;
 	}
 
 	ret = d_splice_alias(inode, dentry);
-out_unlock:
-	mutex_unlock(&bsfs_mutex);
+out_put:
+	bsfs_put(kn);
 	return ret;
 }
 
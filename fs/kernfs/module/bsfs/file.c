@@ -13,6 +13,7 @@
 #include <linux/types.h>
 #include <linux/fs.h>
 #include <linux/poll.h>
+#include <linux/sched/signal.h>
 #include <linux/seq_file.h>
 
 #include "linux/bsfs.h"
@@ -148,6 +149,60 @@ out_free:
 	return len;
 }
 
+/*
+ * Page buffer attributes are copied straight out of the producer's
+ * pages: no bounce buffer and no of->mutex. The copy is retried until
+ * it did not overlap a producer update, so one read() of the whole
+ * buffer is a consistent snapshot; a fatal signal ends the wait. A
+ * read, even of zero bytes, also acknowledges the last bsfs_notify()
+ * for poll.
+ */
+static ssize_t bsfs_pagebuf_read(struct bsfs_open_file *of,
+			char __user *user_buf, size_t count,
+			loff_t *ppos)
+{
+	struct bsfs_node *kn = of->kn;
+	struct bsfs_pagebuf_hdr *hdr = kn->attr.pagebuf;
+	loff_t pos = *ppos;
+	ssize_t len = 0;
+	u32 seq;
+
+	if (!bsfs_get_active(kn))
+		return -ENODEV;
+
+	of->event = atomic_read(&kn->attr.open->event);
+
+	if (pos < kn->attr.size) {
+		len = min_t(loff_t, count, kn->attr.size - pos);
+		for (;;) {
+			seq = READ_ONCE(hdr->seq);
+			if (!(seq & 1)) {
+				smp_rmb();
+				if (copy_to_user(user_buf,
+					kn->attr.pagebuf + pos, len)) {
+					len = -EFAULT;
+					break;
+				}
+				smp_rmb();
+				if (READ_ONCE(hdr->seq) == seq)
+					break;
+			}
+			/* a producer may never end its update */
+			if (fatal_signal_pending(current)) {
+				len = -EINTR;
+				break;
+			}
+			cond_resched();
+		}
+
+		if (len > 0)
+			*ppos += len;
+	}
+
+	bsfs_put_active(kn);
+	return len;
+}
+
 static ssize_t bsfs_fop_read(struct file *file, char __user *user_buf,
 			size_t count, loff_t *ppos)
 {
@@ -155,6 +210,8 @@ static ssize_t bsfs_fop_read(struct file *file, char __user *user_buf,
 
 	if (of->kn->flags & BSFS_HAS_SEQ_SHOW)
 		return seq_read(file, user_buf, count, ppos);
+	else if (of->kn->flags & BSFS_HAS_PAGEBUF)
+		return bsfs_pagebuf_read(of, user_buf, count, ppos);
 	else
 		return bsfs_file_direct_read(of, user_buf, count, ppos);
 }
@@ -246,6 +303,45 @@ static const struct vm_operations_struct bsfs_vm_ops = {
 	.access		= bsfs_vma_access,
 };
 
+static vm_fault_t bsfs_pagebuf_fault(struct vm_fault *vmf)
+{
+	struct bsfs_node *kn = bsfs_of(vmf->vma->vm_file)->kn;
+
+	if (vmf->pgoff >= PAGE_ALIGN(kn->attr.size) >> PAGE_SHIFT)
+		return VM_FAULT_SIGBUS;
+
+	vmf->page = virt_to_page(kn->attr.pagebuf +
+				(vmf->pgoff << PAGE_SHIFT));
+	get_page(vmf->page);
+	return 0;
+}
+
+static const struct vm_operations_struct bsfs_pagebuf_vm_ops = {
+	.fault		= bsfs_pagebuf_fault,
+};
+
+/* Map the producer's pages; bsfs_vma_fault() pins the node around us */
+static int bsfs_pagebuf_mmap(struct bsfs_open_file *of,
+				struct vm_area_struct *vma)
+{
+	unsigned long nr_pages = PAGE_ALIGN(of->kn->attr.size) >> PAGE_SHIFT;
+
+	if (vma->vm_pgoff >= nr_pages ||
+	    vma_pages(vma) > nr_pages - vma->vm_pgoff)
+		return -EINVAL;
+
+	/* only the producer writes the buffer */
+	if (vma->vm_flags & VM_SHARED) {
+		if (vma->vm_flags & VM_WRITE)
+			return -EACCES;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_ops = &bsfs_pagebuf_vm_ops;
+	return 0;
+}
+
 static int bsfs_fop_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct bsfs_open_file *of = bsfs_of(file);
@@ -262,7 +358,10 @@ static int bsfs_fop_mmap(struct file *file, struct vm_area_struct *vma)
 		goto out_unlock;
 
 	pos = bsfs_ops(of->kn);
-	rc = pos->mmap(of, vma);
+	if (of->kn->flags & BSFS_HAS_PAGEBUF)
+		rc = bsfs_pagebuf_mmap(of, vma);
+	else
+		rc = pos->mmap(of, vma);
 	if (rc)
 		goto out_put;
 
@@ -454,9 +553,10 @@ static int bsfs_fop_open(struct inode *inode, struct file *file)
 
 	ops = bsfs_ops(kn);
 
-	has_read = ops->seq_show || ops->read || ops->mmap;
+	has_read = ops->seq_show || ops->read || ops->mmap ||
+		   (kn->flags & BSFS_HAS_PAGEBUF);
 	has_write = ops->write || ops->mmap;
-	has_mmap = ops->mmap;
+	has_mmap = ops->mmap || (kn->flags & BSFS_HAS_PAGEBUF);
 
 	if (root->flags & BSFS_ROOT_EXTRA_OPEN_PERM_CHECK) {
 		if ((file->f_mode & FMODE_WRITE) &&
@@ -589,6 +689,104 @@ out_free:
 	return len;
 }
 
+/**
+ * bsfs_pagebuf_alloc - back a file node with a page buffer
+ * @kn: BSFS_FILE node, not yet activated
+ * @size: bytes the producer needs
+ *
+ * The buffer gets a struct bsfs_pagebuf_hdr in front of @size bytes of
+ * data at bsfs_pagebuf(@kn). Producers update the data only between
+ * bsfs_pagebuf_write_begin() and bsfs_pagebuf_write_end(). Readers get
+ * it through read() without going through ops->read, or mmap it
+ * read-only and poll for changes.
+ */
+int bsfs_pagebuf_alloc(struct bsfs_node *kn, size_t size)
+{
+	void *buf;
+
+	if (WARN_ON(bsfs_type(kn) != BSFS_FILE ||
+		    (kn->flags & (BSFS_ACTIVATED | BSFS_HAS_PAGEBUF))))
+		return -EINVAL;
+
+	if (!size)
+		return -EINVAL;
+	size += sizeof(struct bsfs_pagebuf_hdr);
+
+	buf = alloc_pages_exact(size, GFP_KERNEL | __GFP_ZERO);
+	if (!buf)
+		return -ENOMEM;
+
+	kn->attr.pagebuf = buf;
+	kn->attr.size = size;
+	kn->flags |= BSFS_HAS_PAGEBUF | BSFS_HAS_MMAP;
+	return 0;
+}
+
+/**
+ * bsfs_pagebuf_write_begin - start updating a page buffer
+ * @kn: node set up by bsfs_pagebuf_alloc()
+ *
+ * Marks the buffer as being written and returns bsfs_pagebuf(@kn).
+ * Updates of one buffer must be serialised by the producer.
+ */
+void *bsfs_pagebuf_write_begin(struct bsfs_node *kn)
+{
+	struct bsfs_pagebuf_hdr *hdr = kn->attr.pagebuf;
+
+	WRITE_ONCE(hdr->seq, hdr->seq + 1);
+	smp_wmb();
+	return bsfs_pagebuf(kn);
+}
+
+/**
+ * bsfs_pagebuf_write_end - publish a page buffer update
+ * @kn: node passed to bsfs_pagebuf_write_begin()
+ *
+ * Makes the new snapshot visible and wakes up pollers.
+ */
+void bsfs_pagebuf_write_end(struct bsfs_node *kn)
+{
+	struct bsfs_pagebuf_hdr *hdr = kn->attr.pagebuf;
+
+	smp_wmb();
+	WRITE_ONCE(hdr->seq, hdr->seq + 1);
+	bsfs_notify(kn);
+}
+
+/* Pages still mapped somewhere hold references of their own */
+void bsfs_pagebuf_free(struct bsfs_node *kn)
+{
+	if (!(kn->flags & BSFS_HAS_PAGEBUF))
+		return;
+
+	free_pages_exact(kn->attr.pagebuf, kn->attr.size);
+	kn->attr.pagebuf = NULL;
+	kn->flags &= ~BSFS_HAS_PAGEBUF;
+}
+
+/**
+ * bsfs_notify - notify a bsfs file
+ * @kn: file to notify
+ *
+ * Wake up pollers of @kn. May be called from any context.
+ */
+void bsfs_notify(struct bsfs_node *kn)
+{
+	struct bsfs_open_node *on;
+	unsigned long flags;
+
+	if (WARN_ON(bsfs_type(kn) != BSFS_FILE))
+		return;
+
+	spin_lock_irqsave(&bsfs_open_node_lock, flags);
+	on = kn->attr.open;
+	if (on) {
+		atomic_inc(&on->event);
+		wake_up_interruptible(&on->poll);
+	}
+	spin_unlock_irqrestore(&bsfs_open_node_lock, flags);
+}
+
 const struct file_operations bsfs_file_fops = {
 	.read		= bsfs_fop_read,
 	.write		= bsfs_fop_write,
@@ -284,7 +284,10 @@ static void bsfs_init_inode(struct bsfs_node *kn, struct inode *inode)
 	inode->i_generation = kn->id.generation;
 
 	set_default_inode_attr(inode, kn->mode);
+	/* lookup comes here without bsfs_mutex */
+	mutex_lock(&bsfs_mutex);
 	bsfs_refresh_inode(kn, inode);
+	mutex_unlock(&bsfs_mutex);
 
 	/* initialize inode according to type */
 	switch (bsfs_type(kn)) {
@@ -156,9 +156,7 @@ static int bsfs_fill_super(struct super_block *sb, unsigned long magic)
 
 	sb->s_shrink.seeks = 0;
 
-	mutex_lock(&bsfs_mutex);
 	inode = bsfs_get_inode(sb, info->root->kn);
-	mutex_unlock(&bsfs_mutex);
 	if (!inode) {
 		pr_debug("bsfs: could not get root inode\n");
 		return -ENOMEM;
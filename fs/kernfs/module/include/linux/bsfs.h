@@ -6,6 +6,8 @@
 #include <linux/list.h>
 #include <linux/idr.h>
 #include <linux/rbtree.h>
+#include <linux/rculist.h>
+#include <linux/seqlock.h>
 #include <linux/mutex.h>
 #include <linux/xattr.h>
 
@@ -36,6 +38,7 @@ enum bsfs_node_flag {
 	BSFS_SUICIDED		= 0x0800,
 	BSFS_EMPTY_DIR		= 0x1000,
 	BSFS_HAS_RELEASE	= 0x2000,
+	BSFS_HAS_PAGEBUF	= 0x4000,
 };
 
 struct bsfs_open_file {
@@ -75,10 +78,21 @@ struct bsfs_ops {
 	int (*mmap)(struct bsfs_open_file *of, struct vm_area_struct *vma);
 };
 
+struct bsfs_dir_index;
+
 struct bsfs_elem_dir {
 	unsigned long 		subdirs;
+	unsigned long		nr_children;
 	struct rb_root		children;
 
+	/*
+	 * Name hash of the children, built with the first child and
+	 * grown with the directory. Looked up under RCU; index_seq is bumped whenever a
+	 * node leaves a chain so that a lockless miss can be retried.
+	 */
+	struct bsfs_dir_index __rcu *index;
+	seqcount_t		index_seq;
+
 	struct bsfs_root	*root;
 };
 
@@ -99,6 +113,7 @@ struct bsfs_elem_attr {
 	struct bsfs_open_node	*open;
 	loff_t			size;
 	struct bsfs_node	*notify_next;
+	void			*pagebuf; /* BSFS_HAS_PAGEBUF, size bytes */
 };
 
 struct bsfs_node {
@@ -109,6 +124,7 @@ struct bsfs_node {
 	const char		*name;
 
 	struct rb_node		rb;
+	struct hlist_node	hnode; /* parent->dir.index chain */
 
 	const void		*ns; /* namespace tag */
 	unsigned int		hash; /* ns + name hash */
@@ -201,6 +217,25 @@ static inline bool bsfs_ns_enabled(struct bsfs_node *kn)
 	return kn->flags & BSFS_NS;
 }
 
+/*
+ * A page buffer starts with this header; the producer's data follows.
+ * seq is odd while bsfs_pagebuf_write_begin/end() are updating it, so
+ * mmap readers take a snapshot the seqcount way: read an even seq,
+ * copy, and retry if seq has changed. read() does that for them, but
+ * returns the file as it is laid out: the first 8 bytes are this
+ * header, and the producer's data starts at offset 8.
+ */
+struct bsfs_pagebuf_hdr {
+	u32	seq;
+	u32	__pad;
+};
+
+/* Producer's part of the buffer */
+static inline void *bsfs_pagebuf(struct bsfs_node *kn)
+{
+	return kn->attr.pagebuf + sizeof(struct bsfs_pagebuf_hdr);
+}
+
 extern struct bsfs_root *bsfs_create_root(struct bsfs_syscall_ops *scops,
 				unsigned int flags, void *priv);
 extern struct kmem_cache *bsfs_node_cache;
@@ -236,4 +271,15 @@ extern void bsfs_evict_inode(struct inode *inode);
 extern void bsfs_put(struct bsfs_node *kn);
 extern struct bsfs_node *bsfs_find_and_get_node_by_ino(struct bsfs_root *root,
                                         unsigned int ino);
+extern struct bsfs_node *bsfs_find_and_get_ns(struct bsfs_node *parent,
+					const char *name, const void *ns);
+extern struct bsfs_node *bsfs_new_node(struct bsfs_node *parent,
+				const char *name, umode_t mode,
+				kuid_t uid, kgid_t gid, unsigned flags);
+extern int bsfs_add_one(struct bsfs_node *kn);
+extern int bsfs_pagebuf_alloc(struct bsfs_node *kn, size_t size);
+extern void bsfs_pagebuf_free(struct bsfs_node *kn);
+extern void *bsfs_pagebuf_write_begin(struct bsfs_node *kn);
+extern void bsfs_pagebuf_write_end(struct bsfs_node *kn);
+extern void bsfs_notify(struct bsfs_node *kn);
 #endif
@@ -11,10 +11,210 @@
 #include <linux/init.h>
 #include <linux/fs.h>
 #include <linux/buffer_head.h>
+#include <linux/bitmap.h>
+#include <linux/math64.h>
 #include <uapi/linux/minix_fs.h>
 
 #include "internal.h"
 
+/*
+ * Regular files take this many blocks at a time when they grow; the
+ * ones not used yet stay in the inode's preallocation window, so a
+ * file written sequentially gets one run even with other writers.
+ */
+#define MINIX_PREALLOC_BLOCKS	8
+
+/* Protects both bitmaps and every inode's preallocation window */
+static DEFINE_SPINLOCK(bitmap_lock);
+
+/*
+ * Word-wide search of one bitmap block for a free bit in [start, end):
+ * the goal itself, then the rest of its word, then (if @fresh) the
+ * first all-free word so that a new run does not start in a small
+ * hole, and finally any free bit.
+ */
+static unsigned long minix_find_free_bit(unsigned long *map,
+		unsigned long start, unsigned long end, bool fresh)
+{
+	unsigned long bit, word, last;
+
+	if (start >= end)
+		return end;
+	if (!test_bit(start, map))
+		return start;
+	last = min_t(unsigned long, ALIGN(start + 1, BITS_PER_LONG), end);
+	bit = find_next_zero_bit(map, last, start);
+	if (bit < last)
+		return bit;
+	if (fresh) {
+		for (word = last / BITS_PER_LONG;
+				word < end / BITS_PER_LONG; word++)
+			if (!map[word])
+				return word * BITS_PER_LONG;
+	}
+	return find_next_zero_bit(map, end, last);
+}
+
+/*
+ * Take up to @want free bits in a row out of the @nbits bitmap held
+ * in @maps, searching from bit @goal on and wrapping around once. A
+ * run never crosses a bitmap block. Returns the first bit and stores
+ * the length in @got, or returns 0 when the map is full: bit 0 is
+ * reserved in both minix bitmaps. Called with bitmap_lock held.
+ */
+static unsigned long minix_alloc_bits(struct super_block *sb,
+		struct buffer_head **maps, unsigned long nbits,
+		unsigned long goal, int want, int *got)
+{
+	unsigned long bpb = 8 * sb->s_blocksize;
+	unsigned long nmaps = DIV_ROUND_UP(nbits, bpb);
+	unsigned long first, i;
+
+	if (goal >= nbits)
+		goal = 0;
+	first = goal / bpb;
+	for (i = 0; i <= nmaps; i++) {
+		unsigned long blk = (first + i) % nmaps;
+		unsigned long *map = (unsigned long *)maps[blk]->b_data;
+		unsigned long end = min(bpb, nbits - blk * bpb);
+		unsigned long start = 0, bit;
+
+		if (i == 0)
+			start = goal % bpb;
+		else if (i == nmaps)
+			end = goal % bpb;	/* head of the goal block */
+		bit = minix_find_free_bit(map, start, end, want > 1);
+		if (bit >= end)
+			continue;
+		*got = find_next_bit(map, min(end, bit + want), bit) - bit;
+		bitmap_set(map, bit, *got);
+		mark_buffer_dirty(maps[blk]);
+		return blk * bpb + bit;
+	}
+	return 0;
+}
+
+static inline unsigned long minix_block_to_bit(struct minix_sb_info *sbi,
+						unsigned long block)
+{
+	return block - sbi->s_firstdatazone + 1;
+}
+
+/*
+ * With no better idea, spread files over the data zones by inode
+ * number, much like block groups would.
+ */
+static unsigned long minix_default_goal(struct inode *inode)
+{
+	struct minix_sb_info *sbi = minix_sb_bs(inode->i_sb);
+	struct minix_inode_info *mi = minix_i_bs(inode);
+	u64 span = sbi->s_nzones - sbi->s_firstdatazone;
+
+	if (mi->i_alloc_goal >= sbi->s_firstdatazone &&
+	    mi->i_alloc_goal < sbi->s_nzones)
+		return mi->i_alloc_goal;
+	return sbi->s_firstdatazone +
+		div_u64(span * (inode->i_ino - 1), sbi->s_ninodes);
+}
+
+static void __minix_discard_prealloc(struct inode *inode)
+{
+	struct super_block *sb = inode->i_sb;
+	struct minix_sb_info *sbi = minix_sb_bs(sb);
+	struct minix_inode_info *mi = minix_i_bs(inode);
+	int k = sb->s_blocksize_bits + 3;
+	unsigned long bit;
+	struct buffer_head *bh;
+
+	if (!mi->i_prealloc_count)
+		return;
+	bit = minix_block_to_bit(sbi, mi->i_prealloc_block);
+	bh = sbi->s_zmap[bit >> k];
+	bitmap_clear((unsigned long *)bh->b_data, bit & ((1 << k) - 1),
+						mi->i_prealloc_count);
+	mark_buffer_dirty(bh);
+	mi->i_prealloc_count = 0;
+}
+
+/*
+ * Give back the blocks reserved but not used by @inode: on the last
+ * close for write, truncate and evict.
+ */
+void minix_discard_prealloc_bs(struct inode *inode)
+{
+	spin_lock(&bitmap_lock);
+	__minix_discard_prealloc(inode);
+	spin_unlock(&bitmap_lock);
+}
+
+void minix_free_block_bs(struct inode *inode, unsigned long block)
+{
+	struct super_block *sb = inode->i_sb;
+	struct minix_sb_info *sbi = minix_sb_bs(sb);
+	struct buffer_head *bh;
+	int k = sb->s_blocksize_bits + 3;
+	unsigned long bit, zone;
+
+	if (block < sbi->s_firstdatazone || block >= sbi->s_nzones) {
+		printk("Trying to free block not in datazone\n");
+		return;
+	}
+	zone = minix_block_to_bit(sbi, block);
+	bit = zone & ((1 << k) - 1);
+	zone >>= k;
+	if (zone >= sbi->s_zmap_blocks) {
+		printk("minix_free_block_bs: nonexistent bitmap buffer\n");
+		return;
+	}
+	bh = sbi->s_zmap[zone];
+	spin_lock(&bitmap_lock);
+	if (!minix_test_and_clear_bit_bs(bit, bh->b_data))
+		printk("minix_free_block_bs (%s:%lu): bit already cleared\n",
+			sb->s_id, block);
+	spin_unlock(&bitmap_lock);
+	mark_buffer_dirty(bh);
+}
+
+/*
+ * Allocate a zone for @inode as close to @goal as possible. A goal
+ * that continues the inode's preallocation window is served from it
+ * without touching the bitmap; any other goal means the file is no
+ * longer written sequentially and the window is given back.
+ */
+int minix_new_block_bs(struct inode *inode, unsigned long goal)
+{
+	struct super_block *sb = inode->i_sb;
+	struct minix_sb_info *sbi = minix_sb_bs(sb);
+	struct minix_inode_info *mi = minix_i_bs(inode);
+	unsigned long nbits = sbi->s_nzones - sbi->s_firstdatazone + 1;
+	unsigned long bit;
+	int want = 1, got;
+
+	if (goal < sbi->s_firstdatazone || goal >= sbi->s_nzones)
+		goal = minix_default_goal(inode);
+
+	spin_lock(&bitmap_lock);
+	if (mi->i_prealloc_count) {
+		if (goal == mi->i_prealloc_block) {
+			mi->i_prealloc_block++;
+			mi->i_prealloc_count--;
+			spin_unlock(&bitmap_lock);
+			return goal;
+		}
+		__minix_discard_prealloc(inode);
+	}
+	if (S_ISREG(inode->i_mode))
+		want = MINIX_PREALLOC_BLOCKS;
+	bit = minix_alloc_bits(sb, sbi->s_zmap, nbits,
+			minix_block_to_bit(sbi, goal), want, &got);
+	if (bit && got > 1) {
+		mi->i_prealloc_block = bit + sbi->s_firstdatazone;
+		mi->i_prealloc_count = got - 1;
+	}
+	spin_unlock(&bitmap_lock);
+	return bit ? bit + sbi->s_firstdatazone - 1 : 0;
+}
+
 struct minix_inode *
 minix_V1_raw_inode_bs(struct super_block *sb, ino_t ino,
 						struct buffer_head **bh)
@@ -66,3 +266,105 @@ struct minix2_inode *minix_V2_raw_inode_bs(struct super_block *sb,
 	p = (void *)(*bh)->b_data;
 	return p + ino % minix2_inodes_per_block;
 }
+
+static void minix_clear_inode_bs(struct inode *inode)
+{
+	struct buffer_head *bh = NULL;
+
+	if (INODE_VERSION(inode) == MINIX_V1_BS) {
+		struct minix_inode *raw_inode;
+
+		raw_inode = minix_V1_raw_inode_bs(inode->i_sb,
+						inode->i_ino, &bh);
+		if (raw_inode) {
+			raw_inode->i_nlinks = 0;
+			raw_inode->i_mode = 0;
+		}
+	} else {
+		struct minix2_inode *raw_inode;
+
+		raw_inode = minix_V2_raw_inode_bs(inode->i_sb,
+						inode->i_ino, &bh);
+		if (raw_inode) {
+			raw_inode->i_nlinks = 0;
+			raw_inode->i_mode = 0;
+		}
+	}
+	if (bh) {
+		mark_buffer_dirty(bh);
+		brelse(bh);
+	}
+}
+
+void minix_free_inode_bs(struct inode *inode)
+{
+	struct super_block *sb = inode->i_sb;
+	struct minix_sb_info *sbi = minix_sb_bs(inode->i_sb);
+	struct buffer_head *bh;
+	int k = sb->s_blocksize_bits + 3;
+	unsigned long ino, bit;
+
+	ino = inode->i_ino;
+	if (ino < 1 || ino > sbi->s_ninodes) {
+		printk("minix_free_inode_bs: inode 0 or nonexistent inode\n");
+		return;
+	}
+	bit = ino & ((1 << k) - 1);
+	ino >>= k;
+	if (ino >= sbi->s_imap_blocks) {
+		printk("minix_free_inode_bs: nonexistent imap in superblock\n");
+		return;
+	}
+
+	minix_clear_inode_bs(inode);	/* clear on-disk copy */
+
+	bh = sbi->s_imap[ino];
+	spin_lock(&bitmap_lock);
+	if (!minix_test_and_clear_bit_bs(bit, bh->b_data))
+		printk("minix_free_inode_bs: bit %lu already cleared\n", bit);
+	spin_unlock(&bitmap_lock);
+	mark_buffer_dirty(bh);
+}
+
+/*
+ * New inodes are looked for from the parent's inode number on, and
+ * their first data block is aimed next to the parent's first block.
+ */
+struct inode *minix_new_inode_bs(const struct inode *dir, umode_t mode,
+								int *error)
+{
+	struct super_block *sb = dir->i_sb;
+	struct minix_sb_info *sbi = minix_sb_bs(sb);
+	struct minix_inode_info *pi = minix_i_bs((struct inode *)dir);
+	struct inode *inode = new_inode(sb);
+	unsigned long j;
+	int got;
+
+	if (!inode) {
+		*error = -ENOMEM;
+		return NULL;
+	}
+	*error = -ENOSPC;
+	spin_lock(&bitmap_lock);
+	j = minix_alloc_bits(sb, sbi->s_imap, sbi->s_ninodes + 1,
+						dir->i_ino, 1, &got);
+	spin_unlock(&bitmap_lock);
+	if (!j) {
+		iput(inode);
+		return NULL;
+	}
+	inode_init_owner(inode, dir, mode);
+	inode->i_ino = j;
+	inode->i_mtime = inode->i_atime = inode->i_ctime = current_time(inode);
+	inode->i_blocks = 0;
+	memset(&minix_i_bs(inode)->u, 0, sizeof(minix_i_bs(inode)->u));
+	if (INODE_VERSION(dir) == MINIX_V1_BS)
+		minix_i_bs(inode)->i_alloc_goal = pi->u.i1_data[0];
+	else
+		minix_i_bs(inode)->i_alloc_goal = pi->u.i2_data[0];
+	insert_inode_hash(inode);
+	mark_inode_dirty(inode);
+
+	*error = 0;
+	return inode;
+}
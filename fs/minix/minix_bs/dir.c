@@ -9,15 +9,663 @@
  */
 #include <linux/kernel.h>
 #include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/buffer_head.h>
+#include <linux/highmem.h>
+#include <linux/swap.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/sched/mm.h>
+#include <linux/hash.h>
+#include <linux/stringhash.h>
+#include <uapi/linux/minix_fs.h>
 
 #include "internal.h"
 
+typedef struct minix_dir_entry minix_dirent;
+
+/*
+ * Directories smaller than this many pages are always scanned
+ * linearly: walking a few cached pages is cheaper than an index.
+ */
+#define MINIX_DIR_INDEX_PAGES		4
+#define MINIX_DIR_INDEX_MIN_BITS	6
+
+/*
+ * In-memory name index of a directory: name hash -> byte offset of
+ * the dirent. It is built on the first lookup and then kept current
+ * by add_link/delete_entry, which run with the directory locked
+ * exclusive. Lookups hold it shared and only ever install a freshly
+ * built index, so no lock of its own is needed. Every hit is checked
+ * against the dirent itself, so a collision costs one compare.
+ */
+struct minix_dir_index {
+	struct hlist_head *buckets;
+	unsigned int bits;
+	unsigned long nr;
+	loff_t free_hint;	/* no free dirent below this offset */
+};
+
+struct minix_dir_slot {
+	struct hlist_node node;
+	u32 hash;
+	u32 pos;
+};
+
+static inline void dir_put_page(struct page *page)
+{
+	kunmap(page);
+	put_page(page);
+}
+
+/*
+ * Return the offset into page `page_nr' of the last valid
+ * byte in that page, plus one.
+ */
+static unsigned minix_last_byte(struct inode *inode, unsigned long page_nr)
+{
+	unsigned last_byte = PAGE_SIZE;
+
+	if (page_nr == (inode->i_size >> PAGE_SHIFT))
+		last_byte = inode->i_size & (PAGE_SIZE - 1);
+	return last_byte;
+}
+
+static int dir_commit_chunk(struct page *page, loff_t pos, unsigned len)
+{
+	struct address_space *mapping = page->mapping;
+	struct inode *dir = mapping->host;
+	int err = 0;
+
+	block_write_end(NULL, mapping, pos, len, len, page, NULL);
+
+	if (pos + len > dir->i_size) {
+		i_size_write(dir, pos + len);
+		mark_inode_dirty(dir);
+	}
+	if (IS_DIRSYNC(dir))
+		err = write_one_page(page);
+	else
+		unlock_page(page);
+	return err;
+}
+
+static struct page *dir_get_page(struct inode *dir, unsigned long n)
+{
+	struct address_space *mapping = dir->i_mapping;
+	struct page *page = read_mapping_page(mapping, n, NULL);
+
+	if (!IS_ERR(page))
+		kmap(page);
+	return page;
+}
+
+static inline void *minix_next_entry(void *de, struct minix_sb_info *sbi)
+{
+	return (void *)((char *)de + sbi->s_dirsize);
+}
+
+static inline int namecompare(int len, int maxlen,
+			const char *name, const char *buffer)
+{
+	if (len < maxlen && buffer[len])
+		return 0;
+	return !memcmp(name, buffer, len);
+}
+
+static inline u32 minix_name_hash(const char *name, int len)
+{
+	return full_name_hash(NULL, name, len);
+}
+
+static inline u32 minix_entry_hash(minix_dirent *de, struct minix_sb_info *sbi)
+{
+	return minix_name_hash(de->name, strnlen(de->name, sbi->s_namelen));
+}
+
+static inline struct hlist_head *minix_index_bucket(
+			struct minix_dir_index *idx, u32 hash)
+{
+	return &idx->buckets[hash_32(hash, idx->bits)];
+}
+
+static struct hlist_head *minix_index_alloc_buckets(unsigned int bits)
+{
+	struct hlist_head *buckets;
+	unsigned int nofs;
+
+	/* Called with the directory locked: keep reclaim out of the fs */
+	nofs = memalloc_nofs_save();
+	buckets = kvcalloc(1UL << bits, sizeof(*buckets), GFP_KERNEL);
+	memalloc_nofs_restore(nofs);
+	return buckets;
+}
+
+static void minix_index_destroy(struct minix_dir_index *idx)
+{
+	struct minix_dir_slot *slot;
+	struct hlist_node *tmp;
+	unsigned long i;
+
+	if (idx->buckets) {
+		for (i = 0; i < (1UL << idx->bits); i++)
+			hlist_for_each_entry_safe(slot, tmp,
+						&idx->buckets[i], node)
+				kfree(slot);
+		kvfree(idx->buckets);
+	}
+	kfree(idx);
+}
+
+/* Double the table once chains average more than two slots */
+static void minix_index_grow(struct minix_dir_index *idx)
+{
+	unsigned int bits = idx->bits + 1;
+	struct hlist_head *buckets;
+	struct minix_dir_slot *slot;
+	struct hlist_node *tmp;
+	unsigned long i;
+
+	buckets = minix_index_alloc_buckets(bits);
+	if (!buckets)
+		return;		/* live with longer chains */
+	for (i = 0; i < (1UL << idx->bits); i++)
+		hlist_for_each_entry_safe(slot, tmp, &idx->buckets[i], node)
+			hlist_add_head(&slot->node,
+					&buckets[hash_32(slot->hash, bits)]);
+	kvfree(idx->buckets);
+	idx->buckets = buckets;
+	idx->bits = bits;
+}
+
+static int minix_index_insert(struct minix_dir_index *idx, u32 hash,
+								loff_t pos)
+{
+	struct minix_dir_slot *slot;
+
+	slot = kmalloc(sizeof(*slot), GFP_NOFS);
+	if (!slot)
+		return -ENOMEM;
+	slot->hash = hash;
+	slot->pos = pos;
+	hlist_add_head(&slot->node, minix_index_bucket(idx, hash));
+	if (++idx->nr > (2UL << idx->bits))
+		minix_index_grow(idx);
+	return 0;
+}
+
+static void minix_index_remove(struct minix_dir_index *idx, u32 hash,
+								loff_t pos)
+{
+	struct minix_dir_slot *slot;
+
+	hlist_for_each_entry(slot, minix_index_bucket(idx, hash), node) {
+		if (slot->pos == pos) {
+			hlist_del(&slot->node);
+			kfree(slot);
+			idx->nr--;
+			break;
+		}
+	}
+	if (pos < idx->free_hint)
+		idx->free_hint = pos;
+}
+
+static minix_dirent *minix_index_find(struct inode *dir,
+			struct minix_dir_index *idx, const char *name,
+			int namelen, struct page **res_page)
+{
+	struct minix_sb_info *sbi = minix_sb_bs(dir->i_sb);
+	u32 hash = minix_name_hash(name, namelen);
+	struct minix_dir_slot *slot;
+
+	hlist_for_each_entry(slot, minix_index_bucket(idx, hash), node) {
+		struct page *page;
+		minix_dirent *de;
+
+		if (slot->hash != hash)
+			continue;
+		page = dir_get_page(dir, slot->pos >> PAGE_SHIFT);
+		if (IS_ERR(page))
+			continue;
+		de = page_address(page) + (slot->pos & ~PAGE_MASK);
+		if (de->inode &&
+		    namecompare(namelen, sbi->s_namelen, name, de->name)) {
+			*res_page = page;
+			return de;
+		}
+		dir_put_page(page);
+	}
+	return NULL;
+}
+
+static struct minix_dir_index *minix_index_build(struct inode *dir)
+{
+	struct minix_sb_info *sbi = minix_sb_bs(dir->i_sb);
+	unsigned long npages = dir_pages(dir);
+	unsigned long entries = npages * (PAGE_SIZE / sbi->s_dirsize);
+	struct minix_dir_index *idx;
+	unsigned long n;
+
+	idx = kzalloc(sizeof(*idx), GFP_NOFS);
+	if (!idx)
+		return NULL;
+	idx->bits = max_t(unsigned int, ilog2(entries),
+					MINIX_DIR_INDEX_MIN_BITS);
+	idx->free_hint = dir->i_size;
+	idx->buckets = minix_index_alloc_buckets(idx->bits);
+	if (!idx->buckets)
+		goto fail;
+
+	for (n = 0; n < npages; n++) {
+		char *kaddr, *limit, *p;
+		struct page *page = dir_get_page(dir, n);
+
+		/* A hole in the index would turn into a false ENOENT */
+		if (IS_ERR(page))
+			goto fail;
+		kaddr = (char *)page_address(page);
+		limit = kaddr + minix_last_byte(dir, n) - sbi->s_dirsize;
+		for (p = kaddr; p <= limit; p = minix_next_entry(p, sbi)) {
+			minix_dirent *de = (minix_dirent *)p;
+			loff_t pos = page_offset(page) + (p - kaddr);
+
+			if (!de->inode) {
+				if (pos < idx->free_hint)
+					idx->free_hint = pos;
+				continue;
+			}
+			if (minix_index_insert(idx,
+					minix_entry_hash(de, sbi), pos)) {
+				dir_put_page(page);
+				goto fail;
+			}
+		}
+		dir_put_page(page);
+	}
+	return idx;
+
+fail:
+	minix_index_destroy(idx);
+	return NULL;
+}
+
+/*
+ * Index of @dir, building it if the directory is large enough. NULL
+ * means "scan linearly", either because the directory is small or
+ * because the index could not be built.
+ */
+static struct minix_dir_index *minix_dir_index(struct inode *dir)
+{
+	struct minix_inode_info *mi = minix_i_bs(dir);
+	struct minix_dir_index *idx, *old;
+
+	idx = READ_ONCE(mi->i_dir_index);
+	if (idx || dir_pages(dir) < MINIX_DIR_INDEX_PAGES)
+		return idx;
+
+	idx = minix_index_build(dir);
+	if (!idx)
+		return NULL;
+	/* Parallel lookups may race to build it; the first one wins */
+	old = cmpxchg(&mi->i_dir_index, NULL, idx);
+	if (old) {
+		minix_index_destroy(idx);
+		idx = old;
+	}
+	return idx;
+}
+
+void minix_dir_index_drop_bs(struct inode *dir)
+{
+	struct minix_dir_index *idx = xchg(&minix_i_bs(dir)->i_dir_index, NULL);
+
+	if (idx)
+		minix_index_destroy(idx);
+}
+
 static int minix_readdir_bs(struct file *file, struct dir_context *ctx)
 {
-	BS_DUP();
+	struct inode *inode = file_inode(file);
+	struct super_block *sb = inode->i_sb;
+	struct minix_sb_info *sbi = minix_sb_bs(sb);
+	unsigned chunk_size = sbi->s_dirsize;
+	unsigned long npages = dir_pages(inode);
+	unsigned long pos = ctx->pos;
+	unsigned offset;
+	unsigned long n;
+
+	ctx->pos = pos = ALIGN(pos, chunk_size);
+	if (pos >= inode->i_size)
+		return 0;
+
+	offset = pos & ~PAGE_MASK;
+	n = pos >> PAGE_SHIFT;
+
+	for ( ; n < npages; n++, offset = 0) {
+		char *p, *kaddr, *limit;
+		struct page *page = dir_get_page(inode, n);
+
+		if (IS_ERR(page))
+			continue;
+		kaddr = (char *)page_address(page);
+		p = kaddr + offset;
+		limit = kaddr + minix_last_byte(inode, n) - chunk_size;
+		for ( ; p <= limit; p = minix_next_entry(p, sbi)) {
+			minix_dirent *de = (minix_dirent *)p;
+
+			if (de->inode) {
+				unsigned l = strnlen(de->name, sbi->s_namelen);
+
+				if (!dir_emit(ctx, de->name, l,
+						de->inode, DT_UNKNOWN)) {
+					dir_put_page(page);
+					return 0;
+				}
+			}
+			ctx->pos += chunk_size;
+		}
+		dir_put_page(page);
+	}
+	return 0;
+}
+
+minix_dirent *minix_find_entry_bs(struct dentry *dentry,
+					struct page **res_page)
+{
+	const char *name = dentry->d_name.name;
+	int namelen = dentry->d_name.len;
+	struct inode *dir = d_inode(dentry->d_parent);
+	struct minix_sb_info *sbi = minix_sb_bs(dir->i_sb);
+	struct minix_dir_index *idx;
+	unsigned long npages = dir_pages(dir);
+	struct page *page = NULL;
+	unsigned long n;
+	char *p;
+
+	*res_page = NULL;
+
+	idx = minix_dir_index(dir);
+	if (idx)
+		return minix_index_find(dir, idx, name, namelen, res_page);
+
+	for (n = 0; n < npages; n++) {
+		char *kaddr, *limit;
+
+		page = dir_get_page(dir, n);
+		if (IS_ERR(page))
+			continue;
+
+		kaddr = (char *)page_address(page);
+		limit = kaddr + minix_last_byte(dir, n) - sbi->s_dirsize;
+		for (p = kaddr; p <= limit; p = minix_next_entry(p, sbi)) {
+			minix_dirent *de = (minix_dirent *)p;
+
+			if (!de->inode)
+				continue;
+			if (namecompare(namelen, sbi->s_namelen,
+							name, de->name))
+				goto found;
+		}
+		dir_put_page(page);
+	}
+	return NULL;
+
+found:
+	*res_page = page;
+	return (minix_dirent *)p;
+}
+
+int minix_add_link_bs(struct dentry *dentry, struct inode *inode)
+{
+	struct inode *dir = d_inode(dentry->d_parent);
+	const char *name = dentry->d_name.name;
+	int namelen = dentry->d_name.len;
+	struct minix_sb_info *sbi = minix_sb_bs(dir->i_sb);
+	struct minix_dir_index *idx;
+	struct page *page = NULL;
+	unsigned long npages = dir_pages(dir);
+	unsigned long n;
+	unsigned offset = 0;
+	char *kaddr, *p;
+	minix_dirent *de;
+	loff_t pos;
+	u32 hash = 0;
+	int err;
+
+	/*
+	 * With an index the name check is a hash probe and the search
+	 * for a free dirent starts at the first known hole, so adding
+	 * to a big directory no longer reads every page of it.
+	 */
+	idx = minix_dir_index(dir);
+	if (idx) {
+		hash = minix_name_hash(name, namelen);
+		de = minix_index_find(dir, idx, name, namelen, &page);
+		if (de) {
+			dir_put_page(page);
+			return -EEXIST;
+		}
+		n = idx->free_hint >> PAGE_SHIFT;
+		offset = idx->free_hint & ~PAGE_MASK;
+	} else
+		n = 0;
+
+	/*
+	 * We take care of directory expansion in the same loop
+	 * This code plays outside i_size, so it locks the page
+	 * to protect that region.
+	 */
+	for ( ; n <= npages; n++, offset = 0) {
+		char *limit, *dir_end;
+
+		page = dir_get_page(dir, n);
+		err = PTR_ERR(page);
+		if (IS_ERR(page))
+			goto out;
+		lock_page(page);
+		kaddr = (char *)page_address(page);
+		dir_end = kaddr + minix_last_byte(dir, n);
+		limit = kaddr + PAGE_SIZE - sbi->s_dirsize;
+		for (p = kaddr + offset; p <= limit;
+					p = minix_next_entry(p, sbi)) {
+			de = (minix_dirent *)p;
+			if (p == dir_end) {
+				/* We hit i_size */
+				de->inode = 0;
+				goto got_it;
+			}
+			if (!de->inode)
+				goto got_it;
+			err = -EEXIST;
+			if (!idx && namecompare(namelen, sbi->s_namelen,
+							name, de->name))
+				goto out_unlock;
+		}
+		unlock_page(page);
+		dir_put_page(page);
+	}
+	BUG();
+	return -EINVAL;
+
+got_it:
+	pos = page_offset(page) + p - (char *)page_address(page);
+	err = minix_prepare_chunk_bs(page, pos, sbi->s_dirsize);
+	if (err)
+		goto out_unlock;
+	memcpy(de->name, name, namelen);
+	memset(de->name + namelen, 0, sbi->s_dirsize - namelen - 2);
+	de->inode = inode->i_ino;
+	err = dir_commit_chunk(page, pos, sbi->s_dirsize);
+	if (idx) {
+		idx->free_hint = pos + sbi->s_dirsize;
+		if (minix_index_insert(idx, hash, pos))
+			minix_dir_index_drop_bs(dir);
+	}
+	dir->i_mtime = dir->i_ctime = current_time(dir);
+	mark_inode_dirty(dir);
+out_put:
+	dir_put_page(page);
+out:
+	return err;
+out_unlock:
+	unlock_page(page);
+	goto out_put;
+}
+
+int minix_delete_entry_bs(struct minix_dir_entry *de, struct page *page)
+{
+	struct inode *inode = page->mapping->host;
+	struct minix_dir_index *idx = READ_ONCE(minix_i_bs(inode)->i_dir_index);
+	char *kaddr = page_address(page);
+	loff_t pos = page_offset(page) + (char *)de - kaddr;
+	struct minix_sb_info *sbi = minix_sb_bs(inode->i_sb);
+	unsigned len = sbi->s_dirsize;
+	u32 hash = minix_entry_hash(de, sbi);
+	int err;
+
+	lock_page(page);
+	err = minix_prepare_chunk_bs(page, pos, len);
+	if (err == 0) {
+		de->inode = 0;
+		err = dir_commit_chunk(page, pos, len);
+		if (idx)
+			minix_index_remove(idx, hash, pos);
+	} else {
+		unlock_page(page);
+	}
+	dir_put_page(page);
+	inode->i_ctime = inode->i_mtime = current_time(inode);
+	mark_inode_dirty(inode);
+	return err;
+}
+
+int minix_make_empty_bs(struct inode *inode, struct inode *dir)
+{
+	struct page *page = grab_cache_page(inode->i_mapping, 0);
+	struct minix_sb_info *sbi = minix_sb_bs(inode->i_sb);
+	minix_dirent *de;
+	char *kaddr;
+	int err;
+
+	if (!page)
+		return -ENOMEM;
+	err = minix_prepare_chunk_bs(page, 0, 2 * sbi->s_dirsize);
+	if (err) {
+		unlock_page(page);
+		goto fail;
+	}
+
+	kaddr = kmap_atomic(page);
+	memset(kaddr, 0, PAGE_SIZE);
+
+	de = (minix_dirent *)kaddr;
+	de->inode = inode->i_ino;
+	strcpy(de->name, ".");
+	de = minix_next_entry(de, sbi);
+	de->inode = dir->i_ino;
+	strcpy(de->name, "..");
+	kunmap_atomic(kaddr);
+
+	err = dir_commit_chunk(page, 0, 2 * sbi->s_dirsize);
+fail:
+	put_page(page);
+	return err;
+}
+
+/*
+ * routine to check that the specified directory is empty (for rmdir)
+ */
+int minix_empty_dir_bs(struct inode *inode)
+{
+	struct page *page = NULL;
+	unsigned long i, npages = dir_pages(inode);
+	struct minix_sb_info *sbi = minix_sb_bs(inode->i_sb);
+
+	for (i = 0; i < npages; i++) {
+		char *p, *kaddr, *limit;
+
+		page = dir_get_page(inode, i);
+		if (IS_ERR(page))
+			continue;
+
+		kaddr = (char *)page_address(page);
+		limit = kaddr + minix_last_byte(inode, i) - sbi->s_dirsize;
+		for (p = kaddr; p <= limit; p = minix_next_entry(p, sbi)) {
+			minix_dirent *de = (minix_dirent *)p;
+
+			if (de->inode != 0) {
+				/* check for . and .. */
+				if (de->name[0] != '.')
+					goto not_empty;
+				if (!de->name[1]) {
+					if (de->inode != inode->i_ino)
+						goto not_empty;
+				} else if (de->name[1] != '.')
+					goto not_empty;
+				else if (de->name[2])
+					goto not_empty;
+			}
+		}
+		dir_put_page(page);
+	}
+	return 1;
+
+not_empty:
+	dir_put_page(page);
 	return 0;
 }
 
+/* Releases the page */
+void minix_set_link_bs(struct minix_dir_entry *de, struct page *page,
+					struct inode *inode)
+{
+	struct inode *dir = page->mapping->host;
+	struct minix_sb_info *sbi = minix_sb_bs(dir->i_sb);
+	loff_t pos = page_offset(page) +
+			(char *)de - (char *)page_address(page);
+	int err;
+
+	/* The name stays where it is, so the index needs no update */
+	lock_page(page);
+	err = minix_prepare_chunk_bs(page, pos, sbi->s_dirsize);
+	if (err == 0) {
+		de->inode = inode->i_ino;
+		err = dir_commit_chunk(page, pos, sbi->s_dirsize);
+	} else {
+		unlock_page(page);
+	}
+	dir_put_page(page);
+	dir->i_mtime = dir->i_ctime = current_time(dir);
+	mark_inode_dirty(dir);
+}
+
+struct minix_dir_entry *minix_dotdot_bs(struct inode *dir, struct page **p)
+{
+	struct page *page = dir_get_page(dir, 0);
+	struct minix_sb_info *sbi = minix_sb_bs(dir->i_sb);
+	struct minix_dir_entry *de = NULL;
+
+	if (!IS_ERR(page)) {
+		de = minix_next_entry(page_address(page), sbi);
+		*p = page;
+	}
+	return de;
+}
+
+ino_t minix_inode_by_name_bs(struct dentry *dentry)
+{
+	struct page *page;
+	struct minix_dir_entry *de = minix_find_entry_bs(dentry, &page);
+	ino_t res = 0;
+
+	if (de) {
+		res = de->inode;
+		dir_put_page(page);
+	}
+	return res;
+}
+
 const struct file_operations minix_dir_operations_bs = {
 	.llseek		= generic_file_llseek,
 	.read		= generic_read_dir,
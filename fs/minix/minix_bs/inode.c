@@ -13,6 +13,8 @@
 #include <linux/fs.h>
 #include <uapi/linux/minix_fs.h>
 #include <linux/buffer_head.h>
+#include <linux/mpage.h>
+#include <linux/writeback.h>
 #include <linux/module.h>
 
 #include "internal.h"
@@ -21,37 +23,66 @@ static struct kmem_cache *minix_inode_cachep_bs;
 
 
 static int minix_mknod_bs(struct inode *dir, struct dentry *dentry,
-					umode_t mode, dev_t rdev)
-{
-	BS_DUP();
-	return 0;
-}
+					umode_t mode, dev_t rdev);
 
-static int minix_create_bs(struct inode *dir, struct dentry *dentry,
-					umode_t mode, bool excl)
+static int add_nondir_bs(struct dentry *dentry, struct inode *inode)
 {
-	BS_DUP();
-	return 0;
+	int err = minix_add_link_bs(dentry, inode);
+
+	if (!err) {
+		d_instantiate(dentry, inode);
+		return 0;
+	}
+	inode_dec_link_count(inode);
+	iput(inode);
+	return err;
 }
 
 static struct dentry *minix_lookup_bs(struct inode *dir, 
 		struct dentry *dentry, unsigned int flags)
 {
-	BS_DUP();
-	return NULL;
+	struct inode *inode = NULL;
+	ino_t ino;
+
+	if (dentry->d_name.len > minix_sb_bs(dir->i_sb)->s_namelen)
+		return ERR_PTR(-ENAMETOOLONG);
+
+	ino = minix_inode_by_name_bs(dentry);
+	if (ino)
+		inode = minix_iget_bs(dir->i_sb, ino);
+	return d_splice_alias(inode, dentry);
 }
 
 static int minix_link_bs(struct dentry *old_dentry, struct inode *dir,
 		struct dentry *dentry)
 {
-	BS_DUP();
-	return 0;
+	struct inode *inode = d_inode(old_dentry);
+
+	inode->i_ctime = current_time(inode);
+	inode_inc_link_count(inode);
+	ihold(inode);
+	return add_nondir_bs(dentry, inode);
 }
 
 static int minix_unlink_bs(struct inode *dir, struct dentry *dentry)
 {
-	BS_DUP();
-	return 0;
+	int err = -ENOENT;
+	struct inode *inode = d_inode(dentry);
+	struct page *page;
+	struct minix_dir_entry *de;
+
+	de = minix_find_entry_bs(dentry, &page);
+	if (!de)
+		goto end_unlink;
+
+	err = minix_delete_entry_bs(de, page);
+	if (err)
+		goto end_unlink;
+
+	inode->i_ctime = dir->i_ctime;
+	inode_dec_link_count(inode);
+end_unlink:
+	return err;
 }
 
 static int minix_symlink_bs(struct inode *dir, struct dentry *dentry,
@@ -64,62 +95,264 @@ static int minix_symlink_bs(struct inode *dir, struct dentry *dentry,
 static int minix_mkdir_bs(struct inode *dir, struct dentry *dentry,
 							umode_t mode)
 {
-	BS_DUP();
-	return 0;
+	struct inode *inode;
+	int err;
+
+	inode_inc_link_count(dir);
+
+	inode = minix_new_inode_bs(dir, S_IFDIR | mode, &err);
+	if (!inode)
+		goto out_dir;
+
+	minix_set_inode_bs(inode, 0);
+
+	inode_inc_link_count(inode);
+
+	err = minix_make_empty_bs(inode, dir);
+	if (err)
+		goto out_fail;
+
+	err = minix_add_link_bs(dentry, inode);
+	if (err)
+		goto out_fail;
+
+	d_instantiate(dentry, inode);
+out:
+	return err;
+
+out_fail:
+	inode_dec_link_count(inode);
+	inode_dec_link_count(inode);
+	iput(inode);
+out_dir:
+	inode_dec_link_count(dir);
+	goto out;
 }
 
 static int minix_rmdir_bs(struct inode *dir, struct dentry *dentry)
 {
-	BS_DUP();
-	return 0;
+	struct inode *inode = d_inode(dentry);
+	int err = -ENOTEMPTY;
+
+	if (minix_empty_dir_bs(inode)) {
+		err = minix_unlink_bs(dir, dentry);
+		if (!err) {
+			inode_dec_link_count(dir);
+			inode_dec_link_count(inode);
+		}
+	}
+	return err;
 }
 
 static int minix_rename_bs(struct inode *old_dir, struct dentry *old_dentry,
 			struct inode *new_dir, struct dentry *new_dentry,
 			unsigned int flags)
 {
-	BS_DUP();
+	struct inode *old_inode = d_inode(old_dentry);
+	struct inode *new_inode = d_inode(new_dentry);
+	struct page *dir_page = NULL;
+	struct minix_dir_entry *dir_de = NULL;
+	struct page *old_page;
+	struct minix_dir_entry *old_de;
+	int err = -ENOENT;
+
+	if (flags & ~RENAME_NOREPLACE)
+		return -EINVAL;
+
+	old_de = minix_find_entry_bs(old_dentry, &old_page);
+	if (!old_de)
+		goto out;
+
+	if (S_ISDIR(old_inode->i_mode)) {
+		err = -EIO;
+		dir_de = minix_dotdot_bs(old_inode, &dir_page);
+		if (!dir_de)
+			goto out_old;
+	}
+
+	if (new_inode) {
+		struct page *new_page;
+		struct minix_dir_entry *new_de;
+
+		err = -ENOTEMPTY;
+		if (dir_de && !minix_empty_dir_bs(new_inode))
+			goto out_dir;
+
+		err = -ENOENT;
+		new_de = minix_find_entry_bs(new_dentry, &new_page);
+		if (!new_de)
+			goto out_dir;
+		minix_set_link_bs(new_de, new_page, old_inode);
+		new_inode->i_ctime = current_time(new_inode);
+		if (dir_de)
+			drop_nlink(new_inode);
+		inode_dec_link_count(new_inode);
+	} else {
+		err = minix_add_link_bs(new_dentry, old_inode);
+		if (err)
+			goto out_dir;
+		if (dir_de)
+			inode_inc_link_count(new_dir);
+	}
+
+	minix_delete_entry_bs(old_de, old_page);
+	mark_inode_dirty(old_inode);
+
+	if (dir_de) {
+		minix_set_link_bs(dir_de, dir_page, new_dir);
+		inode_dec_link_count(old_dir);
+	}
 	return 0;
+
+out_dir:
+	if (dir_de) {
+		kunmap(dir_page);
+		put_page(dir_page);
+	}
+out_old:
+	kunmap(old_page);
+	put_page(old_page);
+out:
+	return err;
 }
 
 int minix_getattr_bs(const struct path *path, struct kstat *stat,
 			u32 request_mask, unsigned int flags)
 {
-	BS_DUP();
+	struct super_block *sb = path->dentry->d_sb;
+	struct inode *inode = d_inode(path->dentry);
+
+	generic_fillattr(inode, stat);
+	if (INODE_VERSION(inode) == MINIX_V1_BS)
+		stat->blocks = (BLOCK_SIZE / 512) *
+					V1_minix_blocks_bs(stat->size, sb);
+	else
+		stat->blocks = (sb->s_blocksize / 512) *
+					V2_minix_blocks_bs(stat->size, sb);
+	stat->blksize = sb->s_blocksize;
 	return 0;
 }
 
+static int minix_mknod_bs(struct inode *dir, struct dentry *dentry,
+					umode_t mode, dev_t rdev)
+{
+	int error;
+	struct inode *inode;
+
+	if (!old_valid_dev(rdev))
+		return -EINVAL;
+
+	inode = minix_new_inode_bs(dir, mode, &error);
+
+	if (inode) {
+		minix_set_inode_bs(inode, rdev);
+		mark_inode_dirty(inode);
+		error = add_nondir_bs(dentry, inode);
+	}
+	return error;
+}
+
+static int minix_create_bs(struct inode *dir, struct dentry *dentry,
+					umode_t mode, bool excl)
+{
+	return minix_mknod_bs(dir, dentry, mode, 0);
+}
+
 static int minix_tmpfile_bs(struct inode *dir, struct dentry *dentry,
 							umode_t mode)
 {
-	BS_DUP();
-	return 0;
+	int error;
+	struct inode *inode = minix_new_inode_bs(dir, mode, &error);
+
+	if (inode) {
+		minix_set_inode_bs(inode, 0);
+		mark_inode_dirty(inode);
+		d_tmpfile(dentry, inode);
+	}
+	return error;
+}
+
+/*
+ * Maps as many contiguous blocks as bh_result->b_size asks for, so
+ * the mpage paths below send one bio per on-disk extent instead of
+ * one buffer_head per block.
+ */
+static int minix_get_block_bs(struct inode *inode, sector_t block,
+			struct buffer_head *bh_result, int create)
+{
+	if (INODE_VERSION(inode) == MINIX_V1_BS)
+		return V1_minix_get_block_bs(inode, block, bh_result, create);
+	else
+		return V2_minix_get_block_bs(inode, block, bh_result, create);
 }
 
 static int minix_readpage_bs(struct file *file, struct page *page)
 {
-	BS_DUP();
-	return 0;
+	return mpage_readpage(page, minix_get_block_bs);
+}
+
+static int minix_readpages_bs(struct file *file,
+		struct address_space *mapping, struct list_head *pages,
+		unsigned nr_pages)
+{
+	return mpage_readpages(mapping, pages, nr_pages, minix_get_block_bs);
 }
 
 static int minix_writepage_bs(struct page *page, struct writeback_control *wbc)
 {
-	BS_DUP();
-	return 0;
+	return block_write_full_page(page, minix_get_block_bs, wbc);
+}
+
+static int minix_writepages_bs(struct address_space *mapping,
+				struct writeback_control *wbc)
+{
+	return mpage_writepages(mapping, wbc, minix_get_block_bs);
+}
+
+void minix_truncate_bs(struct inode *inode)
+{
+	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) ||
+	      S_ISLNK(inode->i_mode)))
+		return;
+	minix_discard_prealloc_bs(inode);
+	if (INODE_VERSION(inode) == MINIX_V1_BS)
+		V1_minix_truncate_bs(inode);
+	else
+		V2_minix_truncate_bs(inode);
+}
+
+static void minix_write_failed_bs(struct address_space *mapping, loff_t to)
+{
+	struct inode *inode = mapping->host;
+
+	if (to > inode->i_size) {
+		truncate_pagecache(inode, inode->i_size);
+		minix_truncate_bs(inode);
+	}
 }
 
 static int minix_write_begin_bs(struct file *file, 
 		struct address_space *mapping, loff_t pos, unsigned len,
 		unsigned flags, struct page **pagep, void **fsdata)
 {
-	BS_DUP();
-	return 0;
+	int ret;
+
+	ret = block_write_begin(mapping, pos, len, flags, pagep,
+				minix_get_block_bs);
+	if (unlikely(ret))
+		minix_write_failed_bs(mapping, pos + len);
+
+	return ret;
+}
+
+int minix_prepare_chunk_bs(struct page *page, loff_t pos, unsigned len)
+{
+	return __block_write_begin(page, pos, len, minix_get_block_bs);
 }
 
 static sector_t minix_bmap_bs(struct address_space *mapping, sector_t block)
 {
-	BS_DUP();
-	return 0;
+	return generic_block_bmap(mapping, block, minix_get_block_bs);
 }
 
 /*
@@ -141,7 +374,9 @@ const struct inode_operations minix_dir_inode_operations_bs = {
 
 static const struct address_space_operations minix_aops_bs = {
 	.readpage	= minix_readpage_bs,
+	.readpages	= minix_readpages_bs,
 	.writepage	= minix_writepage_bs,
+	.writepages	= minix_writepages_bs,
 	.write_begin	= minix_write_begin_bs,
 	.write_end	= generic_write_end,
 	.bmap		= minix_bmap_bs,
@@ -176,7 +411,9 @@ static int __init init_inodecache_bs(void)
 void minix_set_inode_bs(struct inode *inode, dev_t rdev)
 {
 	if (S_ISREG(inode->i_mode)) {
-		BS_DUP();
+		inode->i_op = &minix_file_inode_operations_bs;
+		inode->i_fop = &minix_file_operations_bs;
+		inode->i_mapping->a_ops = &minix_aops_bs;
 	} else if (S_ISDIR(inode->i_mode)) {
 		inode->i_op = &minix_dir_inode_operations_bs;
 		inode->i_fop = &minix_dir_operations_bs;
@@ -184,7 +421,7 @@ void minix_set_inode_bs(struct inode *inode, dev_t rdev)
 	} else if (S_ISLNK(inode->i_mode)) {
 		BS_DUP();
 	} else
-		BS_DUP();
+		init_special_inode(inode, inode->i_mode, rdev);
 }
 
 /*
@@ -205,7 +442,7 @@ static struct inode *V1_minix_iget_bs(struct inode *inode)
 	inode->i_mode = raw_inode->i_mode;
 	i_uid_write(inode, raw_inode->i_uid);
 	i_gid_write(inode, raw_inode->i_gid);
-	set_nlink(inode, raw_inode->i_size);
+	set_nlink(inode, raw_inode->i_nlinks);
 	inode->i_size = raw_inode->i_size;
 	inode->i_mtime.tv_sec = inode->i_atime.tv_sec =
 				inode->i_ctime.tv_sec = raw_inode->i_time;
@@ -282,6 +519,9 @@ static struct inode *minix_alloc_inode_bs(struct super_block *sb)
 	ei = kmem_cache_alloc(minix_inode_cachep_bs, GFP_KERNEL);
 	if (!ei)
 		return NULL;
+	ei->i_dir_index = NULL;
+	ei->i_alloc_goal = 0;
+	ei->i_prealloc_count = 0;
 	return &ei->vfs_inode;
 }
 
@@ -290,16 +530,99 @@ static void minix_destroy_inode_bs(struct inode *inode)
 	BS_DUP();
 }
 
+/*
+ * The minix V1 function to synchronize an inode.
+ */
+static struct buffer_head *V1_minix_update_inode_bs(struct inode *inode)
+{
+	struct buffer_head *bh;
+	struct minix_inode *raw_inode;
+	struct minix_inode_info *minix_inode = minix_i_bs(inode);
+	int i;
+
+	raw_inode = minix_V1_raw_inode_bs(inode->i_sb, inode->i_ino, &bh);
+	if (!raw_inode)
+		return NULL;
+	raw_inode->i_mode = inode->i_mode;
+	raw_inode->i_uid = fs_high2lowuid(i_uid_read(inode));
+	raw_inode->i_gid = fs_high2lowgid(i_gid_read(inode));
+	raw_inode->i_nlinks = inode->i_nlink;
+	raw_inode->i_size = inode->i_size;
+	raw_inode->i_time = inode->i_mtime.tv_sec;
+	if (S_ISCHR(inode->i_mode) || S_ISBLK(inode->i_mode))
+		raw_inode->i_zone[0] = old_encode_dev(inode->i_rdev);
+	else for (i = 0; i < 9; i++)
+		raw_inode->i_zone[i] = minix_inode->u.i1_data[i];
+	mark_buffer_dirty(bh);
+	return bh;
+}
+
+/*
+ * The minix V2 function to synchronize an inode.
+ */
+static struct buffer_head *V2_minix_update_inode_bs(struct inode *inode)
+{
+	struct buffer_head *bh;
+	struct minix2_inode *raw_inode;
+	struct minix_inode_info *minix_inode = minix_i_bs(inode);
+	int i;
+
+	raw_inode = minix_V2_raw_inode_bs(inode->i_sb, inode->i_ino, &bh);
+	if (!raw_inode)
+		return NULL;
+	raw_inode->i_mode = inode->i_mode;
+	raw_inode->i_uid = fs_high2lowuid(i_uid_read(inode));
+	raw_inode->i_gid = fs_high2lowgid(i_gid_read(inode));
+	raw_inode->i_nlinks = inode->i_nlink;
+	raw_inode->i_size = inode->i_size;
+	raw_inode->i_mtime = inode->i_mtime.tv_sec;
+	raw_inode->i_atime = inode->i_atime.tv_sec;
+	raw_inode->i_ctime = inode->i_ctime.tv_sec;
+	if (S_ISCHR(inode->i_mode) || S_ISBLK(inode->i_mode))
+		raw_inode->i_zone[0] = old_encode_dev(inode->i_rdev);
+	else for (i = 0; i < 10; i++)
+		raw_inode->i_zone[i] = minix_inode->u.i2_data[i];
+	mark_buffer_dirty(bh);
+	return bh;
+}
+
 static int minix_write_inode_bs(struct inode *inode, 
 					struct writeback_control *wbc)
 {
-	BS_DUP();
-	return 0;
+	int err = 0;
+	struct buffer_head *bh;
+
+	if (INODE_VERSION(inode) == MINIX_V1_BS)
+		bh = V1_minix_update_inode_bs(inode);
+	else
+		bh = V2_minix_update_inode_bs(inode);
+	if (!bh)
+		return -EIO;
+	if (wbc->sync_mode == WB_SYNC_ALL && buffer_dirty(bh)) {
+		sync_dirty_buffer(bh);
+		if (buffer_req(bh) && !buffer_uptodate(bh)) {
+			printk("IO error syncing minix inode [%s:%08lx]\n",
+				inode->i_sb->s_id, inode->i_ino);
+			err = -EIO;
+		}
+	}
+	brelse(bh);
+	return err;
 }
 
 static void minix_evict_inode_bs(struct inode *inode)
 {
-	BS_DUP();
+	truncate_inode_pages_final(&inode->i_data);
+	if (!inode->i_nlink) {
+		inode->i_size = 0;
+		minix_truncate_bs(inode);
+	}
+	minix_discard_prealloc_bs(inode);
+	invalidate_inode_buffers(inode);
+	clear_inode(inode);
+	minix_dir_index_drop_bs(inode);
+	if (!inode->i_nlink)
+		minix_free_inode_bs(inode);
 }
 
 static void minix_put_super_bs(struct super_block *sb)
@@ -364,6 +687,7 @@ static int minix_fill_super_bs(struct super_block *s, void *data, int silent)
 	sbi->s_firstdatazone = ms->s_firstdatazone;
 	sbi->s_log_zone_size = ms->s_log_zone_size;
 	sbi->s_max_size = ms->s_max_size;
+	s->s_maxbytes = sbi->s_max_size;
 	s->s_magic = ms->s_magic;
 	if (s->s_magic == MINIX_SUPER_MAGIC) {
 		sbi->s_version = MINIX_V1_BS;
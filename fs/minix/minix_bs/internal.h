@@ -6,6 +6,9 @@
 #define MINIX_V2_BS		0x0002		/* minix V2 fs */
 #define MINIX_V3_BS		0x0003		/* minix V3 fs */
 
+struct minix_dir_index;
+struct minix_dir_entry;
+
 /*
  * minix fs inode data in memory
  */
@@ -14,6 +17,10 @@ struct minix_inode_info {
 		__u16 i1_data[16];
 		__u32 i2_data[16];
 	} u;
+	struct minix_dir_index *i_dir_index;	/* directories only, see dir.c */
+	unsigned long i_alloc_goal;		/* first block goes near here */
+	unsigned long i_prealloc_block;		/* next reserved block */
+	unsigned int i_prealloc_count;		/* reserved blocks left */
 	struct inode vfs_inode;
 };
 
@@ -40,6 +47,10 @@ struct minix_sb_info {
 
 #define minix_set_bit_bs(nr, addr)				\
 	__set_bit((nr), (unsigned long *)(addr))
+#define minix_test_and_clear_bit_bs(nr, addr)			\
+	__test_and_clear_bit((nr), (unsigned long *)(addr))
+#define minix_find_first_zero_bit_bs(addr, size)		\
+	find_first_zero_bit((unsigned long *)(addr), (size))
 
 static inline unsigned minix_blocks_needed_bs(unsigned bits, 
 							unsigned blocksize)
@@ -63,6 +74,45 @@ extern void mark_buffer_dirty(struct buffer_head *bh);
 extern struct minix2_inode *minix_V2_raw_inode_bs(struct super_block *sb,
 				ino_t ino, struct buffer_head **bh);
 extern const struct file_operations minix_dir_operations_bs;
+extern const struct file_operations minix_file_operations_bs;
+extern const struct inode_operations minix_file_inode_operations_bs;
+
+extern int minix_new_block_bs(struct inode *inode, unsigned long goal);
+extern void minix_discard_prealloc_bs(struct inode *inode);
+extern struct inode *minix_new_inode_bs(const struct inode *dir,
+			umode_t mode, int *error);
+extern void minix_free_inode_bs(struct inode *inode);
+extern void minix_free_block_bs(struct inode *inode, unsigned long block);
+
+extern int V1_minix_get_block_bs(struct inode *inode, long block,
+			struct buffer_head *bh_result, int create);
+extern int V2_minix_get_block_bs(struct inode *inode, long block,
+			struct buffer_head *bh_result, int create);
+extern void V1_minix_truncate_bs(struct inode *inode);
+extern void V2_minix_truncate_bs(struct inode *inode);
+extern unsigned V1_minix_blocks_bs(loff_t size, struct super_block *sb);
+extern unsigned V2_minix_blocks_bs(loff_t size, struct super_block *sb);
+extern void minix_truncate_bs(struct inode *inode);
+extern int minix_prepare_chunk_bs(struct page *page, loff_t pos,
+			unsigned len);
+extern void minix_set_inode_bs(struct inode *inode, dev_t rdev);
+extern struct inode *minix_iget_bs(struct super_block *sb, unsigned long ino);
+
+extern struct minix_dir_entry *minix_find_entry_bs(struct dentry *dentry,
+			struct page **res_page);
+extern int minix_add_link_bs(struct dentry *dentry, struct inode *inode);
+extern int minix_delete_entry_bs(struct minix_dir_entry *de,
+			struct page *page);
+extern int minix_make_empty_bs(struct inode *inode, struct inode *dir);
+extern int minix_empty_dir_bs(struct inode *inode);
+extern void minix_set_link_bs(struct minix_dir_entry *de, struct page *page,
+			struct inode *inode);
+extern struct minix_dir_entry *minix_dotdot_bs(struct inode *dir,
+			struct page **p);
+extern ino_t minix_inode_by_name_bs(struct dentry *dentry);
+extern void minix_dir_index_drop_bs(struct inode *dir);
+extern int minix_getattr_bs(const struct path *path, struct kstat *stat,
+			u32 request_mask, unsigned int flags);
 
 #define BS_DUP() printk("Expand..[%s][%s][%d]\n", __FILE__, __func__, __LINE__)
 
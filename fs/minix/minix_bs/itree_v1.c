@@ -0,0 +1,79 @@
+/*
+ * minix-fs filesytem -- V1 block tree
+ *
+ * (C) 2026.10.18 BuddyZhang1 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/buffer_head.h>
+#include <linux/slab.h>
+#include <uapi/linux/minix_fs.h>
+
+#include "internal.h"
+
+enum {DEPTH = 3, DIRECT = 7};	/* Only double indirect */
+
+typedef u16 block_t;	/* 16 bit, host order */
+
+static inline unsigned long block_to_cpu(block_t n)
+{
+	return n;
+}
+
+static inline block_t cpu_to_block(unsigned long n)
+{
+	return n;
+}
+
+static inline block_t *i_data(struct inode *inode)
+{
+	return (block_t *)minix_i_bs(inode)->u.i1_data;
+}
+
+static int block_to_path(struct inode *inode, long block, int offsets[DEPTH])
+{
+	int n = 0;
+
+	if (block < 0) {
+		printk("MINIX-fs_bs: block_to_path: block %ld < 0 on dev %pg\n",
+			block, inode->i_sb->s_bdev);
+	} else if ((u64)block * BLOCK_SIZE >= inode->i_sb->s_maxbytes) {
+		if (printk_ratelimit())
+			printk("MINIX-fs_bs: block_to_path: "
+			       "block %ld too big on dev %pg\n",
+				block, inode->i_sb->s_bdev);
+	} else if (block < 7) {
+		offsets[n++] = block;
+	} else if ((block -= 7) < 512) {
+		offsets[n++] = 7;
+		offsets[n++] = block;
+	} else {
+		block -= 512;
+		offsets[n++] = 8;
+		offsets[n++] = block >> 9;
+		offsets[n++] = block & 511;
+	}
+	return n;
+}
+
+#include "itree_common.c"
+
+int V1_minix_get_block_bs(struct inode *inode, long block,
+			struct buffer_head *bh_result, int create)
+{
+	return get_block(inode, block, bh_result, create);
+}
+
+void V1_minix_truncate_bs(struct inode *inode)
+{
+	truncate(inode);
+}
+
+unsigned V1_minix_blocks_bs(loff_t size, struct super_block *sb)
+{
+	return nblocks(size, sb);
+}
@@ -0,0 +1,89 @@
+/*
+ * minix-fs filesytem -- V2 block tree
+ *
+ * (C) 2026.10.18 BuddyZhang1 <buddy.zhang@aliyun.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/buffer_head.h>
+#include <linux/slab.h>
+#include <uapi/linux/minix_fs.h>
+
+#include "internal.h"
+
+enum {DIRECT = 7, DEPTH = 4};	/* Have triple indirect */
+
+typedef u32 block_t;	/* 32 bit, host order */
+
+static inline unsigned long block_to_cpu(block_t n)
+{
+	return n;
+}
+
+static inline block_t cpu_to_block(unsigned long n)
+{
+	return n;
+}
+
+static inline block_t *i_data(struct inode *inode)
+{
+	return (block_t *)minix_i_bs(inode)->u.i2_data;
+}
+
+#define DIRCOUNT 7
+#define INDIRCOUNT(sb) (1 << ((sb)->s_blocksize_bits - 2))
+
+static int block_to_path(struct inode *inode, long block, int offsets[DEPTH])
+{
+	int n = 0;
+	struct super_block *sb = inode->i_sb;
+
+	if (block < 0) {
+		printk("MINIX-fs_bs: block_to_path: block %ld < 0 on dev %pg\n",
+			block, sb->s_bdev);
+	} else if ((u64)block * (u64)sb->s_blocksize >= sb->s_maxbytes) {
+		if (printk_ratelimit())
+			printk("MINIX-fs_bs: block_to_path: "
+			       "block %ld too big on dev %pg\n",
+				block, sb->s_bdev);
+	} else if (block < DIRCOUNT) {
+		offsets[n++] = block;
+	} else if ((block -= DIRCOUNT) < INDIRCOUNT(sb)) {
+		offsets[n++] = DIRCOUNT;
+		offsets[n++] = block;
+	} else if ((block -= INDIRCOUNT(sb)) <
+				INDIRCOUNT(sb) * INDIRCOUNT(sb)) {
+		offsets[n++] = DIRCOUNT + 1;
+		offsets[n++] = block / INDIRCOUNT(sb);
+		offsets[n++] = block % INDIRCOUNT(sb);
+	} else {
+		block -= INDIRCOUNT(sb) * INDIRCOUNT(sb);
+		offsets[n++] = DIRCOUNT + 2;
+		offsets[n++] = (block / INDIRCOUNT(sb)) / INDIRCOUNT(sb);
+		offsets[n++] = (block / INDIRCOUNT(sb)) % INDIRCOUNT(sb);
+		offsets[n++] = block % INDIRCOUNT(sb);
+	}
+	return n;
+}
+
+#include "itree_common.c"
+
+int V2_minix_get_block_bs(struct inode *inode, long block,
+			struct buffer_head *bh_result, int create)
+{
+	return get_block(inode, block, bh_result, create);
+}
+
+void V2_minix_truncate_bs(struct inode *inode)
+{
+	truncate(inode);
+}
+
+unsigned V2_minix_blocks_bs(loff_t size, struct super_block *sb)
+{
+	return nblocks(size, sb);
+}
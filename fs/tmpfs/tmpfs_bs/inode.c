@@ -24,6 +24,11 @@
 #include <linux/memcontrol.h>
 #include <linux/highmem.h>
 #include <linux/uio.h>
+#include <linux/pagevec.h>
+#include <linux/huge_mm.h>
+#include <linux/khugepaged.h>
+#include <linux/sched/mm.h>
+#include <linux/shrinker.h>
 
 #include "internal.h"
 
@@ -192,13 +197,6 @@ unacct:
 	return false;
 }
 
-static struct page *shmem_alloc_hugepage_bs(gfp_t gfp,
-		struct shmem_inode_info *info, pgoff_t index)
-{
-	BS_DUP();
-	return NULL;
-}
-
 static void shmem_pseudo_vma_init_bs(struct vm_area_struct *vma,
 		struct shmem_inode_info *info, pgoff_t index)
 {
@@ -215,6 +213,35 @@ static void shmem_pseudo_vma_destroy_bs(struct vm_area_struct *vma)
 	mpol_cond_put(vma->vm_policy);
 }
 
+/*
+ * A PMD-sized page is only used when none of the HPAGE_PMD_NR slots
+ * it would cover is populated yet; otherwise fall back to small pages.
+ */
+static struct page *shmem_alloc_hugepage_bs(gfp_t gfp,
+		struct shmem_inode_info *info, pgoff_t index)
+{
+	struct vm_area_struct pvma;
+	struct address_space *mapping = info->vfs_inode.i_mapping;
+	pgoff_t hindex;
+	struct page *page;
+
+	if (!IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE))
+		return NULL;
+
+	hindex = round_down(index, HPAGE_PMD_NR);
+	if (xa_find(&mapping->i_pages, &hindex, hindex + HPAGE_PMD_NR - 1,
+								XA_PRESENT))
+		return NULL;
+
+	shmem_pseudo_vma_init_bs(&pvma, info, hindex);
+	page = alloc_pages_vma(gfp | __GFP_COMP | __GFP_NORETRY | __GFP_NOWARN,
+			HPAGE_PMD_ORDER, &pvma, 0, numa_node_id(), true);
+	shmem_pseudo_vma_destroy_bs(&pvma);
+	if (page)
+		prep_transhuge_page(page);
+	return page;
+}
+
 static struct page *shmem_alloc_page_bs(gfp_t gfp,
 		struct shmem_inode_info *info, pgoff_t index)
 {
@@ -271,6 +298,64 @@ failed:
 	return ERR_PTR(err);
 }
 
+/*
+ * Like add_to_page_cache_locked, but error if expected item has gone.
+ * A compound page takes all of its HPAGE_PMD_NR slots in one go.
+ */
+static int shmem_add_to_page_cache_bs(struct page *page,
+			struct address_space *mapping,
+			pgoff_t index, void *expected, gfp_t gfp)
+{
+	XA_STATE_ORDER(xas, &mapping->i_pages, index, compound_order(page));
+	unsigned long i = 0;
+	unsigned long nr = 1UL << compound_order(page);
+
+	VM_BUG_ON_PAGE(PageTail(page), page);
+	VM_BUG_ON_PAGE(index != round_down(index, nr), page);
+	VM_BUG_ON_PAGE(!PageLocked(page), page);
+	VM_BUG_ON_PAGE(!PageSwapBacked(page), page);
+	VM_BUG_ON(expected && PageTransHuge(page));
+
+	page_ref_add(page, nr);
+	page->mapping = mapping;
+	page->index = index;
+
+	do {
+		void *entry;
+
+		xas_lock_irq(&xas);
+		entry = xas_find_conflict(&xas);
+		if (entry != expected)
+			xas_set_err(&xas, -EEXIST);
+		xas_create_range(&xas);
+		if (xas_error(&xas))
+			goto unlock;
+next:
+		xas_store(&xas, page + i);
+		if (++i < nr) {
+			xas_next(&xas);
+			goto next;
+		}
+		if (PageTransHuge(page)) {
+			count_vm_event(THP_FILE_ALLOC);
+			__inc_node_page_state(page, NR_SHMEM_THPS);
+		}
+		mapping->nrpages += nr;
+		__mod_node_page_state(page_pgdat(page), NR_FILE_PAGES, nr);
+		__mod_node_page_state(page_pgdat(page), NR_SHMEM, nr);
+unlock:
+		xas_unlock_irq(&xas);
+	} while (xas_nomem(&xas, gfp));
+
+	if (xas_error(&xas)) {
+		page->mapping = NULL;
+		page_ref_sub(page, nr);
+		return xas_error(&xas);
+	}
+
+	return 0;
+}
+
 /*
  * shmem_recalc_indoe - recalculate the block usage of an inode
  */
@@ -287,6 +372,137 @@ static void shmem_recalc_inode_bs(struct inode *inode)
 	}
 }
 
+/*
+ * Inodes whose last huge page reaches past i_size sit on
+ * sbinfo->shrinklist. Under memory pressure (or when an allocation hits
+ * -ENOSPC) that page is split, which lets the tail beyond EOF go.
+ */
+unsigned long shmem_unused_huge_shrink_bs(struct shmem_sb_info *sbinfo,
+		struct shrink_control *sc, unsigned long nr_to_split)
+{
+	LIST_HEAD(list), *pos, *next;
+	LIST_HEAD(to_remove);
+	struct inode *inode;
+	struct shmem_inode_info *info;
+	struct page *page;
+	unsigned long batch = sc ? sc->nr_to_scan : 128;
+	int removed = 0, split = 0;
+
+	if (!IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE))
+		return 0;
+
+	if (list_empty(&sbinfo->shrinklist))
+		return SHRINK_STOP;
+
+	spin_lock(&sbinfo->shrinklist_lock);
+	list_for_each_safe(pos, next, &sbinfo->shrinklist) {
+		info = list_entry(pos, struct shmem_inode_info, shrinklist);
+
+		/* pin the inode */
+		inode = igrab(&info->vfs_inode);
+
+		/* inode is about to be evicted */
+		if (!inode) {
+			list_del_init(&info->shrinklist);
+			removed++;
+			goto next;
+		}
+
+		/* Check if there's anything to gain */
+		if (round_up(inode->i_size, PAGE_SIZE) ==
+				round_up(inode->i_size, HPAGE_PMD_SIZE)) {
+			list_move(&info->shrinklist, &to_remove);
+			removed++;
+			goto next;
+		}
+
+		list_move(&info->shrinklist, &list);
+next:
+		if (!--batch)
+			break;
+	}
+	spin_unlock(&sbinfo->shrinklist_lock);
+
+	list_for_each_safe(pos, next, &to_remove) {
+		info = list_entry(pos, struct shmem_inode_info, shrinklist);
+		inode = &info->vfs_inode;
+		list_del_init(&info->shrinklist);
+		iput(inode);
+	}
+
+	list_for_each_safe(pos, next, &list) {
+		int ret;
+
+		info = list_entry(pos, struct shmem_inode_info, shrinklist);
+		inode = &info->vfs_inode;
+
+		if (nr_to_split && split >= nr_to_split)
+			goto leave;
+
+		page = find_get_page(inode->i_mapping,
+				(inode->i_size & HPAGE_PMD_MASK) >> PAGE_SHIFT);
+		if (!page)
+			goto drop;
+
+		/* No huge page at the end of the file: nothing to split */
+		if (!PageTransHuge(page)) {
+			put_page(page);
+			goto drop;
+		}
+
+		/*
+		 * Leave the inode on the list if we failed to lock
+		 * the page at this time.
+		 *
+		 * Waiting for the lock may lead to deadlock in the
+		 * reclaim path.
+		 */
+		if (!trylock_page(page)) {
+			put_page(page);
+			goto leave;
+		}
+
+		ret = split_huge_page(page);
+		unlock_page(page);
+		put_page(page);
+
+		/* If split failed leave the inode on the list */
+		if (ret)
+			goto leave;
+
+		split++;
+drop:
+		list_del_init(&info->shrinklist);
+		removed++;
+leave:
+		iput(inode);
+	}
+
+	spin_lock(&sbinfo->shrinklist_lock);
+	list_splice_tail(&list, &sbinfo->shrinklist);
+	sbinfo->shrinklist_len -= removed;
+	spin_unlock(&sbinfo->shrinklist_lock);
+
+	return split;
+}
+
+/* Called from eviction: the inode must not be left on the shrinklist */
+void shmem_shrinklist_del_bs(struct inode *inode)
+{
+	struct shmem_sb_info *sbinfo = SHMEM_SB_BS(inode->i_sb);
+	struct shmem_inode_info *info = SHMEM_I_BS(inode);
+
+	if (list_empty(&info->shrinklist))
+		return;
+
+	spin_lock(&sbinfo->shrinklist_lock);
+	if (!list_empty(&info->shrinklist)) {
+		list_del_init(&info->shrinklist);
+		sbinfo->shrinklist_len--;
+	}
+	spin_unlock(&sbinfo->shrinklist_lock);
+}
+
 static int shmem_getpage_gfp_bs(struct inode *inode, pgoff_t index,
 		struct page **pagep, enum sgp_type sgp, gfp_t gfp,
 		struct vm_area_struct *vma, struct vm_fault *vmf,
@@ -302,6 +518,7 @@ static int shmem_getpage_gfp_bs(struct inode *inode, pgoff_t index,
 	enum sgp_type sgp_huge = sgp;
 	pgoff_t hindex = index;
 	int error;
+	int once = 0;
 	int alloced = 0;
 
 	if (index > (MAX_LFS_FILESIZE >> PAGE_SHIFT))
@@ -388,7 +605,26 @@ alloc_nohuge:
 								index, false);
 		}
 		if (IS_ERR(page)) {
-			BS_DUP();
+			int retry = 5;
+
+			error = PTR_ERR(page);
+			page = NULL;
+			if (error != -ENOSPC)
+				goto unlock;
+			/*
+			 * Try to reclaim some space by splitting a huge page
+			 * beyond i_size on the filesystem.
+			 */
+			while (retry--) {
+				unsigned long ret;
+
+				ret = shmem_unused_huge_shrink_bs(sbinfo, NULL, 1);
+				if (ret == SHRINK_STOP)
+					break;
+				if (ret)
+					goto alloc_nohuge;
+			}
+			goto unlock;
 		}
 
 		if (PageTransHuge(page))
@@ -401,8 +637,12 @@ alloc_nohuge:
 
 		error = mem_cgroup_try_charge_delay(page, charge_mm, gfp,
 				&memcg, PageTransHuge(page));
+		if (error)
+			goto unacct;
+		error = shmem_add_to_page_cache_bs(page, mapping, hindex,
+					NULL, gfp & GFP_RECLAIM_MASK);
 		if (error) {
-			mem_cgroup_cancel_charge(page, memcg, 
+			mem_cgroup_cancel_charge(page, memcg,
 							PageTransHuge(page));
 			goto unacct;
 		}
@@ -418,9 +658,23 @@ alloc_nohuge:
 		alloced = true;
 
 		if (PageTransHuge(page) &&
-			DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE) <
+				DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE) <
 				hindex + HPAGE_PMD_NR - 1) {
-			BS_DUP();
+			/*
+			 * Part of the huge page is beyond i_size: subject
+			 * to shrink under memory pressure.
+			 */
+			spin_lock(&sbinfo->shrinklist_lock);
+			/*
+			 * _careful to defend against unlocked access to
+			 * ->shrink_list in shmem_unused_huge_shrink_bs()
+			 */
+			if (list_empty_careful(&info->shrinklist)) {
+				list_add_tail(&info->shrinklist,
+						&sbinfo->shrinklist);
+				sbinfo->shrinklist_len++;
+			}
+			spin_unlock(&sbinfo->shrinklist_lock);
 		}
 
 		/*
@@ -449,16 +703,41 @@ clear:
 	/* Perhaps the file has been truncated since we checked */
 	if (sgp <= SGP_CACHE &&
 		((loff_t)index << PAGE_SHIFT) >= i_size_read(inode)) {
-		BS_DUP();
+		if (alloced) {
+			ClearPageDirty(page);
+			delete_from_page_cache(page);
+			spin_lock_irq(&info->lock);
+			shmem_recalc_inode_bs(inode);
+			spin_unlock_irq(&info->lock);
+		}
+		error = -EINVAL;
+		goto unlock;
 	}
 	*pagep = page + index - hindex;
 	return 0;
 
 	/* Error recovery */
 unacct:
-	BS_DUP();
+	shmem_inode_unacct_blocks_bs(inode, 1 << compound_order(page));
+
+	if (PageTransHuge(page)) {
+		unlock_page(page);
+		put_page(page);
+		goto alloc_nohuge;
+	}
 unlock:
-	BS_DUP();
+	if (page) {
+		unlock_page(page);
+		put_page(page);
+	}
+	if (error == -ENOSPC && !once++) {
+		spin_lock_irq(&info->lock);
+		shmem_recalc_inode_bs(inode);
+		spin_unlock_irq(&info->lock);
+		goto repeat;
+	}
+	if (error == -EEXIST)	/* from above or from xas_store */
+		goto repeat;
 	return error;
 }
 
@@ -504,7 +783,14 @@ shmem_write_end_bs(struct file *file, struct address_space *mapping,
 		struct page *head = compound_head(page);
 
 		if (PageTransCompound(page)) {
-			BS_DUP();
+			int i;
+
+			for (i = 0; i < HPAGE_PMD_NR; i++) {
+				if (head + i == page)
+					continue;
+				clear_highpage(head + i);
+				flush_dcache_page(head + i);
+			}
 		}
 		if (copied < PAGE_SIZE) {
 			unsigned from = pos & (PAGE_SIZE - 1);
@@ -538,7 +824,9 @@ static int shmem_getattr_bs(const struct path *path, struct kstat *stat,
 	struct shmem_sb_info *sb_info = SHMEM_SB_BS(inode->i_sb);
 
 	if (info->alloced - info->swapped != inode->i_mapping->nrpages) {
-		BS_DUP();
+		spin_lock_irq(&info->lock);
+		shmem_recalc_inode_bs(inode);
+		spin_unlock_irq(&info->lock);
 	}
 	generic_fillattr(inode, stat);
 
@@ -548,24 +836,414 @@ static int shmem_getattr_bs(const struct path *path, struct kstat *stat,
 	return 0;
 }
 
-static int shmem_setattr_bs(struct dentry *dentry, struct iattr *attr)
+/*
+ * A huge page straddling @index (the first page kept, or the first one
+ * removed) is split, so that only the small pages inside the range go
+ * away. If it cannot be split (extra pins), shmem_undo_range_bs() falls
+ * back to zeroing the covered subpages and the huge page stays.
+ */
+static void shmem_split_huge_at_bs(struct inode *inode, pgoff_t index)
 {
-	BS_DUP();
+	struct page *page;
+
+	if (!IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE) ||
+				!(index & (HPAGE_PMD_NR - 1)))
+		return;
+	page = find_lock_page(inode->i_mapping, index);
+	if (!page)
+		return;
+	if (PageTransCompound(page))
+		split_huge_page(page);
+	unlock_page(page);
+	put_page(page);
+}
+
+/*
+ * Remove range of pages and swap entries from page cache, and free them.
+ * If !unfalloc, truncate or punch hole; if unfalloc, undo failed fallocate.
+ */
+static void shmem_undo_range_bs(struct inode *inode, loff_t lstart,
+					loff_t lend, bool unfalloc)
+{
+	struct address_space *mapping = inode->i_mapping;
+	struct shmem_inode_info *info = SHMEM_I_BS(inode);
+	pgoff_t start = (lstart + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	pgoff_t end = (lend + 1) >> PAGE_SHIFT;
+	unsigned int partial_start = lstart & (PAGE_SIZE - 1);
+	unsigned int partial_end = (lend + 1) & (PAGE_SIZE - 1);
+	struct pagevec pvec;
+	pgoff_t indices[PAGEVEC_SIZE];
+	pgoff_t index;
+	int i;
+
+	if (lend == -1)
+		end = -1;	/* unsigned, so actually very big */
+
+	shmem_split_huge_at_bs(inode, start);
+	if (end != -1)
+		shmem_split_huge_at_bs(inode, end);
+
+	pagevec_init(&pvec);
+	index = start;
+	while (index < end) {
+		pvec.nr = find_get_entries(mapping, index,
+			min(end - index, (pgoff_t)PAGEVEC_SIZE),
+			pvec.pages, indices);
+		if (!pvec.nr)
+			break;
+		for (i = 0; i < pagevec_count(&pvec); i++) {
+			struct page *page = pvec.pages[i];
+
+			index = indices[i];
+			if (index >= end)
+				break;
+
+			/* tmpfs_bs does not swap yet */
+			if (xa_is_value(page))
+				continue;
+
+			VM_BUG_ON_PAGE(page_to_pgoff(page) != index, page);
+
+			if (!trylock_page(page))
+				continue;
+
+			if (PageTransTail(page)) {
+				/* Middle of THP: zero out the page */
+				clear_highpage(page);
+				unlock_page(page);
+				continue;
+			} else if (PageTransHuge(page)) {
+				if (index == round_down(end, HPAGE_PMD_NR)) {
+					/*
+					 * Range ends in the middle of THP:
+					 * zero out the page
+					 */
+					clear_highpage(page);
+					unlock_page(page);
+					continue;
+				}
+				index += HPAGE_PMD_NR - 1;
+				i += HPAGE_PMD_NR - 1;
+			}
+
+			if (!unfalloc || !PageUptodate(page)) {
+				VM_BUG_ON_PAGE(PageTail(page), page);
+				if (page_mapping(page) == mapping) {
+					VM_BUG_ON_PAGE(PageWriteback(page), page);
+					truncate_inode_page(mapping, page);
+				}
+			}
+			unlock_page(page);
+		}
+		pagevec_remove_exceptionals(&pvec);
+		pagevec_release(&pvec);
+		cond_resched();
+		index++;
+	}
+
+	if (partial_start) {
+		struct page *page = NULL;
+
+		shmem_getpage_bs(inode, start - 1, &page, SGP_READ);
+		if (page) {
+			unsigned int top = PAGE_SIZE;
+
+			if (start > end) {
+				top = partial_end;
+				partial_end = 0;
+			}
+			zero_user_segment(page, partial_start, top);
+			set_page_dirty(page);
+			unlock_page(page);
+			put_page(page);
+		}
+	}
+	if (partial_end) {
+		struct page *page = NULL;
+
+		shmem_getpage_bs(inode, end, &page, SGP_READ);
+		if (page) {
+			zero_user_segment(page, 0, partial_end);
+			set_page_dirty(page);
+			unlock_page(page);
+			put_page(page);
+		}
+	}
+	if (start >= end)
+		return;
+
+	index = start;
+	while (index < end) {
+		cond_resched();
+
+		pvec.nr = find_get_entries(mapping, index,
+				min(end - index, (pgoff_t)PAGEVEC_SIZE),
+				pvec.pages, indices);
+		if (!pvec.nr) {
+			/* If all gone or hole-punch or unfalloc, we're done */
+			if (index == start || end != -1)
+				break;
+			/* But if truncating, restart to make sure all gone */
+			index = start;
+			continue;
+		}
+		for (i = 0; i < pagevec_count(&pvec); i++) {
+			struct page *page = pvec.pages[i];
+
+			index = indices[i];
+			if (index >= end)
+				break;
+
+			if (xa_is_value(page))
+				continue;
+
+			lock_page(page);
+
+			if (PageTransTail(page)) {
+				/* Middle of THP: zero out the page */
+				clear_highpage(page);
+				unlock_page(page);
+				/*
+				 * Partial thp truncate due 'start' in middle
+				 * of THP: don't need to look on these pages
+				 * again on !pvec.nr restart.
+				 */
+				if (index != round_down(end, HPAGE_PMD_NR))
+					start++;
+				continue;
+			} else if (PageTransHuge(page)) {
+				if (index == round_down(end, HPAGE_PMD_NR)) {
+					/*
+					 * Range ends in the middle of THP:
+					 * zero out the page
+					 */
+					clear_highpage(page);
+					unlock_page(page);
+					continue;
+				}
+				index += HPAGE_PMD_NR - 1;
+				i += HPAGE_PMD_NR - 1;
+			}
+
+			if (!unfalloc || !PageUptodate(page)) {
+				VM_BUG_ON_PAGE(PageTail(page), page);
+				if (page_mapping(page) == mapping) {
+					VM_BUG_ON_PAGE(PageWriteback(page), page);
+					truncate_inode_page(mapping, page);
+				} else {
+					/* Page was replaced by swap: retry */
+					unlock_page(page);
+					index--;
+					break;
+				}
+			}
+			unlock_page(page);
+		}
+		pagevec_remove_exceptionals(&pvec);
+		pagevec_release(&pvec);
+		index++;
+	}
+
+	spin_lock_irq(&info->lock);
+	shmem_recalc_inode_bs(inode);
+	spin_unlock_irq(&info->lock);
+}
+
+void shmem_truncate_range_bs(struct inode *inode, loff_t lstart, loff_t lend)
+{
+	shmem_undo_range_bs(inode, lstart, lend, false);
+	inode->i_ctime = inode->i_mtime = current_time(inode);
+}
+
+/*
+ * ... whereas tmpfs objects are accounted incrementally as
+ * pages are allocated, in order to allow large sparse files.
+ */
+static int shmem_reacct_size_bs(unsigned long flags,
+				loff_t oldsize, loff_t newsize)
+{
+	if (!(flags & VM_NORESERVE)) {
+		if (VM_ACCT(newsize) > VM_ACCT(oldsize))
+			return security_vm_enough_memory_mm(current->mm,
+					VM_ACCT(newsize) - VM_ACCT(oldsize));
+		else if (VM_ACCT(newsize) < VM_ACCT(oldsize))
+			vm_unacct_memory(VM_ACCT(oldsize) - VM_ACCT(newsize));
+	}
 	return 0;
 }
 
+static int shmem_setattr_bs(struct dentry *dentry, struct iattr *attr)
+{
+	struct inode *inode = d_inode(dentry);
+	struct shmem_inode_info *info = SHMEM_I_BS(inode);
+	int error;
+
+	error = setattr_prepare(dentry, attr);
+	if (error)
+		return error;
+
+	if (S_ISREG(inode->i_mode) && (attr->ia_valid & ATTR_SIZE)) {
+		loff_t oldsize = inode->i_size;
+		loff_t newsize = attr->ia_size;
+
+		/* protected by i_mutex */
+		if ((newsize < oldsize && (info->seals & F_SEAL_SHRINK)) ||
+		    (newsize > oldsize && (info->seals & F_SEAL_GROW)))
+			return -EPERM;
+
+		if (newsize != oldsize) {
+			error = shmem_reacct_size_bs(info->flags,
+					oldsize, newsize);
+			if (error)
+				return error;
+			i_size_write(inode, newsize);
+			inode->i_ctime = inode->i_mtime = current_time(inode);
+		}
+		if (newsize <= oldsize) {
+			loff_t holebegin = round_up(newsize, PAGE_SIZE);
+
+			if (oldsize > holebegin)
+				unmap_mapping_range(inode->i_mapping,
+							holebegin, 0, 1);
+			if (info->alloced)
+				shmem_truncate_range_bs(inode,
+							newsize, (loff_t)-1);
+			/* unmap again to remove racily COWed private pages */
+			if (oldsize > holebegin)
+				unmap_mapping_range(inode->i_mapping,
+							holebegin, 0, 1);
+		}
+	}
+
+	setattr_copy(inode, attr);
+	if (attr->ia_valid & ATTR_MODE)
+		error = posix_acl_chmod(inode, inode->i_mode);
+	return error;
+}
+
+static vm_fault_t shmem_fault_bs(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct inode *inode = file_inode(vma->vm_file);
+	gfp_t gfp = mapping_gfp_mask(inode->i_mapping);
+	enum sgp_type sgp;
+	int err;
+	vm_fault_t ret = VM_FAULT_LOCKED;
+
+	sgp = SGP_CACHE;
+
+	if ((vma->vm_flags & VM_NOHUGEPAGE) ||
+	    test_bit(MMF_DISABLE_THP, &vma->vm_mm->flags))
+		sgp = SGP_NOHUGE;
+	else if (vma->vm_flags & VM_HUGEPAGE)
+		sgp = SGP_HUGE;
+
+	err = shmem_getpage_gfp_bs(inode, vmf->pgoff, &vmf->page, sgp,
+				gfp, vma, vmf, &ret);
+	if (err)
+		return vmf_error(err);
+	return ret;
+}
+
+/*
+ * A huge page cache page is mapped with a single PMD by the generic
+ * fault code (alloc_set_pte -> do_set_pmd) whenever the vma covers the
+ * whole aligned range; shmem_get_unmapped_area_bs() sees to alignment.
+ */
+static const struct vm_operations_struct shmem_vm_ops_bs = {
+	.fault		= shmem_fault_bs,
+	.map_pages	= filemap_map_pages,
+};
+
 static int shmem_mmap_bs(struct file *file, struct vm_area_struct *vma)
 {
-	BS_DUP();
+	file_accessed(file);
+	vma->vm_ops = &shmem_vm_ops_bs;
+	if (IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE) &&
+		((vma->vm_start + ~HPAGE_PMD_MASK) & HPAGE_PMD_MASK) <
+			(vma->vm_end & HPAGE_PMD_MASK)) {
+		khugepaged_enter(vma, vma->vm_flags);
+	}
 	return 0;
 }
 
+static const struct file_operations shmem_file_operations_bs;
+
 unsigned long shmem_get_unmapped_area_bs(struct file *file,
 		unsigned long uaddr, unsigned long len,
 		unsigned long pgoff, unsigned long flags)
 {
-	BS_DUP();
-	return 0;
+	unsigned long (*get_area)(struct file *,
+		unsigned long, unsigned long, unsigned long, unsigned long);
+	unsigned long addr;
+	unsigned long offset;
+	unsigned long inflated_len;
+	unsigned long inflated_addr;
+	unsigned long inflated_offset;
+
+	if (len > TASK_SIZE)
+		return -ENOMEM;
+
+	get_area = current->mm->get_unmapped_area;
+	addr = get_area(file, uaddr, len, pgoff, flags);
+
+	if (!IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE))
+		return addr;
+	if (IS_ERR_VALUE(addr))
+		return addr;
+	if (addr & ~PAGE_MASK)
+		return addr;
+	if (addr > TASK_SIZE - len)
+		return addr;
+
+	if (shmem_huge == SHMEM_HUGE_DENY)
+		return addr;
+	if (len < HPAGE_PMD_SIZE)
+		return addr;
+	if (flags & MAP_FIXED)
+		return addr;
+	/*
+	 * Our priority is to support MAP_SHARED mapped hugely;
+	 * and support MAP_PRIVATE mapped hugely too, until it is COWed.
+	 * But if caller specified an address hint, respect that as before.
+	 */
+	if (uaddr)
+		return addr;
+
+	if (shmem_huge != SHMEM_HUGE_FORCE) {
+		if (!file || file->f_op != &shmem_file_operations_bs)
+			return addr;
+		if (SHMEM_SB_BS(file_inode(file)->i_sb)->huge ==
+							SHMEM_HUGE_NEVER)
+			return addr;
+	}
+
+	offset = (pgoff << PAGE_SHIFT) & (HPAGE_PMD_SIZE - 1);
+	if (offset && offset + len < 2 * HPAGE_PMD_SIZE)
+		return addr;
+	if ((addr & (HPAGE_PMD_SIZE - 1)) == offset)
+		return addr;
+
+	inflated_len = len + HPAGE_PMD_SIZE - PAGE_SIZE;
+	if (inflated_len > TASK_SIZE)
+		return addr;
+	if (inflated_len < len)
+		return addr;
+
+	inflated_addr = get_area(NULL, 0, inflated_len, 0, flags);
+	if (IS_ERR_VALUE(inflated_addr))
+		return addr;
+	if (inflated_addr & ~PAGE_MASK)
+		return addr;
+
+	inflated_offset = inflated_addr & (HPAGE_PMD_SIZE - 1);
+	inflated_addr += offset - inflated_offset;
+	if (inflated_offset > offset)
+		inflated_addr += HPAGE_PMD_SIZE;
+
+	if (inflated_addr > TASK_SIZE - len)
+		return addr;
+	return inflated_addr;
 }
 
 static loff_t shmem_file_llseek_bs(struct file *file, 
@@ -575,6 +1253,122 @@ static loff_t shmem_file_llseek_bs(struct file *file,
 	return 0;
 }
 
+/* Slots shmem_read_batch_bs() takes from the page cache per walk */
+#define SHMEM_READ_BATCH	PAGEVEC_SIZE
+
+/*
+ * Take references to the pages at @index..@last with one xarray walk,
+ * under RCU and without page locks; a hole comes back as NULL. The
+ * walk stops early at anything that needs shmem_getpage_bs(): a swap
+ * entry or a fallocated, !PageUptodate page.
+ */
+static unsigned int shmem_find_read_batch_bs(struct address_space *mapping,
+		pgoff_t index, pgoff_t last, struct page **pages)
+{
+	XA_STATE(xas, &mapping->i_pages, index);
+	unsigned int nr = 0;
+	struct page *page;
+
+	rcu_read_lock();
+	for (page = xas_load(&xas); xas.xa_index <= last;
+					page = xas_next(&xas)) {
+		struct page *head;
+
+		if (xas_retry(&xas, page))
+			continue;
+		if (!page) {
+			pages[nr] = NULL;
+			goto next;
+		}
+		if (xa_is_value(page))
+			break;
+
+		head = compound_head(page);
+		if (!page_cache_get_speculative(head))
+			goto retry;
+		/* Has the page moved or been split? */
+		if (compound_head(page) != head ||
+		    unlikely(page != xas_reload(&xas))) {
+			put_page(head);
+			goto retry;
+		}
+		if (!PageUptodate(page)) {
+			put_page(head);
+			break;
+		}
+		pages[nr] = page;
+next:
+		if (++nr == SHMEM_READ_BATCH)
+			break;
+		continue;
+retry:
+		xas_reset(&xas);
+	}
+	rcu_read_unlock();
+	return nr;
+}
+
+/*
+ * Copy a batch from shmem_find_read_batch_bs() in sequence, holes from
+ * the zero page. Returns the bytes copied and advances *ppos; 0 means
+ * the slot at *ppos is EOF or needs the slow path. A short copy sets
+ * *error.
+ */
+static ssize_t shmem_read_batch_bs(struct inode *inode, struct iov_iter *to,
+				loff_t *ppos, int *error)
+{
+	struct address_space *mapping = inode->i_mapping;
+	struct page *pages[SHMEM_READ_BATCH];
+	loff_t pos = *ppos;
+	loff_t i_size = i_size_read(inode);
+	size_t count = iov_iter_count(to);
+	ssize_t copied = 0;
+	unsigned int nr, i;
+	pgoff_t last;
+	bool flush;
+
+	if (!count || pos >= i_size)
+		return 0;
+	last = min_t(pgoff_t, (i_size - 1) >> PAGE_SHIFT,
+				(pos + count - 1) >> PAGE_SHIFT);
+	nr = shmem_find_read_batch_bs(mapping, pos >> PAGE_SHIFT,
+							last, pages);
+
+	/*
+	 * Reads are not serialised against truncate: look at the size
+	 * again now that the pages are pinned.
+	 */
+	i_size = i_size_read(inode);
+	flush = mapping_writably_mapped(mapping);
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
+		unsigned long offset = pos & ~PAGE_MASK;
+		unsigned long bytes, ret;
+
+		if (*error || pos >= i_size || !iov_iter_count(to))
+			goto put;
+		bytes = min_t(loff_t, PAGE_SIZE - offset, i_size - pos);
+		bytes = min_t(size_t, bytes, iov_iter_count(to));
+		if (page) {
+			if (flush)
+				flush_dcache_page(page);
+			if (!offset)
+				mark_page_accessed(page);
+		}
+		ret = copy_page_to_iter(page ? page : ZERO_PAGE(0),
+						offset, bytes, to);
+		copied += ret;
+		pos += ret;
+		if (ret < bytes)
+			*error = -EFAULT;
+put:
+		if (page)
+			put_page(page);
+	}
+	*ppos = pos;
+	return copied;
+}
+
 static ssize_t shmem_file_read_iter_bs(struct kiocb *iocb, 
 						struct iov_iter *to)
 {
@@ -603,8 +1397,30 @@ static ssize_t shmem_file_read_iter_bs(struct kiocb *iocb,
 		struct page *page = NULL;
 		pgoff_t end_index;
 		unsigned long nr, ret;
-		loff_t i_size = i_size_read(inode);
+		loff_t i_size;
+
+		/*
+		 * Plain reads first try to copy a whole batch without
+		 * shmem_getpage_bs() and page locks; whatever it stops at
+		 * is done one page at a time below.
+		 */
+		if (sgp == SGP_READ) {
+			loff_t pos = ((loff_t)index << PAGE_SHIFT) + offset;
+			ssize_t copied;
+
+			copied = shmem_read_batch_bs(inode, to, &pos, &error);
+			retval += copied;
+			index = pos >> PAGE_SHIFT;
+			offset = pos & ~PAGE_MASK;
+			if (error || !iov_iter_count(to))
+				break;
+			if (copied) {
+				cond_resched();
+				continue;
+			}
+		}
 
+		i_size = i_size_read(inode);
 		end_index = i_size >> PAGE_SHIFT;
 		if (index > end_index)
 			break;
@@ -689,11 +1505,309 @@ static ssize_t shmem_file_read_iter_bs(struct kiocb *iocb,
 	return 0;
 }
 
+/* Pages fallocate accounts and allocates per round */
+#define SHMEM_FALLOC_BATCH	64
+
+/*
+ * Account up to @nr pages against the inode and the mount with one
+ * call, halving the batch until it fits, then allocate them. Returns
+ * how many pages were allocated; what could not be allocated is
+ * unaccounted again.
+ */
+static int shmem_alloc_and_acct_pages_bs(gfp_t gfp, struct inode *inode,
+			pgoff_t index, int nr, struct page **pages)
+{
+	struct shmem_inode_info *info = SHMEM_I_BS(inode);
+	int i;
+
+	while (!shmem_inode_acct_block_bs(inode, nr)) {
+		if (nr == 1)
+			return -ENOSPC;
+		nr /= 2;
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct page *page = shmem_alloc_page_bs(gfp, info, index + i);
+
+		if (!page)
+			break;
+		__SetPageLocked(page);
+		__SetPageSwapBacked(page);
+		pages[i] = page;
+	}
+	if (i < nr)
+		shmem_inode_unacct_blocks_bs(inode, nr - i);
+	return i ? i : -ENOMEM;
+}
+
+/*
+ * Insert the locked pages from shmem_alloc_and_acct_page(s)_bs() at
+ * @index on. They are left !PageUptodate: shmem_getpage_gfp_bs() clears
+ * them on first use, and a failed fallocate can tell them apart from
+ * data in shmem_undo_range_bs(). A slot a fault filled in the meantime
+ * is skipped. The block counters are updated once for the batch.
+ * Returns the number of slots filled. On error, *@reached is how many
+ * slots from @index were dealt with before it, so the caller can undo
+ * the pages that did go in.
+ */
+static int shmem_falloc_insert_bs(struct inode *inode, pgoff_t index,
+			struct page **pages, int nr, gfp_t gfp,
+			pgoff_t *reached)
+{
+	struct address_space *mapping = inode->i_mapping;
+	struct shmem_inode_info *info = SHMEM_I_BS(inode);
+	long added = 0, unacct = 0;
+	int i, filled = 0, error = 0;
+
+	*reached = 0;
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
+		bool huge = PageTransHuge(page);
+		int n = 1 << compound_order(page);
+		struct mem_cgroup *memcg;
+
+		if (error)
+			goto drop;
+		error = mem_cgroup_try_charge_delay(page, current->mm, gfp,
+						&memcg, huge);
+		if (error)
+			goto drop;
+		error = shmem_add_to_page_cache_bs(page, mapping, index + i,
+					NULL, gfp & GFP_RECLAIM_MASK);
+		if (error) {
+			mem_cgroup_cancel_charge(page, memcg, huge);
+			if (error == -EEXIST) {
+				error = 0;
+				*reached += n;
+			}
+			goto drop;
+		}
+		mem_cgroup_commit_charge(page, memcg, false, huge);
+		lru_cache_add_anon(page);
+		added += n;
+		filled += n;
+		*reached += n;
+		set_page_dirty(page);
+		unlock_page(page);
+		put_page(page);
+		continue;
+drop:
+		unacct += n;
+		unlock_page(page);
+		put_page(page);
+	}
+
+	if (unacct)
+		shmem_inode_unacct_blocks_bs(inode, unacct);
+	if (added) {
+		spin_lock_irq(&info->lock);
+		info->alloced += added;
+		inode->i_blocks += added * BLOCKS_PER_PAGE;
+		shmem_recalc_inode_bs(inode);
+		spin_unlock_irq(&info->lock);
+	}
+	return error ? error : filled;
+}
+
+/*
+ * An entry already at @index is kept, but a page fallocated earlier and
+ * never written must be initialized now, lest undo on failure cancel
+ * our earlier guarantee: what SGP_FALLOC does in shmem_getpage_gfp_bs().
+ * Returns the index just past the page.
+ */
+static pgoff_t shmem_falloc_existing_bs(struct address_space *mapping,
+			pgoff_t index)
+{
+	struct page *page, *head;
+	int i;
+
+	page = find_lock_page(mapping, index);
+	if (!page)	/* swapped out, or gone since xa_load() */
+		return index + 1;
+
+	head = compound_head(page);
+	if (!PageUptodate(head)) {
+		for (i = 0; i < (1 << compound_order(head)); i++) {
+			clear_highpage(head + i);
+			flush_dcache_page(head + i);
+		}
+		SetPageUptodate(head);
+	}
+	index = head->index + (1 << compound_order(head));
+	unlock_page(page);
+	put_page(page);
+	return index;
+}
+
+/*
+ * Whether fallocate should fill [index, index + HPAGE_PMD_NR) with one
+ * huge page: the same policy as shmem_getpage_gfp_bs(), plus the whole
+ * aligned range being part of the hole.
+ */
+static bool shmem_falloc_huge_bs(struct inode *inode, pgoff_t index,
+			pgoff_t hole_end, pgoff_t size_end)
+{
+	struct shmem_sb_info *sbinfo = SHMEM_SB_BS(inode->i_sb);
+
+	if (!is_huge_enabled_bs(sbinfo))
+		return false;
+	if ((index & (HPAGE_PMD_NR - 1)) || index + HPAGE_PMD_NR > hole_end)
+		return false;
+	if (shmem_huge == SHMEM_HUGE_FORCE)
+		return true;
+	switch (sbinfo->huge) {
+	case SHMEM_HUGE_ALWAYS:
+		return true;
+	case SHMEM_HUGE_WITHIN_SIZE:
+		return index + HPAGE_PMD_NR <= size_end;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Preallocation works hole by hole rather than through a
+ * shmem_getpage_bs() per index: each round accounts and allocates up
+ * to SHMEM_FALLOC_BATCH pages (or one huge page) and inserts them with
+ * a single counter update, so a multi-GB segment costs a few thousand
+ * rounds instead of a fault-sized walk per page.
+ */
 static long shmem_fallocate_bs(struct file *file, int mode, loff_t offset,
 							loff_t len)
 {
-	BS_DUP();
-	return 0;
+	struct inode *inode = file_inode(file);
+	struct address_space *mapping = inode->i_mapping;
+	struct shmem_sb_info *sbinfo = SHMEM_SB_BS(inode->i_sb);
+	struct shmem_inode_info *info = SHMEM_I_BS(inode);
+	gfp_t gfp = mapping_gfp_mask(mapping);
+	pgoff_t start, index, end, size_end;
+	loff_t new_size;
+	int error;
+
+	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
+		return -EOPNOTSUPP;
+
+	inode_lock(inode);
+
+	if (mode & FALLOC_FL_PUNCH_HOLE) {
+		loff_t unmap_start = round_up(offset, PAGE_SIZE);
+		loff_t unmap_end = round_down(offset + len, PAGE_SIZE) - 1;
+
+		/* protected by i_mutex */
+		if (info->seals & F_SEAL_WRITE) {
+			error = -EPERM;
+			goto out;
+		}
+
+		if ((u64)unmap_end > (u64)unmap_start)
+			unmap_mapping_range(mapping, unmap_start,
+					1 + unmap_end - unmap_start, 0);
+		shmem_truncate_range_bs(inode, offset, offset + len - 1);
+		/* No need to unmap again: hole-punching leaves COWed pages */
+		error = 0;
+		goto out;
+	}
+
+	/* We need to check rlimit even when FALLOC_FL_KEEP_SIZE */
+	error = inode_newsize_ok(inode, offset + len);
+	if (error)
+		goto out;
+
+	if ((info->seals & F_SEAL_GROW) && offset + len > inode->i_size) {
+		error = -EPERM;
+		goto out;
+	}
+
+	start = offset >> PAGE_SHIFT;
+	end = (offset + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	/* Try to avoid a swapstorm if len is impossible to satisfy */
+	if (sbinfo->max_blocks && end - start > sbinfo->max_blocks) {
+		error = -ENOSPC;
+		goto out;
+	}
+
+	new_size = inode->i_size;
+	if (!(mode & FALLOC_FL_KEEP_SIZE))
+		new_size = max_t(loff_t, new_size, offset + len);
+	size_end = DIV_ROUND_UP(new_size, PAGE_SIZE);
+
+	index = start;
+	while (index < end) {
+		struct page *pages[SHMEM_FALLOC_BATCH];
+		struct page *page;
+		pgoff_t hole_end = index;
+		pgoff_t reached;
+		bool huge = false;
+		int nr = 0;
+
+		/*
+		 * Good, the fallocate(2) manpage permits EINTR: we may have
+		 * been interrupted because we are using up too much memory.
+		 */
+		if (signal_pending(current)) {
+			error = -EINTR;
+			break;
+		}
+
+		if (xa_load(&mapping->i_pages, index)) {
+			index = shmem_falloc_existing_bs(mapping, index);
+			continue;
+		}
+		if (!xa_find(&mapping->i_pages, &hole_end, end - 1, XA_PRESENT))
+			hole_end = end;
+
+		if (shmem_falloc_huge_bs(inode, index, hole_end, size_end)) {
+			page = shmem_alloc_and_acct_page_bs(gfp, inode,
+							index, true);
+			if (!IS_ERR(page)) {
+				pages[0] = page;
+				nr = 1;
+				huge = true;
+			}
+		}
+		if (!nr) {
+			nr = shmem_alloc_and_acct_pages_bs(gfp, inode, index,
+				min_t(pgoff_t, hole_end - index,
+					SHMEM_FALLOC_BATCH), pages);
+			if (nr < 0) {
+				error = nr;
+				break;
+			}
+		}
+
+		error = shmem_falloc_insert_bs(inode, index, pages, nr, gfp,
+						&reached);
+		if (error < 0) {
+			/* so that the undo below covers what did go in */
+			index += reached;
+			break;
+		}
+		/*
+		 * A huge page that lost a race with a fault is dropped; the
+		 * next round sees the populated slot and goes small.
+		 */
+		if (!huge)
+			index += nr;
+		else if (error)
+			index += HPAGE_PMD_NR;
+		error = 0;
+		cond_resched();
+	}
+
+	if (error) {
+		/* Remove the !PageUptodate pages we added */
+		if (index > start)
+			shmem_undo_range_bs(inode, (loff_t)start << PAGE_SHIFT,
+				((loff_t)index << PAGE_SHIFT) - 1, true);
+		goto out;
+	}
+
+	if (!(mode & FALLOC_FL_KEEP_SIZE) && offset + len > inode->i_size)
+		i_size_write(inode, offset + len);
+	inode->i_ctime = current_time(inode);
+out:
+	inode_unlock(inode);
+	return error;
 }
 
 static struct mempolicy *shmem_get_sbmpol_bs(struct shmem_sb_info *sbinfo)
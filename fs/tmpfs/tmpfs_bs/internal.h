@@ -42,7 +42,9 @@
 #define SHMEM_HUGE_DENY		(-1)
 #define SHMEM_HUGE_FORCE	(-2)
 
-#define shmem_huge		SHMEM_HUGE_DENY
+/* System-wide override of huge=, see shmem.c */
+extern int shmem_huge_bs;
+#define shmem_huge		shmem_huge_bs
 #define shmem_initxattrs_bs	NULL
 #ifndef CONFIG_NUMA
 #define vm_policy		vm_private_data
@@ -61,6 +63,13 @@ static inline struct shmem_inode_info *SHMEM_I_BS(struct inode *inode)
 extern struct inode *shmem_get_inode_bs(struct super_block *sb, 
 	const struct inode *dir, umode_t mode, dev_t dev, unsigned long flags);
 
+extern void shmem_truncate_range_bs(struct inode *inode, loff_t lstart,
+					loff_t lend);
+struct shrink_control;
+extern unsigned long shmem_unused_huge_shrink_bs(struct shmem_sb_info *sbinfo,
+		struct shrink_control *sc, unsigned long nr_to_split);
+extern void shmem_shrinklist_del_bs(struct inode *inode);
+
 #define BS_DUP() printk("Expand. %s-%s-%d\n", __FILE__, __func__, __LINE__)
 
 #endif
@@ -15,11 +15,44 @@
 #include <linux/exportfs.h>
 #include <linux/ctype.h>
 #include <linux/module.h>
+#include <linux/huge_mm.h>
+#include <linux/shrinker.h>
 
 #include "internal.h"
 
 static struct kmem_cache *shmem_inode_cachep_bs;
 
+/*
+ * 0 leaves huge pages to each mount's huge= option; SHMEM_HUGE_DENY (-1)
+ * turns them off everywhere and SHMEM_HUGE_FORCE (-2) on everywhere.
+ */
+int shmem_huge_bs __read_mostly;
+
+static int shmem_huge_param_set_bs(const char *val,
+				const struct kernel_param *kp)
+{
+	int huge, err;
+
+	err = kstrtoint(val, 0, &huge);
+	if (err)
+		return err;
+	if (huge != 0 && huge != SHMEM_HUGE_DENY && huge != SHMEM_HUGE_FORCE)
+		return -EINVAL;
+	if (huge == SHMEM_HUGE_FORCE &&
+	    !IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE))
+		return -EINVAL;
+
+	*(int *)kp->arg = huge;
+	return 0;
+}
+
+static const struct kernel_param_ops shmem_huge_param_ops_bs = {
+	.set	= shmem_huge_param_set_bs,
+	.get	= param_get_int,
+};
+module_param_cb(shmem_huge, &shmem_huge_param_ops_bs, &shmem_huge_bs, 0644);
+MODULE_PARM_DESC(shmem_huge, "0: per mount huge=, -1: deny, -2: force");
+
 static void shmem_init_inode_bs(void *foo)
 {
 	struct shmem_inode_info *info = (struct shmem_inode_info *)foo;
@@ -110,9 +143,31 @@ static int shmem_show_options_bs(struct seq_file *seq, struct dentry *root)
 
 static void shmem_evict_inode_bs(struct inode *inode)
 {
+	shmem_shrinklist_del_bs(inode);
 	BS_DUP();
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGE_PAGECACHE
+static long shmem_unused_huge_scan_bs(struct super_block *sb,
+				struct shrink_control *sc)
+{
+	struct shmem_sb_info *sbinfo = SHMEM_SB_BS(sb);
+
+	if (!READ_ONCE(sbinfo->shrinklist_len))
+		return SHRINK_STOP;
+
+	return shmem_unused_huge_shrink_bs(sbinfo, sc, 0);
+}
+
+static long shmem_unused_huge_count_bs(struct super_block *sb,
+				struct shrink_control *sc)
+{
+	struct shmem_sb_info *sbinfo = SHMEM_SB_BS(sb);
+
+	return READ_ONCE(sbinfo->shrinklist_len);
+}
+#endif
+
 static void shmem_put_super_bs(struct super_block *sb)
 {
 	BS_DUP();
@@ -133,8 +188,27 @@ static const struct super_operations shmem_ops_bs = {
 	.evict_inode	= shmem_evict_inode_bs,
 	.drop_inode	= generic_delete_inode,
 	.put_super	= shmem_put_super_bs,
+#ifdef CONFIG_TRANSPARENT_HUGE_PAGECACHE
+	.nr_cached_objects	= shmem_unused_huge_count_bs,
+	.free_cached_objects	= shmem_unused_huge_scan_bs,
+#endif
 };
 
+#ifdef CONFIG_TRANSPARENT_HUGE_PAGECACHE
+static int shmem_parse_huge_bs(const char *str)
+{
+	if (!strcmp(str, "never"))
+		return SHMEM_HUGE_NEVER;
+	if (!strcmp(str, "always"))
+		return SHMEM_HUGE_ALWAYS;
+	if (!strcmp(str, "within_size"))
+		return SHMEM_HUGE_WITHIN_SIZE;
+	if (!strcmp(str, "advise"))
+		return SHMEM_HUGE_ADVISE;
+	return -EINVAL;
+}
+#endif
+
 static int shmem_parse_options_bs(char *options, struct shmem_sb_info *sbinfo,
 			bool remount)
 {
@@ -216,6 +290,18 @@ static int shmem_parse_options_bs(char *options, struct shmem_sb_info *sbinfo,
 			sbinfo->gid = make_kgid(current_user_ns(), gid);
 			if (!gid_valid(sbinfo->gid))
 				goto bad_val;
+#ifdef CONFIG_TRANSPARENT_HUGE_PAGECACHE
+		} else if (!strcmp(this_char, "huge")) {
+			int huge;
+
+			huge = shmem_parse_huge_bs(value);
+			if (huge < 0)
+				goto bad_val;
+			if (!has_transparent_hugepage() &&
+					huge != SHMEM_HUGE_NEVER)
+				goto bad_val;
+			sbinfo->huge = huge;
+#endif
 		} else {
 			pr_err("tmpfs_bs: Bad mount option %s\n", this_char);
 			goto error;